@@ -0,0 +1,85 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "actor.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+void csdf_actor_execute(const CsdfActor *actor, const void *consumed, void *produced)
+{
+    csdf_actor_execute_in(actor, actor->context, consumed, produced);
+}
+
+void *csdf_actor_new_run_context(const CsdfActor *actor)
+{
+    return actor->newRunContext != NULL ? actor->newRunContext(actor->context) : actor->context;
+}
+
+void csdf_actor_delete_run_context(const CsdfActor *actor, void *runContext)
+{
+    if (actor->deleteRunContext != NULL)
+    {
+        actor->deleteRunContext(runContext);
+    }
+}
+
+static void execute_tokens_in(const CsdfActor *actor, void *runContext, const void *consumed, void *produced)
+{
+    size_t numConsumed = 0;
+    size_t numProduced = 0;
+    for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
+    {
+        numConsumed += actor->inputs[inputId].consumption;
+    }
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        numProduced += actor->outputs[outputId].production;
+    }
+    const void **consumedTokens = malloc((numConsumed + 1) * sizeof(void *));
+    void **producedTokens = malloc((numProduced + 1) * sizeof(void *));
+    const uint8_t *consumedIt = consumed;
+    size_t tokenId = 0;
+    for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
+    {
+        for (unsigned portTokenId = 0; portTokenId < actor->inputs[inputId].consumption; portTokenId++)
+        {
+            consumedTokens[tokenId++] = consumedIt;
+            consumedIt += actor->inputs[inputId].tokenSize;
+        }
+    }
+    uint8_t *producedIt = produced;
+    tokenId = 0;
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        for (unsigned portTokenId = 0; portTokenId < actor->outputs[outputId].production; portTokenId++)
+        {
+            producedTokens[tokenId++] = producedIt;
+            producedIt += actor->outputs[outputId].tokenSize;
+        }
+    }
+    actor->tokenExecution(runContext, consumedTokens, producedTokens);
+    free(producedTokens);
+    free(consumedTokens);
+}
+
+void csdf_actor_execute_in(const CsdfActor *actor, void *runContext, const void *consumed, void *produced)
+{
+    if (actor->contextExecution != NULL)
+    {
+        actor->contextExecution(runContext, consumed, produced);
+    }
+    else if (actor->execution != NULL)
+    {
+        actor->execution(consumed, produced);
+    }
+    else
+    {
+        execute_tokens_in(actor, runContext, consumed, produced);
+    }
+}
@@ -9,10 +9,19 @@ Copyright (c) 2023 Slaven Glumac
 #ifndef CSDF_ACTOR_H
 #define CSDF_ACTOR_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 typedef void (*ActorExecution)(const void *consumed, void *produced);
 
+typedef void (*ActorContextExecution)(void *context, const void *consumed, void *produced);
+
+typedef void (*ActorTokenExecution)(void *context, const void *const *consumed, void *const *produced);
+
+typedef void *(*ActorRunContextFactory)(void *context);
+
+typedef void (*ActorRunContextDeleter)(void *runContext);
+
 typedef struct CsdfInput
 {
     const size_t tokenSize;
@@ -34,6 +43,18 @@ typedef struct CsdfActor
     const CsdfInput *const inputs;
     const size_t numOutputs;
     const CsdfOutput *const outputs;
+    const ActorContextExecution contextExecution;
+    void *const context;
+    // Actors with mutable firing state build it once per actor run from
+    // context, so concurrent runs of one graph do not share it.
+    const ActorRunContextFactory newRunContext;
+    const ActorRunContextDeleter deleteRunContext;
+    // Actors without execution or contextExecution take one pointer per
+    // token, in port order, so runs can hand them large tokens in place,
+    // see largeTokenThreshold in CsdfGraphRunOptions.
+    const ActorTokenExecution tokenExecution;
+    const bool stateless;
+    char _pad[7];
 } CsdfActor;
 
 #define CSDF_INPUT(type, rate)    \
@@ -48,4 +69,15 @@ typedef struct CsdfActor
         .tokenSize = sizeof(type) \
     }
 
+void csdf_actor_execute(const CsdfActor *actor, const void *consumed, void *produced);
+
+// The context an actor run passes to csdf_actor_execute_in, the actor's own
+// context unless it has a newRunContext.
+void *csdf_actor_new_run_context(const CsdfActor *actor);
+
+void csdf_actor_delete_run_context(const CsdfActor *actor, void *runContext);
+
+// Actors with a tokenExecution get pointers into consumed and produced.
+void csdf_actor_execute_in(const CsdfActor *actor, void *runContext, const void *consumed, void *produced);
+
 #endif // CSDF_ACTOR_H
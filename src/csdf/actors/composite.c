@@ -0,0 +1,206 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "composite.h"
+
+#include <csdf/repetition.h>
+#include <csdf/execution/buffer/stdlockfree.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The inner run of one actor run of a composite and its port buffers.
+typedef struct CompositeRun
+{
+    const CsdfCompositeActor *composite;
+    CsdfGraphRun *runData;
+    CsdfBuffer **inputPorts;
+    CsdfBuffer **outputPorts;
+} CompositeRun;
+
+static void composite_execute(void *runContext, const void *consumed, void *produced)
+{
+    CompositeRun *compositeRun = runContext;
+    const CsdfCompositeActor *composite = compositeRun->composite;
+    const uint8_t *consumedIt = consumed;
+    for (size_t portId = 0; portId < composite->actor.numInputs; portId++)
+    {
+        CsdfBuffer *buffer = compositeRun->inputPorts[portId];
+        const CsdfInput *input = composite->inputs + portId;
+        buffer->pushTokens(buffer, consumedIt, input->consumption);
+        consumedIt += input->consumption * input->tokenSize;
+    }
+
+    const CsdfSchedule *schedule = composite->schedule;
+    for (size_t entryId = 0; entryId < schedule->numEntries; entryId++)
+    {
+        const CsdfScheduleEntry *entry = schedule->entries + entryId;
+        CsdfActorRun *actorRun = compositeRun->runData->actorRuns[entry->actorId];
+        for (unsigned firing = 0; firing < entry->count; firing++)
+        {
+            fire(actorRun);
+        }
+    }
+
+    uint8_t *producedIt = produced;
+    for (size_t portId = 0; portId < composite->actor.numOutputs; portId++)
+    {
+        CsdfBuffer *buffer = compositeRun->outputPorts[portId];
+        const CsdfOutput *output = composite->outputs + portId;
+        buffer->popTokens(buffer, producedIt, output->production);
+        producedIt += output->production * output->tokenSize;
+    }
+}
+
+static void *new_composite_run(void *context)
+{
+    const CsdfCompositeActor *composite = context;
+    size_t numInputPorts = composite->actor.numInputs;
+    size_t numOutputPorts = composite->actor.numOutputs;
+    CsdfGraphRunOptions options = {.numRecordSelections = 0, .bufferedIterations = 1};
+    CompositeRun *compositeRun = malloc(sizeof(CompositeRun));
+    compositeRun->composite = composite;
+    compositeRun->runData = new_graph_run_with_options(composite->subgraph, CSDF_UNBOUNDED_ITERATIONS, &options);
+    compositeRun->inputPorts = malloc(numInputPorts * sizeof(CsdfBuffer *));
+    compositeRun->outputPorts = malloc(numOutputPorts * sizeof(CsdfBuffer *));
+    for (size_t portId = 0; portId < numInputPorts; portId++)
+    {
+        CsdfBuffer *buffer = new_stdlockfree_buffer(composite->portConnections + portId, composite->inputs[portId].consumption + 1);
+        compositeRun->inputPorts[portId] = buffer;
+        attach_input_port(compositeRun->runData, composite->innerInputs[portId], buffer);
+    }
+    for (size_t portId = 0; portId < numOutputPorts; portId++)
+    {
+        CsdfBuffer *buffer = new_stdlockfree_buffer(composite->portConnections + numInputPorts + portId, composite->outputs[portId].production + 1);
+        compositeRun->outputPorts[portId] = buffer;
+        attach_output_port(compositeRun->runData, composite->innerOutputs[portId], buffer);
+    }
+    return compositeRun;
+}
+
+static void delete_composite_run(void *runContext)
+{
+    CompositeRun *compositeRun = runContext;
+    delete_graph_run(compositeRun->runData);
+    for (size_t portId = 0; portId < compositeRun->composite->actor.numInputs; portId++)
+    {
+        delete_stdlockfree_buffer(compositeRun->inputPorts[portId]);
+    }
+    for (size_t portId = 0; portId < compositeRun->composite->actor.numOutputs; portId++)
+    {
+        delete_stdlockfree_buffer(compositeRun->outputPorts[portId]);
+    }
+    free(compositeRun->inputPorts);
+    free(compositeRun->outputPorts);
+    free(compositeRun);
+}
+
+static void init_port_connection(CsdfConnection *portConnection, CsdfOutputId source, CsdfInputId destination, size_t tokenSize)
+{
+    CsdfConnection connection = {
+        .source = source,
+        .destination = destination,
+        .tokenSize = tokenSize,
+        .numTokens = 0,
+        .initialTokens = NULL};
+    memcpy(portConnection, &connection, sizeof(CsdfConnection));
+}
+
+static void init_input_ports(CsdfCompositeActor *composite, size_t numInputPorts, const CsdfInputId *inputPorts)
+{
+    for (size_t portId = 0; portId < numInputPorts; portId++)
+    {
+        const CsdfInputId *inputPort = inputPorts + portId;
+        const CsdfInput *inner = composite->subgraph->actors[inputPort->actorId].inputs + inputPort->inputId;
+        unsigned consumption = inner->consumption * composite->repetitionVector[inputPort->actorId];
+        CsdfInput input = {.tokenSize = inner->tokenSize, .consumption = consumption};
+        memcpy(composite->inputs + portId, &input, sizeof(CsdfInput));
+
+        CsdfOutputId host = {.actorId = SIZE_MAX, .outputId = portId};
+        init_port_connection(composite->portConnections + portId, host, *inputPort, inner->tokenSize);
+        memcpy(composite->innerInputs + portId, inputPort, sizeof(CsdfInputId));
+    }
+}
+
+static void init_output_ports(CsdfCompositeActor *composite, size_t numOutputPorts, const CsdfOutputId *outputPorts)
+{
+    for (size_t portId = 0; portId < numOutputPorts; portId++)
+    {
+        const CsdfOutputId *outputPort = outputPorts + portId;
+        const CsdfOutput *inner = composite->subgraph->actors[outputPort->actorId].outputs + outputPort->outputId;
+        unsigned production = inner->production * composite->repetitionVector[outputPort->actorId];
+        CsdfOutput output = {.tokenSize = inner->tokenSize, .production = production};
+        memcpy(composite->outputs + portId, &output, sizeof(CsdfOutput));
+
+        CsdfInputId host = {.actorId = SIZE_MAX, .inputId = portId};
+        init_port_connection(composite->portConnections + composite->actor.numInputs + portId, *outputPort, host, inner->tokenSize);
+        memcpy(composite->innerOutputs + portId, outputPort, sizeof(CsdfOutputId));
+    }
+}
+
+CsdfCompositeActor *new_composite_actor(
+    const CsdfGraph *subgraph,
+    size_t numInputPorts, const CsdfInputId *inputPorts,
+    size_t numOutputPorts, const CsdfOutputId *outputPorts)
+{
+    if (!are_graph_ports(subgraph, numInputPorts, inputPorts, numOutputPorts, outputPorts))
+    {
+        return NULL;
+    }
+    unsigned *repetitionVector = malloc(subgraph->numActors * sizeof(unsigned));
+    if (!csdf_repetition_vector(subgraph, repetitionVector))
+    {
+        free(repetitionVector);
+        return NULL;
+    }
+    CsdfSchedule *schedule = new_sequential_schedule(subgraph, repetitionVector);
+    if (schedule == NULL)
+    {
+        free(repetitionVector);
+        return NULL;
+    }
+
+    CsdfCompositeActor *composite = malloc(sizeof(CsdfCompositeActor));
+    composite->inputs = malloc(numInputPorts * sizeof(CsdfInput));
+    composite->outputs = malloc(numOutputPorts * sizeof(CsdfOutput));
+    CsdfActor actor = {
+        .execution = NULL,
+        .numInputs = numInputPorts,
+        .inputs = composite->inputs,
+        .numOutputs = numOutputPorts,
+        .outputs = composite->outputs,
+        .contextExecution = composite_execute,
+        .context = composite,
+        .newRunContext = new_composite_run,
+        .deleteRunContext = delete_composite_run,
+        .stateless = false};
+    memcpy((void *)&composite->actor, &actor, sizeof(CsdfActor));
+
+    composite->subgraph = subgraph;
+    composite->repetitionVector = repetitionVector;
+    composite->schedule = schedule;
+    composite->innerInputs = malloc(numInputPorts * sizeof(CsdfInputId));
+    composite->innerOutputs = malloc(numOutputPorts * sizeof(CsdfOutputId));
+    composite->portConnections = malloc((numInputPorts + numOutputPorts) * sizeof(CsdfConnection));
+    init_input_ports(composite, numInputPorts, inputPorts);
+    init_output_ports(composite, numOutputPorts, outputPorts);
+    return composite;
+}
+
+void delete_composite_actor(CsdfCompositeActor *composite)
+{
+    free(composite->portConnections);
+    free(composite->innerOutputs);
+    free(composite->innerInputs);
+    delete_schedule(composite->schedule);
+    free(composite->repetitionVector);
+    free(composite->outputs);
+    free(composite->inputs);
+    free(composite);
+}
@@ -0,0 +1,44 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_ACTORS_COMPOSITE_H
+#define CSDF_ACTORS_COMPOSITE_H
+
+#include <csdf/actor.h>
+#include <csdf/graph.h>
+#include <csdf/schedule.h>
+#include <csdf/execution/graphrun.h>
+
+// An actor whose firing runs one iteration of an embedded graph along a
+// precomputed schedule. Each external input feeds an unconnected input of
+// the subgraph and each external output drains a subgraph output, so the
+// port rates are the inner rates times the inner repetition vector. Every
+// actor run of the composite builds its own inner run, whose buffers hold
+// a single iteration. Construction fails unless the ports pass
+// are_graph_ports.
+typedef struct CsdfCompositeActor
+{
+    const CsdfActor actor;
+    const CsdfGraph *subgraph;
+    CsdfInput *inputs;
+    CsdfOutput *outputs;
+    unsigned *repetitionVector;
+    CsdfSchedule *schedule;
+    CsdfInputId *innerInputs;
+    CsdfOutputId *innerOutputs;
+    CsdfConnection *portConnections;
+} CsdfCompositeActor;
+
+CsdfCompositeActor *new_composite_actor(
+    const CsdfGraph *subgraph,
+    size_t numInputPorts, const CsdfInputId *inputPorts,
+    size_t numOutputPorts, const CsdfOutputId *outputPorts);
+
+void delete_composite_actor(CsdfCompositeActor *composite);
+
+#endif // CSDF_ACTORS_COMPOSITE_H
@@ -0,0 +1,272 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "file.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SOURCE_READAHEAD (8u << 20)
+
+static void advise_readahead(CsdfFileSource *source)
+{
+    if (source->offset < source->advisedOffset && source->advisedOffset - source->offset > SOURCE_READAHEAD / 2)
+    {
+        return;
+    }
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = source->offset / pageSize * pageSize;
+    size_t end = start + SOURCE_READAHEAD < source->fileSize ? start + SOURCE_READAHEAD : source->fileSize;
+    madvise((void *)(source->mapping + start), end - start, MADV_WILLNEED);
+    if (start > source->droppedOffset && !source->loop)
+    {
+        madvise((void *)(source->mapping + source->droppedOffset), start - source->droppedOffset, MADV_DONTNEED);
+        source->droppedOffset = start;
+    }
+    source->advisedOffset = end;
+}
+
+static void read_tokens(CsdfFileSource *source, uint8_t *produced, size_t size)
+{
+    if (source->exhausted)
+    {
+        memset(produced, 0, size);
+        return;
+    }
+    while (size > 0)
+    {
+        if (source->offset == source->fileSize)
+        {
+            if (!source->loop || source->fileSize == 0)
+            {
+                source->exhausted = true;
+                memset(produced, 0, size);
+                return;
+            }
+            source->offset = 0;
+            source->advisedOffset = 0;
+        }
+        advise_readahead(source);
+        size_t available = source->fileSize - source->offset;
+        size_t copied = size < available ? size : available;
+        memcpy(produced, source->mapping + source->offset, copied);
+        source->offset += copied;
+        produced += copied;
+        size -= copied;
+    }
+}
+
+static void file_source_execute(void *context, const void *consumed, void *produced)
+{
+    (void)consumed;
+    CsdfFileSource *source = context;
+    read_tokens(source, produced, source->output.production * source->output.tokenSize);
+}
+
+CsdfFileSource *new_file_source(const char *path, size_t tokenSize, unsigned production, bool loop)
+{
+    if (tokenSize == 0)
+    {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return NULL;
+    }
+    size_t fileSize = (size_t)fileStat.st_size / tokenSize * tokenSize;
+    const uint8_t *mapping = NULL;
+    if (fileSize > 0)
+    {
+        void *fileMapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (fileMapping == MAP_FAILED)
+        {
+            close(fd);
+            return NULL;
+        }
+        madvise(fileMapping, fileSize, MADV_SEQUENTIAL);
+        mapping = fileMapping;
+    }
+    close(fd);
+
+    CsdfFileSource *source = malloc(sizeof(CsdfFileSource));
+    CsdfOutput output = {.tokenSize = tokenSize, .production = production};
+    memcpy((void *)&source->output, &output, sizeof(CsdfOutput));
+    CsdfActor actor = {
+        .execution = NULL,
+        .numInputs = 0,
+        .inputs = NULL,
+        .numOutputs = 1,
+        .outputs = &source->output,
+        .contextExecution = file_source_execute,
+        .context = source};
+    memcpy((void *)&source->actor, &actor, sizeof(CsdfActor));
+    source->mapping = mapping;
+    source->fileSize = fileSize;
+    source->offset = 0;
+    source->advisedOffset = 0;
+    source->droppedOffset = 0;
+    source->loop = loop;
+    source->exhausted = false;
+    return source;
+}
+
+void delete_file_source(CsdfFileSource *source)
+{
+    if (source->mapping != NULL)
+    {
+        munmap((void *)source->mapping, source->fileSize);
+    }
+    free(source);
+}
+
+size_t file_source_num_tokens(const CsdfFileSource *source)
+{
+    return source->fileSize / source->output.tokenSize;
+}
+
+// Retries interrupted and partial writes.
+static bool write_all(int fd, const uint8_t *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written < 0)
+        {
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+static void write_batch(CsdfFileSink *sink)
+{
+    if (sink->batchUsed > 0 && !sink->failed)
+    {
+        sink->failed = !write_all(sink->fd, sink->batch, sink->batchUsed);
+    }
+    sink->batchUsed = 0;
+}
+
+static void file_sink_execute(void *context, const void *consumed, void *produced)
+{
+    (void)produced;
+    CsdfFileSink *sink = context;
+    const uint8_t *tokens = consumed;
+    size_t size = sink->input.consumption * sink->input.tokenSize;
+    if (sink->batchUsed + size > sink->batchSize)
+    {
+        write_batch(sink);
+    }
+    if (size > sink->batchSize)
+    {
+        sink->failed = sink->failed || !write_all(sink->fd, tokens, size);
+        return;
+    }
+    memcpy(sink->batch + sink->batchUsed, tokens, size);
+    sink->batchUsed += size;
+}
+
+CsdfFileSink *new_file_sink(const char *path, size_t tokenSize, unsigned consumption, size_t batchSize)
+{
+    if (tokenSize == 0)
+    {
+        return NULL;
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    CsdfFileSink *sink = malloc(sizeof(CsdfFileSink));
+    CsdfInput input = {.tokenSize = tokenSize, .consumption = consumption};
+    memcpy((void *)&sink->input, &input, sizeof(CsdfInput));
+    CsdfActor actor = {
+        .execution = NULL,
+        .numInputs = 1,
+        .inputs = &sink->input,
+        .numOutputs = 0,
+        .outputs = NULL,
+        .contextExecution = file_sink_execute,
+        .context = sink};
+    memcpy((void *)&sink->actor, &actor, sizeof(CsdfActor));
+    sink->batch = malloc(batchSize);
+    sink->batchSize = batchSize;
+    sink->batchUsed = 0;
+    sink->fd = fd;
+    sink->failed = false;
+    return sink;
+}
+
+bool delete_file_sink(CsdfFileSink *sink)
+{
+    write_batch(sink);
+    bool closed = close(sink->fd) == 0;
+    bool succeeded = !sink->failed && closed;
+    free(sink->batch);
+    free(sink);
+    return succeeded;
+}
+
+#else
+
+CsdfFileSource *new_file_source(const char *path, size_t tokenSize, unsigned production, bool loop)
+{
+    (void)path;
+    (void)tokenSize;
+    (void)production;
+    (void)loop;
+    return NULL;
+}
+
+void delete_file_source(CsdfFileSource *source)
+{
+    (void)source;
+}
+
+size_t file_source_num_tokens(const CsdfFileSource *source)
+{
+    (void)source;
+    return 0;
+}
+
+CsdfFileSink *new_file_sink(const char *path, size_t tokenSize, unsigned consumption, size_t batchSize)
+{
+    (void)path;
+    (void)tokenSize;
+    (void)consumption;
+    (void)batchSize;
+    return NULL;
+}
+
+bool delete_file_sink(CsdfFileSink *sink)
+{
+    (void)sink;
+    return false;
+}
+
+#endif
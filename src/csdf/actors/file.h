@@ -0,0 +1,58 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_ACTORS_FILE_H
+#define CSDF_ACTORS_FILE_H
+
+#include <csdf/actor.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Streams fixed-size tokens from a memory-mapped file. Without looping, the
+// firings past the end of the file produce zero tokens and set exhausted.
+// Pages already read are dropped unless the source loops.
+typedef struct CsdfFileSource
+{
+    const CsdfOutput output;
+    const CsdfActor actor;
+    const uint8_t *mapping;
+    size_t fileSize;
+    size_t offset;
+    size_t advisedOffset;
+    size_t droppedOffset;
+    bool loop;
+    bool exhausted;
+    char _pad[6];
+} CsdfFileSource;
+
+// Appends consumed tokens to a file through a write batch.
+typedef struct CsdfFileSink
+{
+    const CsdfInput input;
+    const CsdfActor actor;
+    uint8_t *batch;
+    size_t batchSize;
+    size_t batchUsed;
+    int fd;
+    bool failed;
+    char _pad[3];
+} CsdfFileSink;
+
+// Both constructors return NULL for a zero tokenSize.
+CsdfFileSource *new_file_source(const char *path, size_t tokenSize, unsigned production, bool loop);
+
+void delete_file_source(CsdfFileSource *source);
+
+size_t file_source_num_tokens(const CsdfFileSource *source);
+
+CsdfFileSink *new_file_sink(const char *path, size_t tokenSize, unsigned consumption, size_t batchSize);
+
+bool delete_file_sink(CsdfFileSink *sink);
+
+#endif // CSDF_ACTORS_FILE_H
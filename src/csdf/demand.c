@@ -0,0 +1,85 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "demand.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static uint64_t ceil_div(uint64_t numerator, uint64_t denominator)
+{
+    return (numerator + denominator - 1) / denominator;
+}
+
+static bool raise_firings(unsigned *firings, const unsigned *maxFirings, size_t actorId, uint64_t numFirings, bool *changed)
+{
+    if (numFirings <= firings[actorId])
+    {
+        return true;
+    }
+    if (numFirings > maxFirings[actorId])
+    {
+        return false;
+    }
+    firings[actorId] = (unsigned)numFirings;
+    *changed = true;
+    return true;
+}
+
+// Raises the producer to cover what the consumer pops and then the consumer
+// to leave no more than the capacity on the connection.
+static bool balance_connection(
+    const CsdfGraph *graph, const unsigned *numQueued, const unsigned *capacities,
+    const unsigned *maxFirings, size_t connectionId, unsigned *firings, bool *changed)
+{
+    const CsdfConnection *connection = graph->connections + connectionId;
+    size_t source = connection->source.actorId;
+    size_t destination = connection->destination.actorId;
+    uint64_t production = graph->actors[source].outputs[connection->source.outputId].production;
+    uint64_t consumption = graph->actors[destination].inputs[connection->destination.inputId].consumption;
+    uint64_t queued = numQueued[connectionId];
+
+    uint64_t consumed = consumption * firings[destination];
+    if (consumed > queued && !raise_firings(firings, maxFirings, source, ceil_div(consumed - queued, production), changed))
+    {
+        return false;
+    }
+    uint64_t available = queued + production * firings[source];
+    if (capacities != NULL && available > capacities[connectionId] + consumption * firings[destination])
+    {
+        return raise_firings(firings, maxFirings, destination, ceil_div(available - capacities[connectionId], consumption), changed);
+    }
+    return true;
+}
+
+bool firing_demand(
+    const CsdfGraph *graph, const unsigned *numQueued, const unsigned *capacities,
+    const unsigned *maxFirings, CsdfOutputId target, unsigned numTargetTokens, unsigned *firings)
+{
+    memset(firings, 0, graph->numActors * sizeof(unsigned));
+    unsigned production = graph->actors[target.actorId].outputs[target.outputId].production;
+    bool changed = false;
+    if (!raise_firings(firings, maxFirings, target.actorId, ceil_div(numTargetTokens, production), &changed))
+    {
+        return false;
+    }
+    // Firings only grow, so the sweeps settle on the least demand or exceed
+    // maxFirings.
+    while (changed)
+    {
+        changed = false;
+        for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+        {
+            if (!balance_connection(graph, numQueued, capacities, maxFirings, connectionId, firings, &changed))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_DEMAND_H
+#define CSDF_DEMAND_H
+
+#include "graph.h"
+
+#include <stdbool.h>
+
+// The fewest firings per actor after which target has produced
+// numTargetTokens more tokens, starting from numQueued tokens on each
+// connection. Producers fire until their consumers have enough tokens and,
+// when capacities is not NULL, consumers fire until the tokens left on a
+// connection fit its capacity. Actors that neither feed the target nor
+// drain an output of such an actor never fire. Returns false when an actor
+// would need more firings than maxFirings allows.
+bool firing_demand(
+    const CsdfGraph *graph, const unsigned *numQueued, const unsigned *capacities,
+    const unsigned *maxFirings, CsdfOutputId target, unsigned numTargetTokens, unsigned *firings);
+
+#endif // CSDF_DEMAND_H
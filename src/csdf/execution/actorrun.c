@@ -7,74 +7,140 @@ Copyright (c) 2023 Slaven Glumac
 ****************************************************************************/
 
 #include "actorrun.h"
+#include "latency.h"
+#include "buffer/pooled.h"
+#include "buffer/tokenpool.h"
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
-static void record_results(CsdfActorRun *runData)
+#define SHARED_CHUNK_HANDLES 64
+
+static void record_results(CsdfActorRun *runData, const uint8_t *produced)
 {
-    uint8_t *produced = runData->produced;
     CsdfRecordData *recordData = runData->recordData;
-    if (recordData->on_token_produced != NULL)
+    if (recordData != NULL && recordData->on_token_produced != NULL)
     {
         recordData->on_token_produced(produced, recordData);
     }
 }
 
-static void consume(CsdfActorRun *runData)
+static void consume(CsdfActorRun *runData, uint8_t *consumed)
 {
-    uint8_t *consumed = runData->consumed;
     const CsdfActor *actor = runData->actor;
     for (size_t dstPortId = 0; dstPortId < actor->numInputs; dstPortId++)
     {
         CsdfBuffer *buffer = runData->inputBuffers[dstPortId];
         const CsdfInput *dstPort = actor->inputs + dstPortId;
-        uint8_t *token = malloc(dstPort->tokenSize);
-        for (size_t tokenId = 0; tokenId < dstPort->consumption; tokenId++)
+        buffer->popTokens(buffer, consumed, dstPort->consumption);
+        consumed += dstPort->consumption * dstPort->tokenSize;
+    }
+}
+
+static void push_copies(CsdfBuffer **buffers, size_t numBuffers, const CsdfOutput *output, const uint8_t *tokens)
+{
+    for (size_t bufferId = 0; bufferId < numBuffers; bufferId++)
+    {
+        CsdfBuffer *buffer = buffers[bufferId];
+        buffer->pushTokens(buffer, tokens, output->production);
+    }
+}
+
+// The pool shared by the buffers of an output and how many of them use it.
+// Buffers attached as ports take copies.
+static CsdfTokenPool *output_pool(const CsdfActorRun *runData, size_t outputId, unsigned *numShared)
+{
+    CsdfTokenPool *pool = NULL;
+    *numShared = 0;
+    for (size_t bufferId = 0; bufferId < runData->numOutputBuffers[outputId]; bufferId++)
+    {
+        CsdfBuffer *buffer = runData->outputBuffers[outputId][bufferId];
+        if (buffer->pool != NULL)
         {
-            buffer->pop(buffer, token);
-            memcpy(consumed, token, dstPort->tokenSize);
-            consumed += dstPort->tokenSize;
+            pool = buffer->pool;
+            (*numShared)++;
         }
-        free(token);
     }
+    return pool;
 }
 
-static void produce(CsdfActorRun *runData)
+// Handles are acquired in chunks so each buffer publishes a chunk at once.
+// has_output_space has checked that the pool has a slot for every token.
+static void push_shared(CsdfBuffer **buffers, size_t numBuffers, CsdfTokenPool *pool, unsigned numShared, const CsdfOutput *output, const uint8_t *tokens)
 {
+    uint32_t handles[SHARED_CHUNK_HANDLES];
+    for (unsigned firstId = 0; firstId < output->production; firstId += SHARED_CHUNK_HANDLES)
+    {
+        unsigned remaining = output->production - firstId;
+        unsigned numChunk = remaining < SHARED_CHUNK_HANDLES ? remaining : SHARED_CHUNK_HANDLES;
+        const uint8_t *chunk = tokens + (size_t)firstId * output->tokenSize;
+        bool acquired = acquire_tokens(pool, numChunk, numShared, handles);
+        assert(acquired);
+        (void)acquired;
+        for (unsigned handleId = 0; handleId < numChunk; handleId++)
+        {
+            memcpy(token_slot(pool, handles[handleId]), chunk + handleId * output->tokenSize, output->tokenSize);
+        }
+        for (size_t bufferId = 0; bufferId < numBuffers; bufferId++)
+        {
+            CsdfBuffer *buffer = buffers[bufferId];
+            buffer->pushTokens(buffer, buffer->pool != NULL ? (const uint8_t *)handles : chunk, numChunk);
+        }
+    }
+}
 
+static void produce(CsdfActorRun *runData, const uint8_t *produced)
+{
     const CsdfActor *actor = runData->actor;
-    uint8_t *produced = runData->produced;
-    uint8_t *producedIt = produced;
+    const uint8_t *producedIt = produced;
     const CsdfOutput *output = actor->outputs;
 
     for (size_t outputId = 0; outputId < actor->numOutputs; outputId++, output++)
     {
-        uint8_t *token = NULL;
+        CsdfBuffer **buffers = runData->outputBuffers[outputId];
+        size_t numBuffers = runData->numOutputBuffers[outputId];
+        unsigned numShared;
+        CsdfTokenPool *pool = output_pool(runData, outputId, &numShared);
+        if (pool == NULL)
+        {
+            push_copies(buffers, numBuffers, output, producedIt);
+        }
+        else
+        {
+            push_shared(buffers, numBuffers, pool, numShared, output, producedIt);
+        }
+        producedIt += output->production * output->tokenSize;
+    }
+}
+
+bool has_output_space(CsdfActorRun *runData)
+{
+    const CsdfActor *actor = runData->actor;
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
         for (size_t bufferId = 0; bufferId < runData->numOutputBuffers[outputId]; bufferId++)
         {
             CsdfBuffer *buffer = runData->outputBuffers[outputId][bufferId];
-            token = producedIt;
-            for (size_t tokenId = 0; tokenId < output->production; tokenId++)
+            if (!buffer->hasSpace(buffer, actor->outputs[outputId].production))
             {
-                buffer->push(buffer, token);
-
-                token += output->tokenSize;
+                return false;
             }
         }
-        producedIt = token;
+        // A pool short of slots holds the producer back like a full buffer.
+        unsigned numShared;
+        CsdfTokenPool *pool = output_pool(runData, outputId, &numShared);
+        if (pool != NULL && token_pool_free(pool) < actor->outputs[outputId].production)
+        {
+            return false;
+        }
     }
+    return true;
 }
 
-bool can_fire(CsdfActorRun *runData)
+bool has_input_tokens(CsdfActorRun *runData)
 {
     const CsdfActor *actor = runData->actor;
-
-    if (runData->fireCount >= runData->maxFireCount)
-    {
-        return false;
-    }
-
     for (size_t dstPortId = 0; dstPortId < actor->numInputs; dstPortId++)
     {
 
@@ -82,7 +148,7 @@ bool can_fire(CsdfActorRun *runData)
 
         const CsdfInput *dstPort = &actor->inputs[dstPortId];
 
-        if (dstPort->consumption > buffer->numberOfTokens(buffer))
+        if (!buffer->hasTokens(buffer, dstPort->consumption))
         {
 
             return false;
@@ -91,45 +157,300 @@ bool can_fire(CsdfActorRun *runData)
     return true;
 }
 
-void fire(CsdfActorRun *runData)
+static bool is_closed_buffer(CsdfBuffer *buffer)
+{
+    return buffer->closed != NULL && buffer->closed(buffer);
+}
+
+bool can_never_fire(CsdfActorRun *runData)
 {
-    consume(runData);
+    const CsdfActor *actor = runData->actor;
+    for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
+    {
+        CsdfBuffer *buffer = runData->inputBuffers[inputId];
+        if (is_closed_buffer(buffer) && !buffer->hasTokens(buffer, actor->inputs[inputId].consumption))
+        {
+            return true;
+        }
+    }
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        for (size_t bufferId = 0; bufferId < runData->numOutputBuffers[outputId]; bufferId++)
+        {
+            CsdfBuffer *buffer = runData->outputBuffers[outputId][bufferId];
+            if (is_closed_buffer(buffer) && !buffer->hasSpace(buffer, actor->outputs[outputId].production))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
 
-    runData->actor->execution(runData->consumed, runData->produced);
+bool can_fire(CsdfActorRun *runData)
+{
+    if (runData->maxFireCount != CSDF_UNBOUNDED_FIRE_COUNT && runData->fireCount >= runData->maxFireCount)
+    {
+        return false;
+    }
 
-    produce(runData);
+    return has_input_tokens(runData) && has_output_space(runData);
+}
 
-    record_results(runData);
+uint64_t fire_consume(CsdfActorRun *runData, uint8_t *consumed)
+{
+    // Stamps are taken before the pop hands their slots back to the producer.
+    uint64_t origin = runData->latency != NULL ? take_origin(runData->latency, runData->actor) : CSDF_NO_ORIGIN;
+    consume(runData, consumed);
+    return origin;
+}
+
+void fire_produce(CsdfActorRun *runData, const uint8_t *produced, uint64_t origin)
+{
+    if (runData->latency != NULL)
+    {
+        stamp_outputs(runData->latency, origin);
+    }
+    produce(runData, produced);
+
+    record_results(runData, produced);
 
     runData->fireCount++;
 }
 
-CsdfActorRun *new_actor_run(
-    const CsdfActor *actor, CsdfRecordData *recordData,
-    CsdfBuffer **inputBuffers, CsdfBuffer ***outputBuffers,
-    size_t *numOutputBuffers, unsigned maxFireCount)
+// Pooled inputs hand over their slots, other inputs are copied into the
+// consumed scratch.
+static void consume_references(CsdfActorRun *runData)
+{
+    const CsdfActor *actor = runData->actor;
+    uint8_t *consumed = runData->consumed;
+    size_t tokenId = 0;
+    for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
+    {
+        CsdfBuffer *buffer = runData->inputBuffers[inputId];
+        const CsdfInput *input = actor->inputs + inputId;
+        if (buffer->pool != NULL)
+        {
+            pop_token_handles(buffer, runData->consumedHandles + tokenId, input->consumption);
+        }
+        else
+        {
+            buffer->popTokens(buffer, consumed, input->consumption);
+        }
+        for (unsigned portTokenId = 0; portTokenId < input->consumption; portTokenId++, tokenId++)
+        {
+            runData->consumedTokens[tokenId] = buffer->pool != NULL
+                                                   ? token_slot(buffer->pool, runData->consumedHandles[tokenId])
+                                                   : consumed + portTokenId * input->tokenSize;
+        }
+        consumed += input->consumption * input->tokenSize;
+    }
+}
+
+static void release_references(CsdfActorRun *runData)
+{
+    const CsdfActor *actor = runData->actor;
+    size_t tokenId = 0;
+    for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
+    {
+        CsdfTokenPool *pool = runData->inputBuffers[inputId]->pool;
+        for (unsigned portTokenId = 0; portTokenId < actor->inputs[inputId].consumption; portTokenId++, tokenId++)
+        {
+            if (pool != NULL)
+            {
+                release_token(pool, runData->consumedHandles[tokenId]);
+            }
+        }
+    }
+}
+
+// Pooled outputs are written straight into their slots, other outputs into
+// the produced scratch.
+static void acquire_references(CsdfActorRun *runData)
+{
+    const CsdfActor *actor = runData->actor;
+    uint8_t *produced = runData->produced;
+    size_t tokenId = 0;
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        const CsdfOutput *output = actor->outputs + outputId;
+        unsigned numShared;
+        CsdfTokenPool *pool = output_pool(runData, outputId, &numShared);
+        if (pool != NULL)
+        {
+            bool acquired = acquire_tokens(pool, output->production, numShared, runData->producedHandles + tokenId);
+            assert(acquired);
+            (void)acquired;
+        }
+        for (unsigned portTokenId = 0; portTokenId < output->production; portTokenId++, tokenId++)
+        {
+            runData->producedTokens[tokenId] = pool != NULL
+                                                   ? token_slot(pool, runData->producedHandles[tokenId])
+                                                   : produced + portTokenId * output->tokenSize;
+        }
+        produced += output->production * output->tokenSize;
+    }
+}
+
+// Pooled tokens are gathered into the produced scratch only for records
+// and for buffers attached as ports.
+static void produce_references(CsdfActorRun *runData, bool gather)
+{
+    const CsdfActor *actor = runData->actor;
+    uint8_t *produced = runData->produced;
+    size_t tokenId = 0;
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        const CsdfOutput *output = actor->outputs + outputId;
+        CsdfBuffer **buffers = runData->outputBuffers[outputId];
+        size_t numBuffers = runData->numOutputBuffers[outputId];
+        unsigned numShared;
+        CsdfTokenPool *pool = output_pool(runData, outputId, &numShared);
+        const uint32_t *handles = runData->producedHandles + tokenId;
+        if (pool != NULL && (gather || numShared < numBuffers))
+        {
+            for (unsigned portTokenId = 0; portTokenId < output->production; portTokenId++)
+            {
+                memcpy(produced + portTokenId * output->tokenSize, token_slot(pool, handles[portTokenId]), output->tokenSize);
+            }
+        }
+        for (size_t bufferId = 0; bufferId < numBuffers; bufferId++)
+        {
+            CsdfBuffer *buffer = buffers[bufferId];
+            buffer->pushTokens(buffer, buffer->pool != NULL ? (const uint8_t *)handles : produced, output->production);
+        }
+        produced += output->production * output->tokenSize;
+        tokenId += output->production;
+    }
+}
+
+static void fire_references(CsdfActorRun *runData)
+{
+    uint64_t origin = runData->latency != NULL ? take_origin(runData->latency, runData->actor) : CSDF_NO_ORIGIN;
+    consume_references(runData);
+    acquire_references(runData);
+    runData->actor->tokenExecution(runData->context, runData->consumedTokens, runData->producedTokens);
+    release_references(runData);
+    if (runData->latency != NULL)
+    {
+        stamp_outputs(runData->latency, origin);
+    }
+    CsdfRecordData *recordData = runData->recordData;
+    produce_references(runData, recordData != NULL && recordData->on_token_produced != NULL);
+    record_results(runData, runData->produced);
+    runData->fireCount++;
+}
+
+void fire(CsdfActorRun *runData)
+{
+    uint64_t beginNanoseconds = runData->traceBuffer != NULL ? trace_timestamp() : 0;
+    unsigned fireCount = runData->fireCount;
+
+    if (runData->consumedTokens != NULL)
+    {
+        fire_references(runData);
+    }
+    else
+    {
+        uint64_t origin = fire_consume(runData, runData->consumed);
+        csdf_actor_execute_in(runData->actor, runData->context, runData->consumed, runData->produced);
+        fire_produce(runData, runData->produced, origin);
+    }
+
+    if (runData->traceBuffer != NULL)
+    {
+        trace_firing(runData->traceBuffer, runData->actor, fireCount, beginNanoseconds);
+    }
+}
+
+static size_t consumed_size(const CsdfActor *actor)
 {
-    CsdfActorRun *actorRun = malloc(sizeof(CsdfActorRun));
-    actorRun->actor = actor;
     size_t sizeConsumedTokens = 0;
     for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
     {
         const CsdfInput *input = &actor->inputs[inputId];
         sizeConsumedTokens += input->consumption * input->tokenSize;
     }
-    actorRun->consumed = malloc(sizeConsumedTokens);
+    return sizeConsumedTokens;
+}
 
+static size_t produced_size(const CsdfActor *actor)
+{
     size_t sizeProducedTokens = 0;
     for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
     {
         const CsdfOutput *output = &actor->outputs[outputId];
         sizeProducedTokens += output->production * output->tokenSize;
     }
+    return sizeProducedTokens;
+}
+
+static bool executes_tokens(const CsdfActor *actor)
+{
+    return actor->execution == NULL && actor->contextExecution == NULL && actor->tokenExecution != NULL;
+}
+
+static size_t count_consumed(const CsdfActor *actor)
+{
+    size_t numConsumed = 0;
+    for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
+    {
+        numConsumed += actor->inputs[inputId].consumption;
+    }
+    return numConsumed;
+}
+
+static size_t count_produced(const CsdfActor *actor)
+{
+    size_t numProduced = 0;
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        numProduced += actor->outputs[outputId].production;
+    }
+    return numProduced;
+}
+
+size_t actor_run_scratch_bytes(const CsdfActor *actor)
+{
+    size_t referenceBytes = executes_tokens(actor)
+                                ? (count_consumed(actor) + count_produced(actor)) * (sizeof(void *) + sizeof(uint32_t))
+                                : 0;
+    return consumed_size(actor) + produced_size(actor) + referenceBytes;
+}
+
+CsdfActorRun *new_actor_run(
+    const CsdfActor *actor, CsdfRecordData *recordData,
+    CsdfBuffer **inputBuffers, CsdfBuffer ***outputBuffers,
+    size_t *numOutputBuffers, unsigned maxFireCount)
+{
+    CsdfActorRun *actorRun = malloc(sizeof(CsdfActorRun));
+    actorRun->actor = actor;
+    actorRun->context = csdf_actor_new_run_context(actor);
+    size_t sizeConsumedTokens = consumed_size(actor);
+    actorRun->consumed = malloc(sizeConsumedTokens);
+    actorRun->consumedSize = sizeConsumedTokens;
+
+    size_t sizeProducedTokens = produced_size(actor);
     actorRun->produced = malloc(sizeProducedTokens);
+    actorRun->producedSize = sizeProducedTokens;
     actorRun->recordData = recordData;
+    actorRun->traceBuffer = NULL;
+    actorRun->latency = NULL;
     actorRun->inputBuffers = inputBuffers;
     actorRun->outputBuffers = outputBuffers;
     actorRun->numOutputBuffers = numOutputBuffers;
+    actorRun->consumedTokens = NULL;
+    actorRun->producedTokens = NULL;
+    actorRun->consumedHandles = NULL;
+    actorRun->producedHandles = NULL;
+    if (executes_tokens(actor))
+    {
+        // One spare entry keeps the allocations valid for actors without tokens.
+        actorRun->consumedTokens = malloc((count_consumed(actor) + 1) * sizeof(void *));
+        actorRun->producedTokens = malloc((count_produced(actor) + 1) * sizeof(void *));
+        actorRun->consumedHandles = malloc((count_consumed(actor) + 1) * sizeof(uint32_t));
+        actorRun->producedHandles = malloc((count_produced(actor) + 1) * sizeof(uint32_t));
+    }
     actorRun->maxFireCount = maxFireCount;
     actorRun->fireCount = 0;
     return actorRun;
@@ -137,6 +458,11 @@ CsdfActorRun *new_actor_run(
 
 void delete_actor_run(CsdfActorRun *runData)
 {
+    csdf_actor_delete_run_context(runData->actor, runData->context);
+    free(runData->producedHandles);
+    free(runData->consumedHandles);
+    free(runData->producedTokens);
+    free((void *)runData->consumedTokens);
     free(runData->produced);
     free(runData->consumed);
     free(runData);
@@ -10,21 +10,38 @@ Copyright (c) 2023 Slaven Glumac
 #define CSDF_EXECUTION_ACTORRUN_H
 
 #include "buffer.h"
+#include "trace.h"
 
 #include <csdf/actor.h>
 #include <csdf/record.h>
 
+#include <limits.h>
 #include <stdbool.h>
 
+#define CSDF_UNBOUNDED_FIRE_COUNT UINT_MAX
+
+typedef struct CsdfActorLatency CsdfActorLatency;
+
 typedef struct CsdfActorRun
 {
     const CsdfActor *actor;
+    void *context;
     uint8_t *consumed;
     uint8_t *produced;
+    size_t consumedSize;
+    size_t producedSize;
     CsdfRecordData *recordData;
+    CsdfTraceBuffer *traceBuffer;
+    CsdfActorLatency *latency;
     CsdfBuffer **inputBuffers;
     CsdfBuffer ***outputBuffers;
     size_t *numOutputBuffers;
+    // Actors with a tokenExecution get a pointer and, for pooled buffers,
+    // a pool handle per consumed and produced token. NULL otherwise.
+    const void **consumedTokens;
+    void **producedTokens;
+    uint32_t *consumedHandles;
+    uint32_t *producedHandles;
     unsigned maxFireCount;
     unsigned fireCount;
 } CsdfActorRun;
@@ -33,8 +50,29 @@ CsdfActorRun *new_actor_run(const CsdfActor *actor, CsdfRecordData *recordData,
 
 void delete_actor_run(CsdfActorRun *runData);
 
+// The consumed and produced scratch bytes of one firing.
+size_t actor_run_scratch_bytes(const CsdfActor *actor);
+
+bool has_input_tokens(CsdfActorRun *runData);
+
+bool has_output_space(CsdfActorRun *runData);
+
 bool can_fire(CsdfActorRun *runData);
 
+// Whether a closed buffer lacks the tokens or space of the next firing,
+// which then never becomes possible, see closed in buffer.h.
+bool can_never_fire(CsdfActorRun *runData);
+
+// Actors with a tokenExecution read pooled input tokens and write pooled
+// output tokens in their pool slots, see largeTokenThreshold.
 void fire(CsdfActorRun *runData);
 
+// The two halves of fire() for callers that execute the actor themselves
+// with their own token scratch, which copies pooled tokens. fire_consume
+// returns the origin timestamp fire_produce passes on when latency is
+// tracked, see latency.h.
+uint64_t fire_consume(CsdfActorRun *runData, uint8_t *consumed);
+
+void fire_produce(CsdfActorRun *runData, const uint8_t *produced, uint64_t origin);
+
 #endif // CSDF_EXECUTION_ACTORRUN_H
@@ -0,0 +1,135 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "batch.h"
+#include "sequential.h"
+
+#include <csdf/repetition.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CsdfBatchWorker
+{
+    const CsdfBatch *batch;
+    const size_t *resultSizes;
+    size_t firstInstance;
+    size_t endInstance;
+    void *threadData;
+} CsdfBatchWorker;
+
+static size_t result_size(const CsdfGraph *graph, unsigned numIterations, const unsigned *repetitionVector, const CsdfOutputId *result)
+{
+    const CsdfOutput *output = graph->actors[result->actorId].outputs + result->outputId;
+    return (size_t)numIterations * repetitionVector[result->actorId] * output->production * output->tokenSize;
+}
+
+bool batch_result_sizes(const CsdfBatch *batch, size_t *resultSizes)
+{
+    const CsdfGraph *graph = batch->graph;
+    unsigned *repetitionVector = malloc(graph->numActors * sizeof(unsigned));
+    bool consistent = csdf_repetition_vector(graph, repetitionVector);
+    for (size_t resultId = 0; resultId < batch->numResults && consistent; resultId++)
+    {
+        resultSizes[resultId] = result_size(graph, batch->numIterations, repetitionVector, batch->results + resultId);
+    }
+    free(repetitionVector);
+    return consistent;
+}
+
+static CsdfGraphRun *new_batch_graph_run(const CsdfBatch *batch)
+{
+    CsdfRecordSelection *recordSelections = malloc(batch->numResults * sizeof(CsdfRecordSelection));
+    for (size_t resultId = 0; resultId < batch->numResults; resultId++)
+    {
+        CsdfRecordSelection recordSelection = {
+            .output = batch->results[resultId],
+            .option = {.mode = CSDF_RECORD_FULL}};
+        memcpy(recordSelections + resultId, &recordSelection, sizeof(CsdfRecordSelection));
+    }
+    CsdfGraphRunOptions options = {.numRecordSelections = batch->numResults, .recordSelections = recordSelections};
+    CsdfGraphRun *runData = new_graph_run_with_options(batch->graph, batch->numIterations, &options);
+    free(recordSelections);
+    return runData;
+}
+
+static bool run_instances(void *taskData)
+{
+    CsdfBatchWorker *worker = taskData;
+    const CsdfBatch *batch = worker->batch;
+    const size_t numConnections = batch->graph->numConnections;
+    bool completed = true;
+
+    CsdfGraphRun *runData = new_batch_graph_run(batch);
+    if (runData == NULL)
+    {
+        return false;
+    }
+    for (size_t instanceId = worker->firstInstance; instanceId < worker->endInstance && completed; instanceId++)
+    {
+        const void *const *initialTokens = batch->initialTokens != NULL
+                                               ? batch->initialTokens + instanceId * numConnections
+                                               : NULL;
+        reset_graph_run_with_tokens(runData, initialTokens);
+        completed = sequential_run(runData);
+        for (size_t resultId = 0; resultId < batch->numResults && completed; resultId++)
+        {
+            const CsdfOutputId *result = batch->results + resultId;
+            uint8_t *resultTokens = (uint8_t *)batch->resultTokens[resultId] + instanceId * worker->resultSizes[resultId];
+            copy_recorded_tokens(runData->actorRuns[result->actorId]->recordData, result->outputId, resultTokens);
+        }
+    }
+    delete_graph_run(runData);
+    return completed;
+}
+
+bool batch_run(const CsdfThreading *threading, size_t numWorkers, const CsdfBatch *batch)
+{
+    if (numWorkers == 0 && batch->numInstances > 0)
+    {
+        return false;
+    }
+    size_t *resultSizes = malloc(batch->numResults * sizeof(size_t));
+    if (!batch_result_sizes(batch, resultSizes))
+    {
+        free(resultSizes);
+        return false;
+    }
+
+    if (numWorkers > batch->numInstances)
+    {
+        numWorkers = batch->numInstances;
+    }
+    CsdfBatchWorker *workers = malloc(numWorkers * sizeof(CsdfBatchWorker));
+    size_t numStarted = 0;
+    bool completed = true;
+    for (size_t workerId = 0; workerId < numWorkers; workerId++)
+    {
+        CsdfBatchWorker *worker = workers + workerId;
+        worker->batch = batch;
+        worker->resultSizes = resultSizes;
+        worker->firstInstance = batch->numInstances * workerId / numWorkers;
+        worker->endInstance = batch->numInstances * (workerId + 1) / numWorkers;
+        worker->threadData = malloc(threading->threadDataSize);
+        if (!threading->createThread(worker->threadData, run_instances, worker))
+        {
+            free(worker->threadData);
+            completed = false;
+            break;
+        }
+        numStarted++;
+    }
+    for (size_t workerId = 0; workerId < numStarted; workerId++)
+    {
+        completed = threading->joinThread(workers[workerId].threadData) && completed;
+        free(workers[workerId].threadData);
+    }
+    free(workers);
+    free(resultSizes);
+    return completed;
+}
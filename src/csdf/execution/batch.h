@@ -0,0 +1,39 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_BATCH_H
+#define CSDF_EXECUTION_BATCH_H
+
+#include "graphrun.h"
+
+#include <threading4csdf.h>
+
+// Many independent runs of one graph. Instance i starts with
+// initialTokens[i * graph->numConnections + connectionId] on each connection,
+// where NULL (or no initialTokens at all) keeps the graph's own tokens.
+// Tokens of results[r] from instance i are stored contiguously at
+// resultTokens[r] + i * resultSizes[r] as filled by batch_result_sizes.
+typedef struct CsdfBatch
+{
+    const CsdfGraph *const graph;
+    const unsigned numIterations;
+    const size_t numInstances;
+    const void *const *const initialTokens;
+    const size_t numResults;
+    const CsdfOutputId *const results;
+    void *const *const resultTokens;
+} CsdfBatch;
+
+// Stores the bytes of each result per instance in resultSizes. Returns
+// false when the graph has no repetition vector.
+bool batch_result_sizes(const CsdfBatch *batch, size_t *resultSizes);
+
+// Fails without workers for a nonempty batch.
+bool batch_run(const CsdfThreading *threading, size_t numWorkers, const CsdfBatch *batch);
+
+#endif // CSDF_EXECUTION_BATCH_H
@@ -10,21 +10,58 @@ Copyright (c) 2023 Slaven Glumac
 #define CSDF_EXECUTION_BUFFER_H
 
 #include <csdf/graph.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct CsdfBuffer CsdfBuffer;
 
+typedef struct CsdfTokenPool CsdfTokenPool;
+
 typedef void (*CsdfBufferPush)(CsdfBuffer *buffer, const uint8_t *token);
 typedef void (*CsdfBufferPop)(CsdfBuffer *buffer, uint8_t *token);
+typedef void (*CsdfBufferPushTokens)(CsdfBuffer *buffer, const uint8_t *tokens, unsigned numTokens);
+typedef void (*CsdfBufferPopTokens)(CsdfBuffer *buffer, uint8_t *tokens, unsigned numTokens);
 typedef unsigned (*CsdfBufferNumberOfTokens)(CsdfBuffer *buffer);
+typedef bool (*CsdfBufferHasTokens)(CsdfBuffer *buffer, unsigned numTokens);
+typedef void (*CsdfBufferReset)(CsdfBuffer *buffer, const void *initialTokens);
+typedef void (*CsdfBufferDestroy)(CsdfBuffer *buffer);
+typedef void (*CsdfBufferRehome)(CsdfBuffer *buffer);
+typedef bool (*CsdfBufferClosed)(CsdfBuffer *buffer);
 
+// Buffers have one producer and one consumer at a time. pushTokens and
+// popTokens move a whole span and publish it at once. numberOfTokens,
+// hasTokens and popTokens belong to the consumer side and freeSpace,
+// hasSpace and pushTokens to the producer side, since each side may cache
+// what it last saw of the other.
+//
+// A buffer with a token pool carries handles into that pool. Its pushes take
+// handles the producer already acquired, while its pops still deliver the
+// tokens themselves and release the handles.
+//
+// rehome moves the token storage to memory first touched by the calling
+// thread, which keeps it on that thread's NUMA node. It may only run while
+// no other thread uses the buffer.
+//
+// closed is NULL unless the other end of the buffer lives in another
+// process that can go away. Once it returns true, tokens or space the
+// buffer lacks will never arrive.
 struct CsdfBuffer
 {
     const CsdfConnection *connection;
     void *data;
     CsdfBufferPush push;
     CsdfBufferPop pop;
+    CsdfBufferPushTokens pushTokens;
+    CsdfBufferPopTokens popTokens;
     CsdfBufferNumberOfTokens numberOfTokens;
+    CsdfBufferNumberOfTokens freeSpace;
+    CsdfBufferHasTokens hasTokens;
+    CsdfBufferHasTokens hasSpace;
+    CsdfBufferReset reset;
+    CsdfBufferDestroy destroy;
+    CsdfBufferRehome rehome;
+    CsdfBufferClosed closed;
+    CsdfTokenPool *pool;
 };
 
 #endif // CSDF_EXECUTION_BUFFER_H
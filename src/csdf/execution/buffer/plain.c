@@ -0,0 +1,135 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "plain.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CsdfBufferPlainData
+{
+    unsigned start;
+    unsigned end;
+    unsigned maxTokens;
+    char _pad[4];
+    uint8_t *tokens;
+} CsdfBufferPlainData;
+
+static void buffer_push_tokens(CsdfBuffer *buffer, const uint8_t *tokens, unsigned numTokens)
+{
+    CsdfBufferPlainData *data = buffer->data;
+    size_t tokenSize = buffer->connection->tokenSize;
+    if (numTokens > buffer->freeSpace(buffer))
+    {
+        exit(123);
+    }
+    unsigned numFirst = data->maxTokens - data->end < numTokens ? data->maxTokens - data->end : numTokens;
+    memcpy(data->tokens + tokenSize * data->end, tokens, tokenSize * numFirst);
+    memcpy(data->tokens, tokens + tokenSize * numFirst, tokenSize * (numTokens - numFirst));
+    data->end = (data->end + numTokens) % data->maxTokens;
+}
+
+static void buffer_pop_tokens(CsdfBuffer *buffer, uint8_t *tokens, unsigned numTokens)
+{
+    CsdfBufferPlainData *data = buffer->data;
+    size_t tokenSize = buffer->connection->tokenSize;
+    unsigned numFirst = data->maxTokens - data->start < numTokens ? data->maxTokens - data->start : numTokens;
+    memcpy(tokens, data->tokens + tokenSize * data->start, tokenSize * numFirst);
+    memcpy(tokens + tokenSize * numFirst, data->tokens, tokenSize * (numTokens - numFirst));
+    data->start = (data->start + numTokens) % data->maxTokens;
+}
+
+static void buffer_push(CsdfBuffer *buffer, const uint8_t *token)
+{
+    buffer_push_tokens(buffer, token, 1);
+}
+
+static void buffer_pop(CsdfBuffer *buffer, uint8_t *token)
+{
+    buffer_pop_tokens(buffer, token, 1);
+}
+
+static unsigned number_tokens(CsdfBuffer *buffer)
+{
+    const CsdfBufferPlainData *data = buffer->data;
+    return data->end >= data->start
+               ? data->end - data->start
+               : data->end + data->maxTokens - data->start;
+}
+
+static unsigned free_space(CsdfBuffer *buffer)
+{
+    const CsdfBufferPlainData *data = buffer->data;
+    return data->maxTokens - 1 - number_tokens(buffer);
+}
+
+static bool has_tokens(CsdfBuffer *buffer, unsigned numTokens)
+{
+    return number_tokens(buffer) >= numTokens;
+}
+
+static bool has_space(CsdfBuffer *buffer, unsigned numTokens)
+{
+    return free_space(buffer) >= numTokens;
+}
+
+static void reset_buffer(CsdfBuffer *buffer, const void *initialTokens)
+{
+    CsdfBufferPlainData *data = buffer->data;
+    const CsdfConnection *connection = buffer->connection;
+    if (connection->numTokens > 0)
+    {
+        memcpy(data->tokens, initialTokens, connection->numTokens * connection->tokenSize);
+    }
+    data->start = 0;
+    data->end = connection->numTokens;
+}
+
+static void rehome_buffer(CsdfBuffer *buffer)
+{
+    CsdfBufferPlainData *data = buffer->data;
+    size_t tokensSize = data->maxTokens * buffer->connection->tokenSize;
+    uint8_t *tokens = malloc(tokensSize);
+    memcpy(tokens, data->tokens, tokensSize);
+    free(data->tokens);
+    data->tokens = tokens;
+}
+
+CsdfBuffer *new_plain_buffer(const CsdfConnection *connection, unsigned maxTokens)
+{
+    CsdfBufferPlainData *data = malloc(sizeof(CsdfBufferPlainData));
+    data->maxTokens = maxTokens;
+    data->tokens = malloc(maxTokens * connection->tokenSize);
+
+    CsdfBuffer *buffer = malloc(sizeof(CsdfBuffer));
+    buffer->connection = connection;
+    buffer->data = data;
+    buffer->pop = buffer_pop;
+    buffer->push = buffer_push;
+    buffer->pushTokens = buffer_push_tokens;
+    buffer->popTokens = buffer_pop_tokens;
+    buffer->numberOfTokens = number_tokens;
+    buffer->freeSpace = free_space;
+    buffer->hasTokens = has_tokens;
+    buffer->hasSpace = has_space;
+    buffer->reset = reset_buffer;
+    buffer->destroy = delete_plain_buffer;
+    buffer->rehome = rehome_buffer;
+    buffer->closed = NULL;
+    buffer->pool = NULL;
+    reset_buffer(buffer, connection->initialTokens);
+    return buffer;
+}
+
+void delete_plain_buffer(CsdfBuffer *buffer)
+{
+    CsdfBufferPlainData *data = buffer->data;
+    free(data->tokens);
+    free(data);
+    free(buffer);
+}
@@ -0,0 +1,20 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_BUFFER_PLAIN_H
+#define CSDF_EXECUTION_BUFFER_PLAIN_H
+
+#include <csdf/execution/buffer.h>
+
+// A ring without atomics for connections whose producer and consumer run on
+// the same thread.
+CsdfBuffer *new_plain_buffer(const CsdfConnection *connection, unsigned maxTokens);
+
+void delete_plain_buffer(CsdfBuffer *buffer);
+
+#endif // CSDF_EXECUTION_BUFFER_PLAIN_H
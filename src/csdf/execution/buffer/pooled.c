@@ -0,0 +1,169 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "pooled.h"
+#include "stdlockfree.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CsdfBufferPooledData
+{
+    CsdfConnection handleConnection;
+    CsdfBuffer *handles;
+} CsdfBufferPooledData;
+
+static void buffer_push(CsdfBuffer *buffer, const uint8_t *handle)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    data->handles->push(data->handles, handle);
+}
+
+static void buffer_pop(CsdfBuffer *buffer, uint8_t *token)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    uint32_t handle;
+    data->handles->pop(data->handles, (uint8_t *)&handle);
+    memcpy(token, token_slot(buffer->pool, handle), buffer->pool->tokenSize);
+    release_token(buffer->pool, handle);
+}
+
+static void buffer_push_tokens(CsdfBuffer *buffer, const uint8_t *handles, unsigned numTokens)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    data->handles->pushTokens(data->handles, handles, numTokens);
+}
+
+static void buffer_pop_tokens(CsdfBuffer *buffer, uint8_t *tokens, unsigned numTokens)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    size_t tokenSize = buffer->pool->tokenSize;
+    uint32_t handles[CSDF_POOLED_HELD_HANDLES];
+    while (numTokens > 0)
+    {
+        unsigned numChunk = numTokens < CSDF_POOLED_HELD_HANDLES ? numTokens : CSDF_POOLED_HELD_HANDLES;
+        data->handles->popTokens(data->handles, (uint8_t *)handles, numChunk);
+        for (unsigned handleId = 0; handleId < numChunk; handleId++)
+        {
+            memcpy(tokens, token_slot(buffer->pool, handles[handleId]), tokenSize);
+            release_token(buffer->pool, handles[handleId]);
+            tokens += tokenSize;
+        }
+        numTokens -= numChunk;
+    }
+}
+
+void pop_token_handles(CsdfBuffer *buffer, uint32_t *handles, unsigned numTokens)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    data->handles->popTokens(data->handles, (uint8_t *)handles, numTokens);
+}
+
+static unsigned number_tokens(CsdfBuffer *buffer)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    return data->handles->numberOfTokens(data->handles);
+}
+
+static unsigned free_space(CsdfBuffer *buffer)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    return data->handles->freeSpace(data->handles);
+}
+
+static bool has_tokens(CsdfBuffer *buffer, unsigned numTokens)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    return data->handles->hasTokens(data->handles, numTokens);
+}
+
+static bool has_space(CsdfBuffer *buffer, unsigned numTokens)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    return data->handles->hasSpace(data->handles, numTokens);
+}
+
+static void reset_buffer(CsdfBuffer *buffer, const void *initialTokens)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    CsdfBuffer *handles = data->handles;
+    while (handles->numberOfTokens(handles) > 0)
+    {
+        uint32_t handle;
+        handles->pop(handles, (uint8_t *)&handle);
+        release_token(buffer->pool, handle);
+    }
+    handles->reset(handles, NULL);
+
+    const CsdfConnection *connection = buffer->connection;
+    const uint8_t *initialToken = initialTokens;
+    for (size_t tokenId = 0; tokenId < connection->numTokens; tokenId++)
+    {
+        uint32_t handle = acquire_token(buffer->pool, 1);
+        assert(handle != CSDF_NO_TOKEN_HANDLE);
+        memcpy(token_slot(buffer->pool, handle), initialToken, connection->tokenSize);
+        handles->push(handles, (const uint8_t *)&handle);
+        initialToken += connection->tokenSize;
+    }
+}
+
+static void rehome_buffer(CsdfBuffer *buffer)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    data->handles->rehome(data->handles);
+}
+
+CsdfBuffer *new_pooled_buffer(const CsdfConnection *connection, unsigned maxTokens, CsdfTokenPool *pool)
+{
+    if (pool->numSlots < (uint64_t)maxTokens - 1 + CSDF_POOLED_HELD_HANDLES)
+    {
+        return NULL;
+    }
+    CsdfBufferPooledData *data = malloc(sizeof(CsdfBufferPooledData));
+    CsdfConnection handleConnection = {
+        .source = connection->source,
+        .destination = connection->destination,
+        .tokenSize = sizeof(uint32_t),
+        .numTokens = 0,
+        .initialTokens = NULL};
+    memcpy(&data->handleConnection, &handleConnection, sizeof(CsdfConnection));
+    data->handles = new_stdlockfree_buffer(&data->handleConnection, maxTokens);
+
+    CsdfBuffer *buffer = malloc(sizeof(CsdfBuffer));
+    buffer->connection = connection;
+    buffer->data = data;
+    buffer->pop = buffer_pop;
+    buffer->push = buffer_push;
+    buffer->pushTokens = buffer_push_tokens;
+    buffer->popTokens = buffer_pop_tokens;
+    buffer->numberOfTokens = number_tokens;
+    buffer->freeSpace = free_space;
+    buffer->hasTokens = has_tokens;
+    buffer->hasSpace = has_space;
+    buffer->reset = reset_buffer;
+    buffer->destroy = delete_pooled_buffer;
+    buffer->rehome = rehome_buffer;
+    buffer->closed = NULL;
+    buffer->pool = pool;
+    reset_buffer(buffer, connection->initialTokens);
+    return buffer;
+}
+
+size_t pooled_buffer_bytes(unsigned maxTokens)
+{
+    return sizeof(CsdfBuffer) + sizeof(CsdfBufferPooledData) + stdlockfree_buffer_bytes(maxTokens, sizeof(uint32_t));
+}
+
+void delete_pooled_buffer(CsdfBuffer *buffer)
+{
+    CsdfBufferPooledData *data = buffer->data;
+    delete_stdlockfree_buffer(data->handles);
+    free(data);
+    free(buffer);
+}
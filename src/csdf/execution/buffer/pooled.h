@@ -0,0 +1,37 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_BUFFER_POOLED_H
+#define CSDF_EXECUTION_BUFFER_POOLED_H
+
+#include "tokenpool.h"
+
+#include <csdf/execution/buffer.h>
+
+// Pops hold at most this many handles after taking them off the ring.
+#define CSDF_POOLED_HELD_HANDLES 64
+
+// A ring of handles into a token pool shared by every connection of one
+// output, so fan-out shares a single copy of each token. The handles of one
+// output stay in order across its buffers, so the pool needs slots for the
+// initial tokens of every buffer and the largest ring, plus the handles
+// producers and consumers hold while they fire. Pops copy the tokens out
+// and hold at most CSDF_POOLED_HELD_HANDLES handles meanwhile. Returns NULL
+// when the pool cannot even cover this ring.
+CsdfBuffer *new_pooled_buffer(const CsdfConnection *connection, unsigned maxTokens, CsdfTokenPool *pool);
+
+// Takes numTokens handles off the ring without copying their tokens. The
+// caller releases them into buffer->pool.
+void pop_token_handles(CsdfBuffer *buffer, uint32_t *handles, unsigned numTokens);
+
+void delete_pooled_buffer(CsdfBuffer *buffer);
+
+// The bytes new_pooled_buffer allocates, excluding the pool.
+size_t pooled_buffer_bytes(unsigned maxTokens);
+
+#endif // CSDF_EXECUTION_BUFFER_POOLED_H
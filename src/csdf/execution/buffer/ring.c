@@ -0,0 +1,107 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if ATOMIC_LLONG_LOCK_FREE != 2
+#error "atomic_ullong not supported!"
+#endif
+
+static void copy_in(CsdfRing *ring, uint64_t position, const uint8_t *tokens, unsigned numTokens)
+{
+    size_t tokenSize = ring->tokenSize;
+    unsigned index = position % ring->maxTokens;
+    unsigned numFirst = ring->maxTokens - index < numTokens ? ring->maxTokens - index : numTokens;
+    memcpy(ring->tokens + tokenSize * index, tokens, tokenSize * numFirst);
+    memcpy(ring->tokens, tokens + tokenSize * numFirst, tokenSize * (numTokens - numFirst));
+}
+
+static void copy_out(const CsdfRing *ring, uint64_t position, uint8_t *tokens, unsigned numTokens)
+{
+    size_t tokenSize = ring->tokenSize;
+    unsigned index = position % ring->maxTokens;
+    unsigned numFirst = ring->maxTokens - index < numTokens ? ring->maxTokens - index : numTokens;
+    memcpy(tokens, ring->tokens + tokenSize * index, tokenSize * numFirst);
+    memcpy(tokens + tokenSize * numFirst, ring->tokens, tokenSize * (numTokens - numFirst));
+}
+
+void ring_reset(CsdfRing *ring, const void *initialTokens, unsigned numTokens)
+{
+    CsdfRingHeader *header = ring->header;
+    if (numTokens > 0)
+    {
+        memcpy(ring->tokens, initialTokens, numTokens * ring->tokenSize);
+    }
+    atomic_store(&header->start, 0);
+    atomic_store(&header->end, numTokens);
+    header->cachedStart = 0;
+    header->cachedEnd = numTokens;
+}
+
+bool ring_has_space(CsdfRing *ring, unsigned numTokens)
+{
+    CsdfRingHeader *header = ring->header;
+    uint64_t end = atomic_load_explicit(&header->end, memory_order_relaxed);
+    if (end - header->cachedStart + numTokens < ring->maxTokens)
+    {
+        return true;
+    }
+    header->cachedStart = atomic_load_explicit(&header->start, memory_order_acquire);
+    return end - header->cachedStart + numTokens < ring->maxTokens;
+}
+
+bool ring_has_tokens(CsdfRing *ring, unsigned numTokens)
+{
+    CsdfRingHeader *header = ring->header;
+    uint64_t start = atomic_load_explicit(&header->start, memory_order_relaxed);
+    if (header->cachedEnd - start >= numTokens)
+    {
+        return true;
+    }
+    header->cachedEnd = atomic_load_explicit(&header->end, memory_order_acquire);
+    return header->cachedEnd - start >= numTokens;
+}
+
+void ring_push_tokens(CsdfRing *ring, const uint8_t *tokens, unsigned numTokens)
+{
+    if (!ring_has_space(ring, numTokens))
+    {
+        exit(123);
+    }
+    uint64_t end = atomic_load_explicit(&ring->header->end, memory_order_relaxed);
+    copy_in(ring, end, tokens, numTokens);
+    atomic_store_explicit(&ring->header->end, end + numTokens, memory_order_release);
+}
+
+void ring_pop_tokens(CsdfRing *ring, uint8_t *tokens, unsigned numTokens)
+{
+    if (!ring_has_tokens(ring, numTokens))
+    {
+        exit(123);
+    }
+    uint64_t start = atomic_load_explicit(&ring->header->start, memory_order_relaxed);
+    copy_out(ring, start, tokens, numTokens);
+    atomic_store_explicit(&ring->header->start, start + numTokens, memory_order_release);
+}
+
+unsigned ring_number_tokens(CsdfRing *ring)
+{
+    CsdfRingHeader *header = ring->header;
+    header->cachedEnd = atomic_load_explicit(&header->end, memory_order_acquire);
+    return header->cachedEnd - atomic_load_explicit(&header->start, memory_order_relaxed);
+}
+
+unsigned ring_free_space(CsdfRing *ring)
+{
+    CsdfRingHeader *header = ring->header;
+    header->cachedStart = atomic_load_explicit(&header->start, memory_order_acquire);
+    return ring->maxTokens - 1 - (atomic_load_explicit(&header->end, memory_order_relaxed) - header->cachedStart);
+}
@@ -0,0 +1,58 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_BUFFER_RING_H
+#define CSDF_EXECUTION_BUFFER_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// start and end count tokens since the last reset and never wrap in
+// practice. Each side keeps a cached copy of the other side's counter in
+// its own cache line and reloads it only when the copy shows too few
+// tokens or too little space. Lock-free atomics do not depend on the
+// address they are mapped at, so the header may live in shared memory.
+typedef struct CsdfRingHeader
+{
+    _Atomic uint64_t end;
+    uint64_t cachedStart;
+    char _producerPad[48];
+    _Atomic uint64_t start;
+    uint64_t cachedEnd;
+    char _consumerPad[48];
+} CsdfRingHeader;
+
+// A single-producer single-consumer ring over a header and maxTokens token
+// slots that the caller owns.
+typedef struct CsdfRing
+{
+    CsdfRingHeader *header;
+    uint8_t *tokens;
+    size_t tokenSize;
+    unsigned maxTokens;
+    char _pad[4];
+} CsdfRing;
+
+// Empties the ring and queues numTokens initial tokens.
+void ring_reset(CsdfRing *ring, const void *initialTokens, unsigned numTokens);
+
+bool ring_has_space(CsdfRing *ring, unsigned numTokens);
+
+bool ring_has_tokens(CsdfRing *ring, unsigned numTokens);
+
+void ring_push_tokens(CsdfRing *ring, const uint8_t *tokens, unsigned numTokens);
+
+void ring_pop_tokens(CsdfRing *ring, uint8_t *tokens, unsigned numTokens);
+
+unsigned ring_number_tokens(CsdfRing *ring);
+
+unsigned ring_free_space(CsdfRing *ring);
+
+#endif // CSDF_EXECUTION_BUFFER_RING_H
@@ -0,0 +1,234 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "shm.h"
+#include "ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Shared between the processes. The producer and the consumer each keep
+// their cached counter on their own side of the header.
+typedef struct CsdfShmRing
+{
+    CsdfRingHeader header;
+    unsigned maxTokens;
+    unsigned tokenSize;
+    char _pad[56];
+} CsdfShmRing;
+
+typedef struct CsdfBufferShmData
+{
+    CsdfShmRing *shared;
+    CsdfRing ring;
+    size_t mappedBytes;
+    char *name;
+} CsdfBufferShmData;
+
+static bool has_space(CsdfBuffer *buffer, unsigned numTokens)
+{
+    CsdfBufferShmData *data = buffer->data;
+    return ring_has_space(&data->ring, numTokens);
+}
+
+static bool has_tokens(CsdfBuffer *buffer, unsigned numTokens)
+{
+    CsdfBufferShmData *data = buffer->data;
+    return ring_has_tokens(&data->ring, numTokens);
+}
+
+static void buffer_push_tokens(CsdfBuffer *buffer, const uint8_t *tokens, unsigned numTokens)
+{
+    CsdfBufferShmData *data = buffer->data;
+    ring_push_tokens(&data->ring, tokens, numTokens);
+}
+
+static void buffer_pop_tokens(CsdfBuffer *buffer, uint8_t *tokens, unsigned numTokens)
+{
+    CsdfBufferShmData *data = buffer->data;
+    ring_pop_tokens(&data->ring, tokens, numTokens);
+}
+
+static void buffer_push(CsdfBuffer *buffer, const uint8_t *token)
+{
+    buffer_push_tokens(buffer, token, 1);
+}
+
+static void buffer_pop(CsdfBuffer *buffer, uint8_t *token)
+{
+    buffer_pop_tokens(buffer, token, 1);
+}
+
+static unsigned number_tokens(CsdfBuffer *buffer)
+{
+    CsdfBufferShmData *data = buffer->data;
+    return ring_number_tokens(&data->ring);
+}
+
+static unsigned free_space(CsdfBuffer *buffer)
+{
+    CsdfBufferShmData *data = buffer->data;
+    return ring_free_space(&data->ring);
+}
+
+static void reset_buffer(CsdfBuffer *buffer, const void *initialTokens)
+{
+    CsdfBufferShmData *data = buffer->data;
+    ring_reset(&data->ring, initialTokens, buffer->connection->numTokens);
+}
+
+// The mapping is shared with other processes and stays where it is.
+static void rehome_buffer(CsdfBuffer *buffer)
+{
+    (void)buffer;
+}
+
+static CsdfShmRing *map_segment(int fd, size_t mappedBytes)
+{
+    void *mapped = mmap(NULL, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return mapped != MAP_FAILED ? mapped : NULL;
+}
+
+// Segments too small for their ring or made for another token size are
+// rejected before any token is touched.
+static bool fits_segment(const CsdfShmRing *shared, const CsdfConnection *connection, size_t mappedBytes)
+{
+    return shared->tokenSize == connection->tokenSize && shared->maxTokens > 0 &&
+           (uint64_t)shared->maxTokens * connection->tokenSize <= mappedBytes - sizeof(CsdfShmRing);
+}
+
+static CsdfBuffer *new_mapped_buffer(const CsdfConnection *connection, CsdfShmRing *shared, size_t mappedBytes, char *name)
+{
+    CsdfBufferShmData *data = malloc(sizeof(CsdfBufferShmData));
+    data->shared = shared;
+    data->ring.header = &shared->header;
+    data->ring.tokens = (uint8_t *)shared + sizeof(CsdfShmRing);
+    data->ring.tokenSize = connection->tokenSize;
+    data->ring.maxTokens = shared->maxTokens;
+    data->mappedBytes = mappedBytes;
+    data->name = name;
+
+    CsdfBuffer *buffer = malloc(sizeof(CsdfBuffer));
+    buffer->connection = connection;
+    buffer->data = data;
+    buffer->pop = buffer_pop;
+    buffer->push = buffer_push;
+    buffer->pushTokens = buffer_push_tokens;
+    buffer->popTokens = buffer_pop_tokens;
+    buffer->numberOfTokens = number_tokens;
+    buffer->freeSpace = free_space;
+    buffer->hasTokens = has_tokens;
+    buffer->hasSpace = has_space;
+    buffer->reset = reset_buffer;
+    buffer->destroy = delete_shm_buffer;
+    buffer->rehome = rehome_buffer;
+    buffer->closed = NULL;
+    buffer->pool = NULL;
+    return buffer;
+}
+
+CsdfBuffer *new_shm_buffer(const CsdfConnection *connection, unsigned maxTokens, const char *name)
+{
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    size_t mappedBytes = sizeof(CsdfShmRing) + (size_t)maxTokens * connection->tokenSize;
+    if (ftruncate(fd, (off_t)mappedBytes) != 0)
+    {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    CsdfShmRing *shared = map_segment(fd, mappedBytes);
+    if (shared == NULL)
+    {
+        shm_unlink(name);
+        return NULL;
+    }
+    shared->maxTokens = maxTokens;
+    shared->tokenSize = (unsigned)connection->tokenSize;
+    char *ownedName = malloc(strlen(name) + 1);
+    strcpy(ownedName, name);
+    CsdfBuffer *buffer = new_mapped_buffer(connection, shared, mappedBytes, ownedName);
+    reset_buffer(buffer, connection->initialTokens);
+    return buffer;
+}
+
+CsdfBuffer *open_shm_buffer(const CsdfConnection *connection, const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(CsdfShmRing))
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t mappedBytes = (size_t)status.st_size;
+    CsdfShmRing *shared = map_segment(fd, mappedBytes);
+    if (shared == NULL)
+    {
+        return NULL;
+    }
+    if (!fits_segment(shared, connection, mappedBytes))
+    {
+        munmap(shared, mappedBytes);
+        return NULL;
+    }
+    return new_mapped_buffer(connection, shared, mappedBytes, NULL);
+}
+
+void delete_shm_buffer(CsdfBuffer *buffer)
+{
+    CsdfBufferShmData *data = buffer->data;
+    munmap(data->shared, data->mappedBytes);
+    if (data->name != NULL)
+    {
+        shm_unlink(data->name);
+        free(data->name);
+    }
+    free(data);
+    free(buffer);
+}
+
+#else
+
+CsdfBuffer *new_shm_buffer(const CsdfConnection *connection, unsigned maxTokens, const char *name)
+{
+    (void)connection;
+    (void)maxTokens;
+    (void)name;
+    return NULL;
+}
+
+CsdfBuffer *open_shm_buffer(const CsdfConnection *connection, const char *name)
+{
+    (void)connection;
+    (void)name;
+    return NULL;
+}
+
+void delete_shm_buffer(CsdfBuffer *buffer)
+{
+    (void)buffer;
+}
+
+#endif
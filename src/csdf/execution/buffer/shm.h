@@ -0,0 +1,28 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_BUFFER_SHM_H
+#define CSDF_EXECUTION_BUFFER_SHM_H
+
+#include <csdf/execution/buffer.h>
+
+// The lock-free ring of ring.h placed in a POSIX shared memory object, so
+// its producer and consumer may run in different processes.
+// new_shm_buffer creates the object under name and fills it with the
+// connection's initial tokens. open_shm_buffer maps an object created
+// elsewhere. Only the creating buffer unlinks the name when deleted. Both
+// return NULL when the object cannot be created or mapped, and
+// open_shm_buffer also when the object is too small for its ring or holds
+// tokens of another size than the connection.
+CsdfBuffer *new_shm_buffer(const CsdfConnection *connection, unsigned maxTokens, const char *name);
+
+CsdfBuffer *open_shm_buffer(const CsdfConnection *connection, const char *name);
+
+void delete_shm_buffer(CsdfBuffer *buffer);
+
+#endif // CSDF_EXECUTION_BUFFER_SHM_H
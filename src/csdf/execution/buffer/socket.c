@@ -0,0 +1,423 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "socket.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define FLUSH_SECONDS 5
+
+// The producer counts the credits it may still send and assembles credit
+// messages, 32-bit counts in network order, from partial reads. The
+// consumer keeps received bytes in a ring and returns credits in batches,
+// but always before it waits for tokens, so neither end can wait on the
+// other forever. A producer that has finished may close before its last
+// credits arrive, so the consumer ignores failed credit sends.
+//
+// peerClosed records that the other end closed or reset the connection.
+// A consumer that sees the producer's end of stream stops returning
+// credits and closes its own sending side.
+typedef struct CsdfBufferSocketData
+{
+    int socket;
+    unsigned maxTokens;
+    unsigned credits;
+    unsigned numCreditBytes;
+    uint8_t creditBytes[4];
+    unsigned pendingCredits;
+    unsigned creditBatch;
+    bool peerClosed;
+    char _pad[3];
+    uint8_t *tokens;
+    uint64_t receivedBytes;
+    uint64_t consumedBytes;
+} CsdfBufferSocketData;
+
+static bool send_all(int socket, const uint8_t *bytes, size_t numBytes)
+{
+    while (numBytes > 0)
+    {
+        ssize_t numSent = send(socket, bytes, numBytes, MSG_NOSIGNAL);
+        if (numSent <= 0)
+        {
+            return false;
+        }
+        bytes += numSent;
+        numBytes -= (size_t)numSent;
+    }
+    return true;
+}
+
+// Whether a non-blocking receive that returned numReceived found the
+// connection closed rather than just empty.
+static bool is_end_of_stream(ssize_t numReceived)
+{
+    return numReceived == 0 || (numReceived < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
+
+static void receive_credits(CsdfBufferSocketData *data)
+{
+    while (!data->peerClosed)
+    {
+        ssize_t numReceived = recv(data->socket, data->creditBytes + data->numCreditBytes, sizeof(data->creditBytes) - data->numCreditBytes, MSG_DONTWAIT);
+        if (numReceived <= 0)
+        {
+            data->peerClosed = is_end_of_stream(numReceived);
+            return;
+        }
+        data->numCreditBytes += (unsigned)numReceived;
+        if (data->numCreditBytes == sizeof(data->creditBytes))
+        {
+            uint32_t credits;
+            memcpy(&credits, data->creditBytes, sizeof(credits));
+            data->credits += ntohl(credits);
+            data->numCreditBytes = 0;
+        }
+    }
+}
+
+static bool producer_has_space(CsdfBuffer *buffer, unsigned numTokens)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    if (data->credits < numTokens)
+    {
+        receive_credits(data);
+    }
+    return data->credits >= numTokens;
+}
+
+static void producer_push_tokens(CsdfBuffer *buffer, const uint8_t *tokens, unsigned numTokens)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    if (!producer_has_space(buffer, numTokens))
+    {
+        exit(123);
+    }
+    if (!send_all(data->socket, tokens, (size_t)numTokens * buffer->connection->tokenSize))
+    {
+        data->peerClosed = true;
+    }
+    data->credits -= numTokens;
+}
+
+static void producer_push(CsdfBuffer *buffer, const uint8_t *token)
+{
+    producer_push_tokens(buffer, token, 1);
+}
+
+static unsigned producer_free_space(CsdfBuffer *buffer)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    receive_credits(data);
+    return data->credits;
+}
+
+// Tokens that are queued or in flight, as far as the producer knows.
+static unsigned producer_number_tokens(CsdfBuffer *buffer)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    return data->maxTokens - 1 - data->credits;
+}
+
+static void send_credits(CsdfBufferSocketData *data)
+{
+    if (data->pendingCredits == 0 || data->peerClosed)
+    {
+        return;
+    }
+    uint32_t credits = htonl(data->pendingCredits);
+    (void)send_all(data->socket, (const uint8_t *)&credits, sizeof(credits));
+    data->pendingCredits = 0;
+}
+
+static void receive_tokens(CsdfBuffer *buffer)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    size_t ringBytes = (size_t)data->maxTokens * buffer->connection->tokenSize;
+    while (!data->peerClosed)
+    {
+        size_t freeBytes = ringBytes - (size_t)(data->receivedBytes - data->consumedBytes);
+        size_t index = data->receivedBytes % ringBytes;
+        size_t numContiguous = ringBytes - index < freeBytes ? ringBytes - index : freeBytes;
+        if (numContiguous == 0)
+        {
+            return;
+        }
+        ssize_t numReceived = recv(data->socket, data->tokens + index, numContiguous, MSG_DONTWAIT);
+        if (numReceived <= 0)
+        {
+            if (is_end_of_stream(numReceived))
+            {
+                data->peerClosed = true;
+                shutdown(data->socket, SHUT_WR);
+            }
+            return;
+        }
+        data->receivedBytes += (size_t)numReceived;
+        if ((size_t)numReceived < numContiguous)
+        {
+            return;
+        }
+    }
+}
+
+static unsigned consumer_number_tokens(CsdfBuffer *buffer)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    receive_tokens(buffer);
+    return (data->receivedBytes - data->consumedBytes) / buffer->connection->tokenSize;
+}
+
+static bool consumer_has_tokens(CsdfBuffer *buffer, unsigned numTokens)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    size_t tokenSize = buffer->connection->tokenSize;
+    if ((data->receivedBytes - data->consumedBytes) / tokenSize >= numTokens)
+    {
+        return true;
+    }
+    send_credits(data);
+    return consumer_number_tokens(buffer) >= numTokens;
+}
+
+static void consumer_pop_tokens(CsdfBuffer *buffer, uint8_t *tokens, unsigned numTokens)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    if (!consumer_has_tokens(buffer, numTokens))
+    {
+        exit(123);
+    }
+    size_t ringBytes = (size_t)data->maxTokens * buffer->connection->tokenSize;
+    size_t numBytes = (size_t)numTokens * buffer->connection->tokenSize;
+    size_t index = data->consumedBytes % ringBytes;
+    size_t numFirst = ringBytes - index < numBytes ? ringBytes - index : numBytes;
+    memcpy(tokens, data->tokens + index, numFirst);
+    memcpy(tokens + numFirst, data->tokens, numBytes - numFirst);
+    data->consumedBytes += numBytes;
+    data->pendingCredits += numTokens;
+    if (data->pendingCredits >= data->creditBatch)
+    {
+        send_credits(data);
+    }
+}
+
+static void consumer_pop(CsdfBuffer *buffer, uint8_t *token)
+{
+    consumer_pop_tokens(buffer, token, 1);
+}
+
+static unsigned consumer_free_space(CsdfBuffer *buffer)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    return data->maxTokens - 1 - consumer_number_tokens(buffer);
+}
+
+static void unsupported_push(CsdfBuffer *buffer, const uint8_t *token)
+{
+    (void)buffer;
+    (void)token;
+    exit(123);
+}
+
+static void unsupported_push_tokens(CsdfBuffer *buffer, const uint8_t *tokens, unsigned numTokens)
+{
+    (void)buffer;
+    (void)tokens;
+    (void)numTokens;
+    exit(123);
+}
+
+static void unsupported_pop(CsdfBuffer *buffer, uint8_t *token)
+{
+    (void)buffer;
+    (void)token;
+    exit(123);
+}
+
+static void unsupported_pop_tokens(CsdfBuffer *buffer, uint8_t *tokens, unsigned numTokens)
+{
+    (void)buffer;
+    (void)tokens;
+    (void)numTokens;
+    exit(123);
+}
+
+static bool producer_has_tokens(CsdfBuffer *buffer, unsigned numTokens)
+{
+    return producer_number_tokens(buffer) >= numTokens;
+}
+
+static bool consumer_has_space(CsdfBuffer *buffer, unsigned numTokens)
+{
+    return consumer_free_space(buffer) >= numTokens;
+}
+
+// Both ends start from the connection's initial tokens, which already sit
+// in the consumer's ring.
+static void reset_producer(CsdfBuffer *buffer, const void *initialTokens)
+{
+    (void)initialTokens;
+    CsdfBufferSocketData *data = buffer->data;
+    data->credits = data->maxTokens - 1 - buffer->connection->numTokens;
+}
+
+static void reset_consumer(CsdfBuffer *buffer, const void *initialTokens)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    const CsdfConnection *connection = buffer->connection;
+    size_t numBytes = connection->numTokens * connection->tokenSize;
+    if (numBytes > 0)
+    {
+        memcpy(data->tokens, initialTokens, numBytes);
+    }
+    data->receivedBytes = numBytes;
+    data->consumedBytes = 0;
+    data->pendingCredits = 0;
+}
+
+static void rehome_buffer(CsdfBuffer *buffer)
+{
+    (void)buffer;
+}
+
+static bool is_closed(CsdfBuffer *buffer)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    return data->peerClosed;
+}
+
+static CsdfBuffer *new_socket_buffer(const CsdfConnection *connection, unsigned maxTokens, int socket)
+{
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    CsdfBufferSocketData *data = malloc(sizeof(CsdfBufferSocketData));
+    data->socket = socket;
+    data->maxTokens = maxTokens;
+    data->credits = 0;
+    data->numCreditBytes = 0;
+    data->pendingCredits = 0;
+    data->creditBatch = maxTokens / 4 > 0 ? maxTokens / 4 : 1;
+    data->peerClosed = false;
+    data->tokens = NULL;
+    data->receivedBytes = 0;
+    data->consumedBytes = 0;
+
+    CsdfBuffer *buffer = malloc(sizeof(CsdfBuffer));
+    buffer->connection = connection;
+    buffer->data = data;
+    buffer->destroy = delete_socket_buffer;
+    buffer->rehome = rehome_buffer;
+    buffer->closed = is_closed;
+    buffer->pool = NULL;
+    return buffer;
+}
+
+CsdfBuffer *new_socket_producer(const CsdfConnection *connection, unsigned maxTokens, int socket)
+{
+    CsdfBuffer *buffer = new_socket_buffer(connection, maxTokens, socket);
+    buffer->push = producer_push;
+    buffer->pop = unsupported_pop;
+    buffer->pushTokens = producer_push_tokens;
+    buffer->popTokens = unsupported_pop_tokens;
+    buffer->numberOfTokens = producer_number_tokens;
+    buffer->freeSpace = producer_free_space;
+    buffer->hasTokens = producer_has_tokens;
+    buffer->hasSpace = producer_has_space;
+    buffer->reset = reset_producer;
+    reset_producer(buffer, connection->initialTokens);
+    return buffer;
+}
+
+CsdfBuffer *new_socket_consumer(const CsdfConnection *connection, unsigned maxTokens, int socket)
+{
+    CsdfBuffer *buffer = new_socket_buffer(connection, maxTokens, socket);
+    CsdfBufferSocketData *data = buffer->data;
+    data->tokens = malloc((size_t)maxTokens * connection->tokenSize);
+    buffer->push = unsupported_push;
+    buffer->pop = consumer_pop;
+    buffer->pushTokens = unsupported_push_tokens;
+    buffer->popTokens = consumer_pop_tokens;
+    buffer->numberOfTokens = consumer_number_tokens;
+    buffer->freeSpace = consumer_free_space;
+    buffer->hasTokens = consumer_has_tokens;
+    buffer->hasSpace = consumer_has_space;
+    buffer->reset = reset_consumer;
+    reset_consumer(buffer, connection->initialTokens);
+    return buffer;
+}
+
+// Closing with unread credits, or receiving credits after the close,
+// resets the connection and drops tokens that are still unacknowledged.
+// The producer therefore half-closes and reads credits until the consumer
+// has seen the end of stream and closed as well. SO_RCVTIMEO bounds the
+// wait for a consumer that never reads to the end and SO_LINGER bounds the
+// close that follows.
+static void flush_tokens(CsdfBufferSocketData *data)
+{
+    struct timeval timeout = {.tv_sec = FLUSH_SECONDS, .tv_usec = 0};
+    struct linger linger = {.l_onoff = 1, .l_linger = FLUSH_SECONDS};
+    setsockopt(data->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(data->socket, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    shutdown(data->socket, SHUT_WR);
+    while (!data->peerClosed && recv(data->socket, data->creditBytes, sizeof(data->creditBytes), 0) > 0)
+    {
+    }
+}
+
+void delete_socket_buffer(CsdfBuffer *buffer)
+{
+    CsdfBufferSocketData *data = buffer->data;
+    if (data->tokens == NULL)
+    {
+        flush_tokens(data);
+    }
+    close(data->socket);
+    free(data->tokens);
+    free(data);
+    free(buffer);
+}
+
+#else
+
+CsdfBuffer *new_socket_producer(const CsdfConnection *connection, unsigned maxTokens, int socket)
+{
+    (void)connection;
+    (void)maxTokens;
+    (void)socket;
+    return NULL;
+}
+
+CsdfBuffer *new_socket_consumer(const CsdfConnection *connection, unsigned maxTokens, int socket)
+{
+    (void)connection;
+    (void)maxTokens;
+    (void)socket;
+    return NULL;
+}
+
+void delete_socket_buffer(CsdfBuffer *buffer)
+{
+    (void)buffer;
+}
+
+#endif
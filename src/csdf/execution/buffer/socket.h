@@ -0,0 +1,35 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_BUFFER_SOCKET_H
+#define CSDF_EXECUTION_BUFFER_SOCKET_H
+
+#include <csdf/execution/buffer.h>
+
+// The two ends of a connection whose producer and consumer run on different
+// hosts, joined by a connected TCP socket that each buffer owns. The
+// producer end sends the tokens of each push in one batch. The consumer end
+// keeps a ring of maxTokens slots and returns credits for popped tokens, so
+// the producer never has more than maxTokens - 1 tokens in flight or
+// queued, as with a local ring. Both ends must agree on maxTokens. The
+// consumer end starts with the connection's initial tokens.
+//
+// Either end reports through closed once the other end has closed or reset
+// the connection. Deleting the producer end waits up to five seconds for
+// the consumer end to read everything and close.
+//
+// Only the producer-side operations are meaningful on the producer end and
+// only the consumer-side ones on the consumer end, see buffer.h. Both return
+// NULL on platforms without POSIX sockets.
+CsdfBuffer *new_socket_producer(const CsdfConnection *connection, unsigned maxTokens, int socket);
+
+CsdfBuffer *new_socket_consumer(const CsdfConnection *connection, unsigned maxTokens, int socket);
+
+void delete_socket_buffer(CsdfBuffer *buffer);
+
+#endif // CSDF_EXECUTION_BUFFER_SOCKET_H
@@ -7,99 +7,143 @@ Copyright (c) 2023 Slaven Glumac
 ****************************************************************************/
 
 #include "stdlockfree.h"
+#include "ring.h"
 
 #include <stdlib.h>
 #include <string.h>
-#include <stdatomic.h>
-
-#if ATOMIC_INT_LOCK_FREE != 2
-#error "atomic_int not supported!"
-#endif
 
 typedef struct CsdfBufferStdLockFreeData
 {
-    atomic_uint start;
-    atomic_uint end;
-    unsigned maxTokens;
-    uint8_t *tokens;
+    CsdfRingHeader header;
+    CsdfRing ring;
+    bool ownsTokens;
+    char _pad[7];
 } CsdfBufferStdLockFreeData;
 
-static void buffer_push(CsdfBuffer *buffer, const uint8_t *token)
+static bool has_space(CsdfBuffer *buffer, unsigned numTokens)
 {
     CsdfBufferStdLockFreeData *data = buffer->data;
-    unsigned end = atomic_load(&data->end);
-    int tokenSize = buffer->connection->tokenSize;
-    uint8_t *bufferEnd = data->tokens + tokenSize * end;
-    end = (end + 1) % data->maxTokens;
-    unsigned start = atomic_load(&data->start);
-    if (end == start)
-    {
-        exit(123);
-    }
-    memcpy(bufferEnd, token, tokenSize);
-    atomic_exchange(&data->end, end);
+    return ring_has_space(&data->ring, numTokens);
 }
 
-static void atomic_modulus(atomic_uint *value, unsigned divisor)
+static bool has_tokens(CsdfBuffer *buffer, unsigned numTokens)
 {
-    int currentValue, remainder;
-    do
-    {
-        currentValue = atomic_load(value);
-        remainder = currentValue % divisor;
-    } while (!atomic_compare_exchange_weak(value, &currentValue, remainder));
+    CsdfBufferStdLockFreeData *data = buffer->data;
+    return ring_has_tokens(&data->ring, numTokens);
 }
 
-static void buffer_pop(CsdfBuffer *buffer, uint8_t *token)
+static void buffer_push_tokens(CsdfBuffer *buffer, const uint8_t *tokens, unsigned numTokens)
+{
+    CsdfBufferStdLockFreeData *data = buffer->data;
+    ring_push_tokens(&data->ring, tokens, numTokens);
+}
+
+static void buffer_pop_tokens(CsdfBuffer *buffer, uint8_t *tokens, unsigned numTokens)
 {
     CsdfBufferStdLockFreeData *data = buffer->data;
-    unsigned start = atomic_fetch_add(&data->start, 1);
-    uint8_t *bufferStart = data->tokens + buffer->connection->tokenSize * start;
-    memcpy(token, bufferStart, buffer->connection->tokenSize);
-    atomic_modulus(&data->start, data->maxTokens);
+    ring_pop_tokens(&data->ring, tokens, numTokens);
+}
+
+static void buffer_push(CsdfBuffer *buffer, const uint8_t *token)
+{
+    buffer_push_tokens(buffer, token, 1);
+}
+
+static void buffer_pop(CsdfBuffer *buffer, uint8_t *token)
+{
+    buffer_pop_tokens(buffer, token, 1);
 }
 
 static unsigned number_tokens(CsdfBuffer *buffer)
 {
-    const CsdfBufferStdLockFreeData *data = buffer->data;
-    unsigned start = atomic_load(&data->start);
-    unsigned end = atomic_load(&data->end);
+    CsdfBufferStdLockFreeData *data = buffer->data;
+    return ring_number_tokens(&data->ring);
+}
+
+static unsigned free_space(CsdfBuffer *buffer)
+{
+    CsdfBufferStdLockFreeData *data = buffer->data;
+    return ring_free_space(&data->ring);
+}
+
+static void reset_buffer(CsdfBuffer *buffer, const void *initialTokens)
+{
+    CsdfBufferStdLockFreeData *data = buffer->data;
+    ring_reset(&data->ring, initialTokens, buffer->connection->numTokens);
+}
 
-    return end >= start
-               ? end - start
-               : end + data->maxTokens - start;
+static void rehome_buffer(CsdfBuffer *buffer)
+{
+    CsdfBufferStdLockFreeData *data = buffer->data;
+    if (!data->ownsTokens)
+    {
+        return;
+    }
+    size_t tokensSize = data->ring.maxTokens * data->ring.tokenSize;
+    uint8_t *tokens = malloc(tokensSize);
+    memcpy(tokens, data->ring.tokens, tokensSize);
+    free(data->ring.tokens);
+    data->ring.tokens = tokens;
 }
 
-static CsdfBufferStdLockFreeData *new_stdlockfree_buffer_data(const CsdfConnection *connection, unsigned maxTokens)
+static CsdfBufferStdLockFreeData *new_stdlockfree_buffer_data(size_t tokenSize, unsigned maxTokens, uint8_t *tokens, bool ownsTokens)
 {
     CsdfBufferStdLockFreeData *data = malloc(sizeof(CsdfBufferStdLockFreeData));
-    data->start = 0;
-    data->end = 0;
-    data->tokens = malloc(maxTokens * connection->tokenSize);
-    data->maxTokens = maxTokens;
-    memcpy(data->tokens, connection->initialTokens, connection->numTokens * connection->tokenSize);
-    data->end = connection->numTokens;
+    data->ring.header = &data->header;
+    data->ring.tokens = tokens;
+    data->ring.tokenSize = tokenSize;
+    data->ring.maxTokens = maxTokens;
+    data->ownsTokens = ownsTokens;
     return data;
 }
 
 static void delete_stdlockfree_buffer_data(void *bufferData)
 {
     CsdfBufferStdLockFreeData *data = bufferData;
-    free(data->tokens);
+    if (data->ownsTokens)
+    {
+        free(data->ring.tokens);
+    }
     free(data);
 }
 
-CsdfBuffer *new_stdlockfree_buffer(const CsdfConnection *connection, unsigned maxTokens)
+static CsdfBuffer *create_stdlockfree_buffer(const CsdfConnection *connection, unsigned maxTokens, uint8_t *tokens, bool ownsTokens)
 {
     CsdfBuffer *buffer = malloc(sizeof(CsdfBuffer));
     buffer->connection = connection;
-    buffer->data = new_stdlockfree_buffer_data(connection, maxTokens);
+    buffer->data = new_stdlockfree_buffer_data(connection->tokenSize, maxTokens, tokens, ownsTokens);
     buffer->pop = buffer_pop;
     buffer->push = buffer_push;
+    buffer->pushTokens = buffer_push_tokens;
+    buffer->popTokens = buffer_pop_tokens;
     buffer->numberOfTokens = number_tokens;
+    buffer->freeSpace = free_space;
+    buffer->hasTokens = has_tokens;
+    buffer->hasSpace = has_space;
+    buffer->reset = reset_buffer;
+    buffer->destroy = delete_stdlockfree_buffer;
+    buffer->rehome = rehome_buffer;
+    buffer->closed = NULL;
+    buffer->pool = NULL;
+    reset_buffer(buffer, connection->initialTokens);
     return buffer;
 }
 
+CsdfBuffer *new_stdlockfree_buffer(const CsdfConnection *connection, unsigned maxTokens)
+{
+    return create_stdlockfree_buffer(connection, maxTokens, malloc(maxTokens * connection->tokenSize), true);
+}
+
+size_t stdlockfree_buffer_bytes(unsigned maxTokens, size_t tokenSize)
+{
+    return sizeof(CsdfBuffer) + sizeof(CsdfBufferStdLockFreeData) + (size_t)maxTokens * tokenSize;
+}
+
+CsdfBuffer *new_stdlockfree_buffer_in(const CsdfConnection *connection, unsigned maxTokens, uint8_t *tokens)
+{
+    return create_stdlockfree_buffer(connection, maxTokens, tokens, false);
+}
+
 void delete_stdlockfree_buffer(CsdfBuffer *buffer)
 {
     delete_stdlockfree_buffer_data(buffer->data);
@@ -13,6 +13,15 @@ Copyright (c) 2023 Slaven Glumac
 
 CsdfBuffer *new_stdlockfree_buffer(const CsdfConnection *connection, unsigned maxTokens);
 
+// Uses caller-owned token storage of at least maxTokens tokens, which the
+// buffer leaves in place when deleted.
+CsdfBuffer *new_stdlockfree_buffer_in(const CsdfConnection *connection, unsigned maxTokens, uint8_t *tokens);
+
 void delete_stdlockfree_buffer(CsdfBuffer *buffer);
 
+// The bytes new_stdlockfree_buffer allocates for maxTokens slots of
+// tokenSize bytes. Buffers in caller-owned storage take those of zero-sized
+// tokens.
+size_t stdlockfree_buffer_bytes(unsigned maxTokens, size_t tokenSize);
+
 #endif // CSDF_EXECUTION_BUFFER_STDLOCKFREE_H
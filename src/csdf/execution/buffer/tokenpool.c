@@ -0,0 +1,124 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "tokenpool.h"
+
+#include <stdlib.h>
+
+static uint64_t pack_head(uint32_t handle, uint32_t tag)
+{
+    return (uint64_t)tag << 32 | handle;
+}
+
+static uint32_t head_handle(uint64_t head)
+{
+    return (uint32_t)head;
+}
+
+static uint32_t head_tag(uint64_t head)
+{
+    return (uint32_t)(head >> 32);
+}
+
+CsdfTokenPool *new_token_pool(size_t tokenSize, uint32_t numSlots)
+{
+    CsdfTokenPool *pool = malloc(sizeof(CsdfTokenPool));
+    pool->tokenSize = tokenSize;
+    pool->numSlots = numSlots;
+    pool->slots = malloc((size_t)numSlots * tokenSize);
+    pool->referenceCounts = malloc(numSlots * sizeof(atomic_uint));
+    pool->nextFree = malloc(numSlots * sizeof(uint32_t));
+    for (uint32_t handle = 0; handle < numSlots; handle++)
+    {
+        atomic_init(pool->referenceCounts + handle, 0);
+        atomic_init(pool->nextFree + handle, handle + 1 < numSlots ? handle + 1 : CSDF_NO_TOKEN_HANDLE);
+    }
+    atomic_init(&pool->freeHead, pack_head(numSlots > 0 ? 0 : CSDF_NO_TOKEN_HANDLE, 0));
+    atomic_init(&pool->numFree, numSlots);
+    return pool;
+}
+
+size_t token_pool_bytes(size_t tokenSize, uint32_t numSlots)
+{
+    return sizeof(CsdfTokenPool) + (size_t)numSlots * (tokenSize + sizeof(atomic_uint) + sizeof(uint32_t));
+}
+
+void delete_token_pool(CsdfTokenPool *pool)
+{
+    free((void *)pool->nextFree);
+    free(pool->referenceCounts);
+    free(pool->slots);
+    free(pool);
+}
+
+uint32_t acquire_token(CsdfTokenPool *pool, unsigned numReferences)
+{
+    uint64_t head = atomic_load_explicit(&pool->freeHead, memory_order_acquire);
+    uint32_t handle;
+    do
+    {
+        handle = head_handle(head);
+        if (handle == CSDF_NO_TOKEN_HANDLE)
+        {
+            return CSDF_NO_TOKEN_HANDLE;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(
+        &pool->freeHead, &head,
+        pack_head(atomic_load_explicit(pool->nextFree + handle, memory_order_relaxed), head_tag(head) + 1),
+        memory_order_acquire, memory_order_acquire));
+    atomic_store_explicit(pool->referenceCounts + handle, numReferences, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&pool->numFree, 1, memory_order_relaxed);
+    return handle;
+}
+
+bool acquire_tokens(CsdfTokenPool *pool, unsigned numTokens, unsigned numReferences, uint32_t *handles)
+{
+    for (unsigned tokenId = 0; tokenId < numTokens; tokenId++)
+    {
+        handles[tokenId] = acquire_token(pool, 1);
+        if (handles[tokenId] == CSDF_NO_TOKEN_HANDLE)
+        {
+            for (unsigned acquiredId = 0; acquiredId < tokenId; acquiredId++)
+            {
+                release_token(pool, handles[acquiredId]);
+            }
+            return false;
+        }
+    }
+    for (unsigned tokenId = 0; tokenId < numTokens; tokenId++)
+    {
+        atomic_store_explicit(pool->referenceCounts + handles[tokenId], numReferences, memory_order_relaxed);
+    }
+    return true;
+}
+
+unsigned token_pool_free(CsdfTokenPool *pool)
+{
+    return atomic_load_explicit(&pool->numFree, memory_order_relaxed);
+}
+
+void release_token(CsdfTokenPool *pool, uint32_t handle)
+{
+    if (atomic_fetch_sub_explicit(pool->referenceCounts + handle, 1, memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+    uint64_t head = atomic_load_explicit(&pool->freeHead, memory_order_relaxed);
+    do
+    {
+        atomic_store_explicit(pool->nextFree + handle, head_handle(head), memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(
+        &pool->freeHead, &head, pack_head(handle, head_tag(head) + 1),
+        memory_order_release, memory_order_relaxed));
+    atomic_fetch_add_explicit(&pool->numFree, 1, memory_order_relaxed);
+}
+
+uint8_t *token_slot(const CsdfTokenPool *pool, uint32_t handle)
+{
+    return pool->slots + (size_t)handle * pool->tokenSize;
+}
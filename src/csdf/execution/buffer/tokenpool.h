@@ -0,0 +1,53 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_BUFFER_TOKENPOOL_H
+#define CSDF_EXECUTION_BUFFER_TOKENPOOL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CSDF_NO_TOKEN_HANDLE UINT32_MAX
+
+// Preallocated reference-counted token slots. Free slots form a lock-free
+// stack whose head carries a tag against ABA, so any thread may release
+// while the producer acquires. numFree only grows while the single
+// producer is not acquiring, so the producer can check it for backpressure.
+typedef struct CsdfTokenPool
+{
+    size_t tokenSize;
+    uint32_t numSlots;
+    atomic_uint numFree;
+    uint8_t *slots;
+    atomic_uint *referenceCounts;
+    _Atomic uint32_t *nextFree;
+    _Atomic uint64_t freeHead;
+} CsdfTokenPool;
+
+CsdfTokenPool *new_token_pool(size_t tokenSize, uint32_t numSlots);
+
+void delete_token_pool(CsdfTokenPool *pool);
+
+size_t token_pool_bytes(size_t tokenSize, uint32_t numSlots);
+
+// Returns CSDF_NO_TOKEN_HANDLE when every slot is in use.
+uint32_t acquire_token(CsdfTokenPool *pool, unsigned numReferences);
+
+// Acquires numTokens slots at once or, when fewer are free, none and
+// returns false.
+bool acquire_tokens(CsdfTokenPool *pool, unsigned numTokens, unsigned numReferences, uint32_t *handles);
+
+unsigned token_pool_free(CsdfTokenPool *pool);
+
+void release_token(CsdfTokenPool *pool, uint32_t handle);
+
+uint8_t *token_slot(const CsdfTokenPool *pool, uint32_t handle);
+
+#endif // CSDF_EXECUTION_BUFFER_TOKENPOOL_H
@@ -0,0 +1,245 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "cluster.h"
+#include "buffer/socket.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define CONNECT_RETRY_MICROSECONDS 10000u
+
+// Sockets of the cross-node connections by connection id, -1 for the
+// others.
+typedef struct CsdfClusterSockets
+{
+    const CsdfGraph *graph;
+    const CsdfClusterPartition *partition;
+    size_t localNode;
+    int *sockets;
+} CsdfClusterSockets;
+
+static CsdfBuffer *cluster_buffer(void *context, size_t connectionId, unsigned maxTokens)
+{
+    CsdfClusterSockets *clusterSockets = context;
+    const CsdfConnection *connection = clusterSockets->graph->connections + connectionId;
+    int socket = clusterSockets->sockets[connectionId];
+    clusterSockets->sockets[connectionId] = -1;
+    return clusterSockets->partition->actorNodes[connection->source.actorId] == clusterSockets->localNode
+               ? new_socket_producer(connection, maxTokens, socket)
+               : new_socket_consumer(connection, maxTokens, socket);
+}
+
+static bool read_all(int socket, void *bytes, size_t numBytes)
+{
+    uint8_t *it = bytes;
+    while (numBytes > 0)
+    {
+        ssize_t numReceived = recv(socket, it, numBytes, 0);
+        if (numReceived <= 0)
+        {
+            return false;
+        }
+        it += numReceived;
+        numBytes -= (size_t)numReceived;
+    }
+    return true;
+}
+
+static struct addrinfo *resolve(const CsdfNodeAddress *address, bool passive)
+{
+    char port[8];
+    snprintf(port, sizeof(port), "%u", address->port);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    struct addrinfo *addresses = NULL;
+    return getaddrinfo(address->host, port, &hints, &addresses) == 0 ? addresses : NULL;
+}
+
+// Accepting gives up after timeoutMilliseconds.
+static int listen_on(const CsdfNodeAddress *address, unsigned timeoutMilliseconds)
+{
+    struct addrinfo *addresses = resolve(address, true);
+    if (addresses == NULL)
+    {
+        return -1;
+    }
+    int listener = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+    int reuse = 1;
+    struct timeval timeout = {.tv_sec = timeoutMilliseconds / 1000, .tv_usec = (timeoutMilliseconds % 1000) * 1000};
+    if (listener >= 0 && (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+                          setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+                          bind(listener, addresses->ai_addr, addresses->ai_addrlen) != 0 ||
+                          listen(listener, SOMAXCONN) != 0))
+    {
+        close(listener);
+        listener = -1;
+    }
+    freeaddrinfo(addresses);
+    return listener;
+}
+
+// Retries until the peer listens, sending the connection id once connected.
+static int connect_to(const CsdfThreading *threading, const CsdfNodeAddress *address, uint32_t connectionId, unsigned connectMilliseconds)
+{
+    struct addrinfo *addresses = resolve(address, false);
+    if (addresses == NULL)
+    {
+        return -1;
+    }
+    int connected = -1;
+    unsigned numAttempts = connectMilliseconds * 1000u / CONNECT_RETRY_MICROSECONDS + 1;
+    for (unsigned attempt = 0; attempt < numAttempts && connected < 0; attempt++)
+    {
+        connected = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+        if (connected >= 0 && connect(connected, addresses->ai_addr, addresses->ai_addrlen) != 0)
+        {
+            close(connected);
+            connected = -1;
+            threading->sleep(CONNECT_RETRY_MICROSECONDS);
+        }
+    }
+    freeaddrinfo(addresses);
+    uint32_t message = htonl(connectionId);
+    if (connected >= 0 && send(connected, &message, sizeof(message), MSG_NOSIGNAL) != sizeof(message))
+    {
+        close(connected);
+        connected = -1;
+    }
+    return connected;
+}
+
+// Whether a handshake names an incoming connection of the local node that
+// has no socket yet, so a repeated or foreign id cannot replace one.
+static bool is_incoming(const CsdfClusterSockets *clusterSockets, uint32_t connectionId)
+{
+    const CsdfGraph *graph = clusterSockets->graph;
+    const size_t *actorNodes = clusterSockets->partition->actorNodes;
+    if (connectionId >= graph->numConnections || clusterSockets->sockets[connectionId] >= 0)
+    {
+        return false;
+    }
+    const CsdfConnection *connection = graph->connections + connectionId;
+    return actorNodes[connection->source.actorId] != clusterSockets->localNode &&
+           actorNodes[connection->destination.actorId] == clusterSockets->localNode;
+}
+
+static bool open_sockets(const CsdfThreading *threading, CsdfClusterSockets *clusterSockets, unsigned connectMilliseconds)
+{
+    const CsdfGraph *graph = clusterSockets->graph;
+    const CsdfClusterPartition *partition = clusterSockets->partition;
+    size_t localNode = clusterSockets->localNode;
+    int listener = listen_on(partition->nodes + localNode, connectMilliseconds);
+    if (listener < 0)
+    {
+        return false;
+    }
+    bool opened = true;
+    size_t numIncoming = 0;
+    for (size_t connectionId = 0; connectionId < graph->numConnections && opened; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        size_t sourceNode = partition->actorNodes[connection->source.actorId];
+        size_t destinationNode = partition->actorNodes[connection->destination.actorId];
+        if (sourceNode == localNode && destinationNode != localNode)
+        {
+            int connected = connect_to(threading, partition->nodes + destinationNode, (uint32_t)connectionId, connectMilliseconds);
+            clusterSockets->sockets[connectionId] = connected;
+            opened = connected >= 0;
+        }
+        numIncoming += sourceNode != localNode && destinationNode == localNode;
+    }
+    for (size_t incomingId = 0; incomingId < numIncoming && opened; incomingId++)
+    {
+        int accepted = accept(listener, NULL, NULL);
+        uint32_t message;
+        opened = accepted >= 0 && read_all(accepted, &message, sizeof(message)) && is_incoming(clusterSockets, ntohl(message));
+        if (opened)
+        {
+            clusterSockets->sockets[ntohl(message)] = accepted;
+        }
+        else if (accepted >= 0)
+        {
+            close(accepted);
+        }
+    }
+    close(listener);
+    return opened;
+}
+
+CsdfGraphRun *new_cluster_graph_run(
+    const CsdfThreading *threading, const CsdfGraph *graph, unsigned numIterations,
+    const CsdfClusterPartition *partition, size_t localNode,
+    const CsdfGraphRunOptions *options, unsigned connectMilliseconds)
+{
+    CsdfClusterSockets clusterSockets = {.graph = graph, .partition = partition, .localNode = localNode};
+    clusterSockets.sockets = malloc(graph->numConnections * sizeof(int));
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        clusterSockets.sockets[connectionId] = -1;
+    }
+    CsdfGraphRun *runData = NULL;
+    if (open_sockets(threading, &clusterSockets, connectMilliseconds))
+    {
+        CsdfGraphRunOptions nodeOptions = {0};
+        if (options != NULL)
+        {
+            nodeOptions = *options;
+        }
+        nodeOptions.actorParts = partition->actorNodes;
+        nodeOptions.localPart = localNode;
+        nodeOptions.crossPartBuffer = cluster_buffer;
+        nodeOptions.crossPartContext = &clusterSockets;
+        runData = new_graph_run_with_options(graph, numIterations, &nodeOptions);
+    }
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        if (clusterSockets.sockets[connectionId] >= 0)
+        {
+            close(clusterSockets.sockets[connectionId]);
+        }
+    }
+    free(clusterSockets.sockets);
+    return runData;
+}
+
+#else
+
+CsdfGraphRun *new_cluster_graph_run(
+    const CsdfThreading *threading, const CsdfGraph *graph, unsigned numIterations,
+    const CsdfClusterPartition *partition, size_t localNode,
+    const CsdfGraphRunOptions *options, unsigned connectMilliseconds)
+{
+    (void)threading;
+    (void)graph;
+    (void)numIterations;
+    (void)partition;
+    (void)localNode;
+    (void)options;
+    (void)connectMilliseconds;
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,44 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_CLUSTER_H
+#define CSDF_EXECUTION_CLUSTER_H
+
+#include "graphrun.h"
+
+#include <threading4csdf.h>
+
+// Where a node accepts the connections of its consumers.
+typedef struct CsdfNodeAddress
+{
+    const char *host;
+    unsigned short port;
+    char _pad[6];
+} CsdfNodeAddress;
+
+// Assigns each actor to one of numNodes nodes.
+typedef struct CsdfClusterPartition
+{
+    size_t numNodes;
+    const CsdfNodeAddress *nodes;
+    const size_t *actorNodes;
+} CsdfClusterPartition;
+
+// Builds the part of a run that belongs to localNode, see actorParts in
+// CsdfGraphRunOptions. The node listens on its own address. It connects to
+// the consumer node of each outgoing cross-node connection and accepts a
+// connection for each incoming one, which then carry socket buffers, see
+// csdf/execution/buffer/socket.h. Every node of the partition has to call
+// this with the same graph, iterations and options. Returns NULL when a
+// peer cannot be reached within connectMilliseconds.
+CsdfGraphRun *new_cluster_graph_run(
+    const CsdfThreading *threading, const CsdfGraph *graph, unsigned numIterations,
+    const CsdfClusterPartition *partition, size_t localNode,
+    const CsdfGraphRunOptions *options, unsigned connectMilliseconds);
+
+#endif // CSDF_EXECUTION_CLUSTER_H
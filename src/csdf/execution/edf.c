@@ -0,0 +1,326 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "edf.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define NO_ACTOR SIZE_MAX
+
+// A worker claims an actor before it touches the actor's buffers, so each
+// actor fires on one worker at a time and the claim orders its firings.
+// Only the claiming worker updates the miss statistics.
+typedef struct CsdfEdfActor
+{
+    atomic_bool claimed;
+    char _pad[3];
+    atomic_uint numFirings;
+    uint64_t relativeDeadline;
+    uint64_t periodNanoseconds;
+    unsigned numMisses;
+    char _pad2[4];
+    int64_t minSlackNanoseconds;
+} CsdfEdfActor;
+
+typedef struct CsdfEdfRun
+{
+    const CsdfThreading *threading;
+    CsdfGraphRun *runData;
+    CsdfEdfActor *actors;
+    uint64_t startNanoseconds;
+    uint64_t iterationNanoseconds;
+    const CsdfWaitStrategy *wait;
+    CsdfProgress progress;
+    atomic_bool aborted;
+} CsdfEdfRun;
+
+typedef struct CsdfEdfWorker
+{
+    CsdfEdfRun *edf;
+    size_t *candidates;
+    uint64_t *candidateDeadlines;
+    size_t claimedActor;
+    CsdfTraceBuffer *traceBuffer;
+    void *threadData;
+} CsdfEdfWorker;
+
+CsdfEdfReport *new_edf_report(size_t numActors)
+{
+    CsdfEdfReport *report = malloc(sizeof(CsdfEdfReport));
+    report->numActors = numActors;
+    report->relativeDeadlines = malloc(numActors * sizeof(uint64_t));
+    report->numMisses = calloc(numActors, sizeof(unsigned));
+    report->minSlackNanoseconds = malloc(numActors * sizeof(int64_t));
+    return report;
+}
+
+void delete_edf_report(CsdfEdfReport *report)
+{
+    free(report->minSlackNanoseconds);
+    free(report->numMisses);
+    free(report->relativeDeadlines);
+    free(report);
+}
+
+static uint64_t inherited_deadline(uint64_t consumerDeadline, uint64_t consumerExecution)
+{
+    if (consumerDeadline == CSDF_NO_DEADLINE)
+    {
+        return CSDF_NO_DEADLINE;
+    }
+    return consumerDeadline > consumerExecution ? consumerDeadline - consumerExecution : 0;
+}
+
+// Relaxes producer deadlines toward their consumers' until nothing
+// changes. Cycles stop after one pass per actor.
+static void derive_deadlines(const CsdfGraph *graph, const CsdfEdfOptions *options, uint64_t *relativeDeadlines)
+{
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        bool hasDeadline = options->deadlineNanoseconds != NULL && options->deadlineNanoseconds[actorId] > 0;
+        relativeDeadlines[actorId] = hasDeadline ? options->deadlineNanoseconds[actorId] : CSDF_NO_DEADLINE;
+    }
+    bool changed = true;
+    for (size_t pass = 0; pass < graph->numActors && changed; pass++)
+    {
+        changed = false;
+        for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+        {
+            const CsdfConnection *connection = graph->connections + connectionId;
+            size_t source = connection->source.actorId;
+            size_t destination = connection->destination.actorId;
+            if (source == destination)
+            {
+                continue;
+            }
+            uint64_t execution = options->executionNanoseconds != NULL ? options->executionNanoseconds[destination] : 0;
+            uint64_t deadline = inherited_deadline(relativeDeadlines[destination], execution);
+            if (deadline < relativeDeadlines[source])
+            {
+                relativeDeadlines[source] = deadline;
+                changed = true;
+            }
+        }
+    }
+}
+
+static uint64_t firing_deadline(const CsdfEdfRun *edf, size_t actorId, unsigned firing)
+{
+    const CsdfEdfActor *actor = edf->actors + actorId;
+    if (actor->relativeDeadline == CSDF_NO_DEADLINE)
+    {
+        return CSDF_NO_DEADLINE;
+    }
+    uint64_t iteration = firing / edf->runData->repetitionVector[actorId];
+    return edf->startNanoseconds + iteration * edf->iterationNanoseconds + actor->relativeDeadline;
+}
+
+static bool is_released(const CsdfEdfRun *edf, size_t actorId, unsigned firing, uint64_t nowNanoseconds)
+{
+    uint64_t period = edf->actors[actorId].periodNanoseconds;
+    return period == 0 || edf->startNanoseconds + firing * period <= nowNanoseconds;
+}
+
+// Collects the released actors nobody has claimed by increasing deadline of
+// their next firing. Returns false once every actor finished.
+static bool collect_candidates(CsdfEdfWorker *worker, size_t *numCandidates)
+{
+    CsdfEdfRun *edf = worker->edf;
+    CsdfGraphRun *runData = edf->runData;
+    uint64_t nowNanoseconds = trace_timestamp();
+    bool unfinished = false;
+    *numCandidates = 0;
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        const CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        if (actorRun == NULL)
+        {
+            continue;
+        }
+        CsdfEdfActor *actor = edf->actors + actorId;
+        unsigned firing = atomic_load_explicit(&actor->numFirings, memory_order_acquire);
+        if (firing >= actorRun->maxFireCount)
+        {
+            continue;
+        }
+        unfinished = true;
+        if (atomic_load_explicit(&actor->claimed, memory_order_relaxed) || !is_released(edf, actorId, firing, nowNanoseconds))
+        {
+            continue;
+        }
+        uint64_t deadline = firing_deadline(edf, actorId, firing);
+        size_t position = (*numCandidates)++;
+        while (position > 0 && worker->candidateDeadlines[position - 1] > deadline)
+        {
+            worker->candidates[position] = worker->candidates[position - 1];
+            worker->candidateDeadlines[position] = worker->candidateDeadlines[position - 1];
+            position--;
+        }
+        worker->candidates[position] = actorId;
+        worker->candidateDeadlines[position] = deadline;
+    }
+    return unfinished;
+}
+
+// Claims the earliest-deadline candidate that can fire, or finds the run
+// finished or aborted, which leaves NO_ACTOR.
+static bool claim_earliest(void *workerData)
+{
+    CsdfEdfWorker *worker = workerData;
+    CsdfEdfRun *edf = worker->edf;
+    size_t numCandidates;
+    worker->claimedActor = NO_ACTOR;
+    if (!collect_candidates(worker, &numCandidates) || atomic_load(&edf->aborted))
+    {
+        return true;
+    }
+    for (size_t candidateId = 0; candidateId < numCandidates; candidateId++)
+    {
+        size_t actorId = worker->candidates[candidateId];
+        CsdfEdfActor *actor = edf->actors + actorId;
+        bool unclaimed = false;
+        if (!atomic_compare_exchange_strong_explicit(&actor->claimed, &unclaimed, true, memory_order_acquire, memory_order_relaxed))
+        {
+            continue;
+        }
+        if (can_fire(edf->runData->actorRuns[actorId]))
+        {
+            worker->claimedActor = actorId;
+            return true;
+        }
+        atomic_store_explicit(&actor->claimed, false, memory_order_release);
+    }
+    return false;
+}
+
+// Firings are traced into the buffer of the worker that claimed them.
+static void fire_claimed(CsdfEdfWorker *worker, size_t actorId)
+{
+    CsdfEdfRun *edf = worker->edf;
+    CsdfActorRun *actorRun = edf->runData->actorRuns[actorId];
+    CsdfEdfActor *actor = edf->actors + actorId;
+    unsigned firing = actorRun->fireCount;
+    actorRun->traceBuffer = worker->traceBuffer;
+    fire(actorRun);
+    if (actor->relativeDeadline != CSDF_NO_DEADLINE)
+    {
+        int64_t slack = (int64_t)(firing_deadline(edf, actorId, firing) - trace_timestamp());
+        actor->numMisses += slack < 0;
+        actor->minSlackNanoseconds = slack < actor->minSlackNanoseconds ? slack : actor->minSlackNanoseconds;
+    }
+    atomic_store_explicit(&actor->numFirings, actorRun->fireCount, memory_order_release);
+    atomic_store_explicit(&actor->claimed, false, memory_order_release);
+}
+
+static bool run_worker(void *workerData)
+{
+    CsdfEdfWorker *worker = workerData;
+    CsdfEdfRun *edf = worker->edf;
+    CsdfWaiter waiter;
+    init_waiter(&waiter, edf->wait, edf->threading, &edf->progress);
+    while (true)
+    {
+        wait_until(&waiter, claim_earliest, worker);
+        if (worker->claimedActor == NO_ACTOR)
+        {
+            return true;
+        }
+        fire_claimed(worker, worker->claimedActor);
+        signal_progress(&edf->progress);
+    }
+}
+
+static void init_actors(CsdfEdfRun *edf, const CsdfEdfOptions *options)
+{
+    CsdfGraphRun *runData = edf->runData;
+    const CsdfGraph *graph = runData->graph;
+    uint64_t *relativeDeadlines = malloc(graph->numActors * sizeof(uint64_t));
+    derive_deadlines(graph, options, relativeDeadlines);
+    edf->actors = malloc(graph->numActors * sizeof(CsdfEdfActor));
+    edf->iterationNanoseconds = 0;
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        CsdfEdfActor *actor = edf->actors + actorId;
+        const CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        atomic_init(&actor->claimed, false);
+        atomic_init(&actor->numFirings, actorRun != NULL ? actorRun->fireCount : 0);
+        actor->relativeDeadline = relativeDeadlines[actorId];
+        actor->periodNanoseconds = options->periodNanoseconds != NULL ? options->periodNanoseconds[actorId] : 0;
+        actor->numMisses = 0;
+        actor->minSlackNanoseconds = INT64_MAX;
+        uint64_t iterationNanoseconds = actor->periodNanoseconds * runData->repetitionVector[actorId];
+        edf->iterationNanoseconds = iterationNanoseconds > edf->iterationNanoseconds ? iterationNanoseconds : edf->iterationNanoseconds;
+    }
+    free(relativeDeadlines);
+}
+
+static void fill_report(const CsdfEdfRun *edf, CsdfEdfReport *report)
+{
+    for (size_t actorId = 0; actorId < report->numActors; actorId++)
+    {
+        const CsdfEdfActor *actor = edf->actors + actorId;
+        report->relativeDeadlines[actorId] = actor->relativeDeadline;
+        report->numMisses[actorId] = actor->numMisses;
+        report->minSlackNanoseconds[actorId] = actor->minSlackNanoseconds;
+    }
+}
+
+bool edf_run(const CsdfThreading *threading, CsdfGraphRun *runData, const CsdfEdfOptions *options, CsdfEdfReport *report)
+{
+    if (runData->sharedBufferMemory != NULL || !graph_run_inputs_attached(runData))
+    {
+        return false;
+    }
+    CsdfEdfOptions defaultOptions = {.numWorkers = 1};
+    options = options != NULL ? options : &defaultOptions;
+    size_t numActors = runData->graph->numActors;
+    CsdfEdfRun edf = {.threading = threading, .runData = runData, .wait = options->wait};
+    init_progress(&edf.progress);
+    atomic_init(&edf.aborted, false);
+    init_actors(&edf, options);
+
+    size_t numWorkers = options->numWorkers > 0 ? options->numWorkers : 1;
+    CsdfEdfWorker *workers = malloc(numWorkers * sizeof(CsdfEdfWorker));
+    edf.startNanoseconds = trace_timestamp();
+    bool completed = true;
+    size_t numStarted = 0;
+    for (size_t workerId = 0; workerId < numWorkers && completed; workerId++)
+    {
+        CsdfEdfWorker *worker = workers + workerId;
+        worker->edf = &edf;
+        worker->traceBuffer = trace_thread_buffer(runData->trace, workerId);
+        worker->candidates = malloc(numActors * sizeof(size_t));
+        worker->candidateDeadlines = malloc(numActors * sizeof(uint64_t));
+        worker->threadData = malloc(threading->threadDataSize);
+        completed = threading->createThread(worker->threadData, run_worker, worker);
+        numStarted += completed;
+    }
+    if (!completed)
+    {
+        atomic_store(&edf.aborted, true);
+        signal_progress(&edf.progress);
+    }
+    for (size_t workerId = 0; workerId < numStarted; workerId++)
+    {
+        completed = threading->joinThread(workers[workerId].threadData) && completed;
+    }
+    for (size_t workerId = 0; workerId < numWorkers && workerId <= numStarted; workerId++)
+    {
+        free(workers[workerId].threadData);
+        free(workers[workerId].candidateDeadlines);
+        free(workers[workerId].candidates);
+    }
+    if (report != NULL)
+    {
+        fill_report(&edf, report);
+    }
+    free(workers);
+    free(edf.actors);
+    return completed;
+}
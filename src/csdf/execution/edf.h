@@ -0,0 +1,61 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_EDF_H
+#define CSDF_EXECUTION_EDF_H
+
+#include "graphrun.h"
+#include "wait.h"
+
+#include <threading4csdf.h>
+
+#include <stdint.h>
+
+#define CSDF_NO_DEADLINE UINT64_MAX
+
+// Actors with a nonzero periodNanoseconds are released periodically: their
+// k-th firing starts no earlier than k periods after the run starts. The
+// longest period of a whole iteration among them releases iteration i at i
+// such periods. A nonzero deadlineNanoseconds gives an actor, usually a
+// sink, a deadline relative to the release of each iteration. Other actors
+// inherit the tightest deadline of their consumers, less the consumer's
+// executionNanoseconds estimate when given. Actors without a deadline
+// downstream fire last.
+//
+// numWorkers threads take the ready firing with the earliest deadline, so
+// every actor may fire on any worker. Workers without a ready firing wait
+// as set by wait, which defaults to sleeping, and trace into the buffer of
+// their index.
+typedef struct CsdfEdfOptions
+{
+    size_t numWorkers;
+    const uint64_t *periodNanoseconds;
+    const uint64_t *deadlineNanoseconds;
+    const uint64_t *executionNanoseconds;
+    const CsdfWaitStrategy *wait;
+} CsdfEdfOptions;
+
+// Per actor, the derived relative deadline, CSDF_NO_DEADLINE for none, the
+// firings that finished after their deadline and the smallest slack of a
+// firing, which is negative for misses and INT64_MAX without deadline.
+typedef struct CsdfEdfReport
+{
+    size_t numActors;
+    uint64_t *relativeDeadlines;
+    unsigned *numMisses;
+    int64_t *minSlackNanoseconds;
+} CsdfEdfReport;
+
+CsdfEdfReport *new_edf_report(size_t numActors);
+
+void delete_edf_report(CsdfEdfReport *report);
+
+// Runs whose buffers share memory are rejected. report may be NULL.
+bool edf_run(const CsdfThreading *threading, CsdfGraphRun *runData, const CsdfEdfOptions *options, CsdfEdfReport *report);
+
+#endif // CSDF_EXECUTION_EDF_H
@@ -7,46 +7,332 @@ Copyright (c) 2023 Slaven Glumac
 ****************************************************************************/
 
 #include "graphrun.h"
+#include "buffer/pooled.h"
 #include "buffer/stdlockfree.h"
 
 #include <csdf/repetition.h>
+#include <csdf/schedule.h>
+#include <csdf/record/mmapfile.h>
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-static size_t calculate_buffer_max_tokens(CsdfGraphRun *runData, const CsdfConnection *connection)
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define DEFAULT_CACHE_BYTES (256u * 1024u)
+#define BUFFERED_ITERATIONS 150u
+
+static size_t buffer_max_tokens(const CsdfGraph *graph, const unsigned *repetitionVector, const CsdfConnection *connection, unsigned numIterations)
 {
     size_t numInitialTokens = connection->numTokens;
     size_t actorId = connection->source.actorId;
-    const CsdfActor *actor = runData->graph->actors + actorId;
+    const CsdfActor *actor = graph->actors + actorId;
     const CsdfOutput *output = actor->outputs + connection->source.outputId;
-    size_t potentiallyProducedTokens = runData->repetitionVector[actorId] * output->production;
-    return numInitialTokens + 150 * potentiallyProducedTokens + 1;
+    size_t potentiallyProducedTokens = repetitionVector[actorId] * output->production;
+    return numInitialTokens + numIterations * potentiallyProducedTokens + 1;
+}
+
+static size_t calculate_buffer_max_tokens(CsdfGraphRun *runData, const CsdfConnection *connection)
+{
+    unsigned numIterations = runData->blockingFactor > runData->bufferedIterations ? runData->blockingFactor : runData->bufferedIterations;
+    return buffer_max_tokens(runData->graph, runData->repetitionVector, connection, numIterations);
+}
+
+unsigned graph_buffer_capacity(const CsdfGraph *graph, const unsigned *repetitionVector, const CsdfConnection *connection)
+{
+    return buffer_max_tokens(graph, repetitionVector, connection, BUFFERED_ITERATIONS);
+}
+
+static size_t data_cache_bytes(void)
+{
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    long cacheBytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (cacheBytes > 0)
+    {
+        return (size_t)cacheBytes;
+    }
+#endif
+    return DEFAULT_CACHE_BYTES;
+}
+
+static void create_block_schedule(CsdfGraphRun *runData, const CsdfGraphRunOptions *options)
+{
+    unsigned blockingFactor = options != NULL && !options->shareBufferMemory ? options->blockingFactor : 0;
+    if (blockingFactor == CSDF_AUTO_BLOCKING_FACTOR)
+    {
+        size_t cacheBytes = options->cacheBytes > 0 ? options->cacheBytes : data_cache_bytes();
+        blockingFactor = choose_blocking_factor(runData->graph, runData->repetitionVector, cacheBytes);
+    }
+    runData->bufferedIterations = options != NULL && options->bufferedIterations > 0 ? options->bufferedIterations : BUFFERED_ITERATIONS;
+    runData->blockingFactor = 1;
+    runData->blockSchedule = NULL;
+    if (blockingFactor > 1)
+    {
+        runData->blockSchedule = new_blocked_schedule(runData->graph, runData->repetitionVector, blockingFactor);
+        runData->blockingFactor = runData->blockSchedule != NULL ? blockingFactor : 1;
+    }
+}
+
+// Beyond the tokens in its rings, the pool covers the tokens a producer
+// writes while it fires and those each consumer holds while it fires or
+// copies them out.
+static uint32_t token_pool_slots(CsdfGraphRun *runData, CsdfOutputId source)
+{
+    const CsdfGraph *graph = runData->graph;
+    size_t maxSharedTokens = 0;
+    size_t numInitialTokens = 0;
+    size_t numHeldTokens = graph->actors[source.actorId].outputs[source.outputId].production;
+    size_t numConnected = 0;
+    for (size_t bufferId = 0; bufferId < graph->numConnections; bufferId++)
+    {
+        const CsdfConnection *connection = graph->connections + bufferId;
+        if (connection->source.actorId == source.actorId && connection->source.outputId == source.outputId)
+        {
+            size_t maxTokens = calculate_buffer_max_tokens(runData, connection) - 1;
+            unsigned consumption = graph->actors[connection->destination.actorId].inputs[connection->destination.inputId].consumption;
+            maxSharedTokens = maxTokens > maxSharedTokens ? maxTokens : maxSharedTokens;
+            numInitialTokens += connection->numTokens;
+            numHeldTokens += consumption > CSDF_POOLED_HELD_HANDLES ? consumption : CSDF_POOLED_HELD_HANDLES;
+            numConnected++;
+        }
+    }
+    return numConnected > 0 ? (uint32_t)(maxSharedTokens + numInitialTokens + numHeldTokens) : 0;
+}
+
+static CsdfTokenPool *create_token_pool(CsdfGraphRun *runData, CsdfOutputId source, size_t tokenSize)
+{
+    uint32_t numSlots = token_pool_slots(runData, source);
+    return numSlots > 0 ? new_token_pool(tokenSize, numSlots) : NULL;
+}
+
+static CsdfTokenPool *find_token_pool(CsdfGraphRun *runData, CsdfOutputId source)
+{
+    if (runData->tokenPools == NULL)
+    {
+        return NULL;
+    }
+    size_t poolId = source.outputId;
+    for (size_t actorId = 0; actorId < source.actorId; actorId++)
+    {
+        poolId += runData->graph->actors[actorId].numOutputs;
+    }
+    return runData->tokenPools[poolId];
+}
+
+static CsdfBufferPacking *pack_buffers(const CsdfGraph *graph, const unsigned *repetitionVector)
+{
+    CsdfSchedule *schedule = new_sequential_schedule(graph, repetitionVector);
+    if (schedule == NULL)
+    {
+        return NULL;
+    }
+    CsdfBufferPacking *packing = new_buffer_packing(graph, schedule);
+    delete_schedule(schedule);
+    return packing;
+}
+
+static bool create_shared_buffers(CsdfGraphRun *runData)
+{
+    const CsdfGraph *graph = runData->graph;
+    CsdfBufferPacking *packing = pack_buffers(graph, runData->repetitionVector);
+    if (packing == NULL)
+    {
+        return false;
+    }
+    runData->bufferPacking = packing;
+    runData->sharedBufferMemory = malloc(packing->packedBytes);
+    runData->buffers = malloc(graph->numConnections * sizeof(CsdfBuffer *));
+    for (size_t bufferId = 0; bufferId < graph->numConnections; bufferId++)
+    {
+        uint8_t *tokens = runData->sharedBufferMemory + packing->regionOffsets[packing->regionIds[bufferId]];
+        runData->buffers[bufferId] = new_stdlockfree_buffer_in(graph->connections + bufferId, packing->lifetimes[bufferId].maxTokens, tokens);
+    }
+    return true;
+}
+
+static bool is_local(const CsdfGraphRunOptions *options, size_t actorId)
+{
+    return options == NULL || options->actorParts == NULL || options->actorParts[actorId] == options->localPart;
+}
+
+static bool create_part_buffers(CsdfGraphRun *runData, const CsdfGraphRunOptions *options)
+{
+    const CsdfGraph *graph = runData->graph;
+    runData->buffers = malloc(graph->numConnections * sizeof(CsdfBuffer *));
+    bool created = true;
+    for (size_t bufferId = 0; bufferId < graph->numConnections; bufferId++)
+    {
+        const CsdfConnection *connection = graph->connections + bufferId;
+        bool localSource = is_local(options, connection->source.actorId);
+        bool localDestination = is_local(options, connection->destination.actorId);
+        unsigned maxTokens = calculate_buffer_max_tokens(runData, connection);
+        CsdfBuffer *buffer = NULL;
+        if (localSource && localDestination)
+        {
+            buffer = new_stdlockfree_buffer(connection, maxTokens);
+        }
+        else if (localSource || localDestination)
+        {
+            buffer = options->crossPartBuffer(options->crossPartContext, bufferId, maxTokens);
+            created = created && buffer != NULL;
+        }
+        runData->buffers[bufferId] = buffer;
+    }
+    return created;
 }
 
-static void create_buffers(CsdfGraphRun *runData)
+static bool create_buffers(CsdfGraphRun *runData, const CsdfGraphRunOptions *options)
 {
     const CsdfGraph *graph = runData->graph;
+    size_t largeTokenThreshold = options != NULL ? options->largeTokenThreshold : 0;
+    runData->numTokenPools = 0;
+    runData->tokenPools = NULL;
+    runData->bufferPacking = NULL;
+    runData->sharedBufferMemory = NULL;
+    if (options != NULL && options->actorParts != NULL)
+    {
+        return create_part_buffers(runData, options);
+    }
+    if (options != NULL && options->shareBufferMemory && create_shared_buffers(runData))
+    {
+        return true;
+    }
+    if (largeTokenThreshold > 0)
+    {
+        for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+        {
+            runData->numTokenPools += graph->actors[actorId].numOutputs;
+        }
+        runData->tokenPools = malloc(runData->numTokenPools * sizeof(CsdfTokenPool *));
+        size_t poolId = 0;
+        for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+        {
+            const CsdfActor *actor = graph->actors + actorId;
+            for (size_t outputId = 0; outputId < actor->numOutputs; outputId++, poolId++)
+            {
+                size_t tokenSize = actor->outputs[outputId].tokenSize;
+                CsdfOutputId source = {.actorId = actorId, .outputId = outputId};
+                runData->tokenPools[poolId] = tokenSize >= largeTokenThreshold
+                                                  ? create_token_pool(runData, source, tokenSize)
+                                                  : NULL;
+            }
+        }
+    }
+
     runData->buffers = malloc(graph->numConnections * sizeof(CsdfBuffer *));
+    bool created = true;
     for (size_t bufferId = 0; bufferId < graph->numConnections; bufferId++)
     {
         const CsdfConnection *connection = graph->connections + bufferId;
+        unsigned maxTokens = calculate_buffer_max_tokens(runData, connection);
+        CsdfTokenPool *pool = find_token_pool(runData, connection->source);
+        runData->buffers[bufferId] = pool != NULL
+                                         ? new_pooled_buffer(connection, maxTokens, pool)
+                                         : new_stdlockfree_buffer(connection, maxTokens);
+        created = created && runData->buffers[bufferId] != NULL;
+    }
+    return created;
+}
 
-        runData->buffers[bufferId] = new_stdlockfree_buffer(connection, calculate_buffer_max_tokens(runData, connection));
+static bool select_record_options(size_t actorId, const CsdfGraphRunOptions *options, CsdfRecordOption *outputOptions)
+{
+    bool anyRecorded = false;
+    for (size_t selectionId = 0; selectionId < options->numRecordSelections; selectionId++)
+    {
+        const CsdfRecordSelection *selection = options->recordSelections + selectionId;
+        if (selection->output.actorId == actorId && selection->option.mode != CSDF_RECORD_NONE)
+        {
+            outputOptions[selection->output.outputId] = selection->option;
+            anyRecorded = true;
+        }
+    }
+    return anyRecorded;
+}
+
+// Unbounded runs could only size full and every-N records for UINT_MAX
+// firings, and runs without options record everything in full.
+static bool records_bounded(unsigned numIterations, const CsdfGraphRunOptions *options)
+{
+    if (numIterations != CSDF_UNBOUNDED_ITERATIONS)
+    {
+        return true;
+    }
+    if (options == NULL)
+    {
+        return false;
+    }
+    for (size_t selectionId = 0; selectionId < options->numRecordSelections; selectionId++)
+    {
+        CsdfRecordMode mode = options->recordSelections[selectionId].option.mode;
+        if (mode == CSDF_RECORD_FULL || mode == CSDF_RECORD_EVERY)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Fails when the record file of a recorded actor cannot be created.
+static bool create_record_data(const CsdfActor *actor, size_t actorId, size_t maxFireCount, const CsdfGraphRunOptions *options, CsdfRecordData **recordData)
+{
+    *recordData = NULL;
+    if (options == NULL)
+    {
+        *recordData = actor->numOutputs > 0 ? new_record_produced(actor, maxFireCount) : NULL;
+        return true;
+    }
+    CsdfRecordOption *outputOptions = calloc(actor->numOutputs, sizeof(CsdfRecordOption));
+    bool anyRecorded = select_record_options(actorId, options, outputOptions);
+    if (anyRecorded && options->recordDirectory != NULL)
+    {
+        size_t pathSize = strlen(options->recordDirectory) + 32;
+        char *path = malloc(pathSize);
+        snprintf(path, pathSize, "%s/actor%zu.csdfrec", options->recordDirectory, actorId);
+        *recordData = new_mmap_record_produced(actor, maxFireCount, outputOptions, path);
+        free(path);
+        free(outputOptions);
+        return *recordData != NULL;
     }
+    if (anyRecorded)
+    {
+        *recordData = new_record_produced_with_options(actor, maxFireCount, outputOptions);
+    }
+    free(outputOptions);
+    return true;
+}
+
+static size_t max_fire_count(const CsdfGraphRun *runData, unsigned numIterations, size_t actorId)
+{
+    return numIterations == CSDF_UNBOUNDED_ITERATIONS
+               ? CSDF_UNBOUNDED_FIRE_COUNT
+               : numIterations * runData->repetitionVector[actorId];
 }
 
-static void create_actor_runs(CsdfGraphRun *runData, unsigned numIterations)
+// Leaves NULL in actorRuns from the first actor whose record fails.
+static bool create_actor_runs(CsdfGraphRun *runData, unsigned numIterations, const CsdfGraphRunOptions *options)
 {
     const CsdfGraph *graph = runData->graph;
-    runData->actorRuns = malloc(graph->numActors * sizeof(CsdfActorRun *));
+    runData->actorRuns = calloc(graph->numActors, sizeof(CsdfActorRun *));
+    runData->numIterations = numIterations;
     for (size_t actorId = 0; actorId < graph->numActors; actorId++)
     {
         const CsdfActor *actor = graph->actors + actorId;
+        if (!is_local(options, actorId))
+        {
+            continue;
+        }
 
-        size_t maxFireCount = numIterations * runData->repetitionVector[actorId];
-        CsdfRecordData *recordData = new_record_produced(actor, maxFireCount);
+        size_t maxFireCount = max_fire_count(runData, numIterations, actorId);
+        CsdfRecordData *recordData;
+        if (!create_record_data(actor, actorId, maxFireCount, options, &recordData))
+        {
+            return false;
+        }
 
-        CsdfBuffer **inputBuffers = malloc(actor->numInputs * sizeof(CsdfBuffer *));
+        CsdfBuffer **inputBuffers = calloc(actor->numInputs, sizeof(CsdfBuffer *));
         CsdfBuffer ***outputBuffers = malloc(actor->numOutputs * sizeof(CsdfBuffer **));
 
         size_t *numOutputBuffers = calloc(actor->numOutputs, sizeof(size_t));
@@ -83,42 +369,525 @@ static void create_actor_runs(CsdfGraphRun *runData, unsigned numIterations)
             actor, recordData, inputBuffers, outputBuffers,
             numOutputBuffers, maxFireCount);
     }
-    runData->numIterations = numIterations;
+    return true;
 }
 
-CsdfGraphRun *new_graph_run(const CsdfGraph *graph, unsigned numIterations)
+static void destroy_buffers(CsdfGraphRun *runData)
+{
+    for (size_t bufferId = 0; bufferId < runData->graph->numConnections; bufferId++)
+    {
+        CsdfBuffer *buffer = runData->buffers[bufferId];
+        if (buffer != NULL)
+        {
+            buffer->destroy(buffer);
+        }
+    }
+}
+
+static void destroy_token_pools(CsdfGraphRun *runData)
+{
+    for (size_t poolId = 0; poolId < runData->numTokenPools; poolId++)
+    {
+        if (runData->tokenPools[poolId] != NULL)
+        {
+            delete_token_pool(runData->tokenPools[poolId]);
+        }
+    }
+}
+
+CsdfGraphRun *new_graph_run_with_options(const CsdfGraph *graph, unsigned numIterations, const CsdfGraphRunOptions *options)
 {
+    if (!records_bounded(numIterations, options))
+    {
+        return NULL;
+    }
     CsdfGraphRun *runData = malloc(sizeof(CsdfGraphRun));
     runData->graph = graph;
-    unsigned int *repetitionVector = malloc(graph->numActors * sizeof(size_t));
+    unsigned int *repetitionVector = malloc(graph->numActors * sizeof(unsigned int));
     csdf_repetition_vector(graph, repetitionVector);
     runData->repetitionVector = repetitionVector;
-    create_buffers(runData);
-    create_actor_runs(runData, numIterations);
+    create_block_schedule(runData, options);
+    if (!create_buffers(runData, options))
+    {
+        destroy_buffers(runData);
+        destroy_token_pools(runData);
+        free(runData->buffers);
+        free(runData->tokenPools);
+        if (runData->blockSchedule != NULL)
+        {
+            delete_schedule(runData->blockSchedule);
+        }
+        free(repetitionVector);
+        free(runData);
+        return NULL;
+    }
+    runData->remainingFirings = malloc(graph->numActors * sizeof(unsigned int));
+    runData->trace = NULL;
+    runData->latency = NULL;
+    if (!create_actor_runs(runData, numIterations, options))
+    {
+        delete_graph_run(runData);
+        return NULL;
+    }
     return runData;
 }
 
-void delete_graph_run(CsdfGraphRun *runData)
+CsdfGraphRun *new_graph_run(const CsdfGraph *graph, unsigned numIterations)
 {
-    for (size_t bufferId = 0; bufferId < runData->graph->numConnections; bufferId++)
+    return new_graph_run_with_options(graph, numIterations, NULL);
+}
+
+static void plan_shared_buffers(const CsdfBufferPacking *packing, CsdfGraphRunFootprint *footprint)
+{
+    for (size_t bufferId = 0; bufferId < footprint->numConnections; bufferId++)
+    {
+        footprint->bufferBytes[bufferId] = stdlockfree_buffer_bytes(packing->lifetimes[bufferId].maxTokens, 0);
+    }
+    footprint->sharedBufferBytes = packing->packedBytes;
+    footprint->bookkeepingBytes += sizeof(CsdfBufferPacking) +
+                                   footprint->numConnections * (sizeof(CsdfBufferLifetime) + 3 * sizeof(size_t));
+}
+
+static void plan_buffers(CsdfGraphRun *sizing, const CsdfGraphRunOptions *options, CsdfGraphRunFootprint *footprint)
+{
+    const CsdfGraph *graph = sizing->graph;
+    bool partial = options != NULL && options->actorParts != NULL;
+    if (!partial && options != NULL && options->shareBufferMemory)
+    {
+        CsdfBufferPacking *packing = pack_buffers(graph, sizing->repetitionVector);
+        if (packing != NULL)
+        {
+            plan_shared_buffers(packing, footprint);
+            delete_buffer_packing(packing);
+            return;
+        }
+    }
+    size_t largeTokenThreshold = options != NULL && !partial ? options->largeTokenThreshold : 0;
+    if (largeTokenThreshold > 0)
+    {
+        footprint->bookkeepingBytes += footprint->numOutputs * sizeof(CsdfTokenPool *);
+        for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+        {
+            const CsdfActor *actor = graph->actors + actorId;
+            for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+            {
+                size_t tokenSize = actor->outputs[outputId].tokenSize;
+                CsdfOutputId source = {.actorId = actorId, .outputId = outputId};
+                uint32_t numSlots = tokenSize >= largeTokenThreshold ? token_pool_slots(sizing, source) : 0;
+                footprint->tokenPoolBytes += numSlots > 0 ? token_pool_bytes(tokenSize, numSlots) : 0;
+            }
+        }
+    }
+    for (size_t bufferId = 0; bufferId < graph->numConnections; bufferId++)
+    {
+        const CsdfConnection *connection = graph->connections + bufferId;
+        if (!is_local(options, connection->source.actorId) || !is_local(options, connection->destination.actorId))
+        {
+            continue;
+        }
+        unsigned maxTokens = calculate_buffer_max_tokens(sizing, connection);
+        const CsdfOutput *output = graph->actors[connection->source.actorId].outputs + connection->source.outputId;
+        bool pooled = largeTokenThreshold > 0 && output->tokenSize >= largeTokenThreshold &&
+                      token_pool_slots(sizing, connection->source) > 0;
+        footprint->bufferBytes[bufferId] = pooled
+                                               ? pooled_buffer_bytes(maxTokens)
+                                               : stdlockfree_buffer_bytes(maxTokens, connection->tokenSize);
+    }
+}
+
+static void plan_actor_runs(CsdfGraphRun *sizing, unsigned numIterations, const CsdfGraphRunOptions *options, CsdfGraphRunFootprint *footprint)
+{
+    const CsdfGraph *graph = sizing->graph;
+    size_t *outputRecordBytes = footprint->recordBytes;
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
     {
-        delete_stdlockfree_buffer(runData->buffers[bufferId]);
+        const CsdfActor *actor = graph->actors + actorId;
+        size_t *recordBytes = outputRecordBytes;
+        outputRecordBytes += actor->numOutputs;
+        if (!is_local(options, actorId))
+        {
+            continue;
+        }
+        footprint->scratchBytes[actorId] = actor_run_scratch_bytes(actor);
+        footprint->bookkeepingBytes += sizeof(CsdfActorRun) + actor->numInputs * sizeof(CsdfBuffer *) +
+                                       actor->numOutputs * (sizeof(CsdfBuffer **) + sizeof(size_t));
+        for (size_t bufferId = 0; bufferId < graph->numConnections; bufferId++)
+        {
+            footprint->bookkeepingBytes += graph->connections[bufferId].source.actorId == actorId ? sizeof(CsdfBuffer *) : 0;
+        }
+
+        CsdfRecordOption *outputOptions = calloc(actor->numOutputs, sizeof(CsdfRecordOption));
+        bool anyRecorded = options != NULL ? select_record_options(actorId, options, outputOptions) : actor->numOutputs > 0;
+        for (size_t outputId = 0; outputId < actor->numOutputs && options == NULL; outputId++)
+        {
+            outputOptions[outputId].mode = CSDF_RECORD_FULL;
+        }
+        if (anyRecorded)
+        {
+            size_t maxFireCount = max_fire_count(sizing, numIterations, actorId);
+            footprint->bookkeepingBytes += record_produced_bytes(actor, maxFireCount, outputOptions, recordBytes);
+        }
+        free(outputOptions);
+    }
+}
+
+static size_t sum_bytes(const size_t *bytes, size_t numItems)
+{
+    size_t sum = 0;
+    for (size_t itemId = 0; itemId < numItems; itemId++)
+    {
+        sum += bytes[itemId];
+    }
+    return sum;
+}
+
+CsdfGraphRunFootprint *new_graph_run_footprint(const CsdfGraph *graph, unsigned numIterations, const CsdfGraphRunOptions *options)
+{
+    if (!records_bounded(numIterations, options))
+    {
+        return NULL;
+    }
+    unsigned int *repetitionVector = malloc(graph->numActors * sizeof(unsigned int));
+    if (!csdf_repetition_vector(graph, repetitionVector))
+    {
+        free(repetitionVector);
+        return NULL;
+    }
+    CsdfGraphRun sizing = {.graph = graph, .repetitionVector = repetitionVector};
+    create_block_schedule(&sizing, options);
+
+    CsdfGraphRunFootprint *footprint = malloc(sizeof(CsdfGraphRunFootprint));
+    footprint->numConnections = graph->numConnections;
+    footprint->bufferBytes = calloc(graph->numConnections, sizeof(size_t));
+    footprint->numActors = graph->numActors;
+    footprint->scratchBytes = calloc(graph->numActors, sizeof(size_t));
+    footprint->numOutputs = 0;
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        footprint->numOutputs += graph->actors[actorId].numOutputs;
     }
+    footprint->recordBytes = calloc(footprint->numOutputs, sizeof(size_t));
+    footprint->tokenPoolBytes = 0;
+    footprint->sharedBufferBytes = 0;
+    footprint->bookkeepingBytes = sizeof(CsdfGraphRun) +
+                                  graph->numActors * (2 * sizeof(unsigned int) + sizeof(CsdfActorRun *)) +
+                                  graph->numConnections * sizeof(CsdfBuffer *);
+    if (sizing.blockSchedule != NULL)
+    {
+        footprint->bookkeepingBytes += sizeof(CsdfSchedule) + sizing.blockSchedule->numEntries * sizeof(CsdfScheduleEntry);
+        delete_schedule(sizing.blockSchedule);
+    }
+    plan_buffers(&sizing, options, footprint);
+    plan_actor_runs(&sizing, numIterations, options, footprint);
+    footprint->totalBytes = sum_bytes(footprint->bufferBytes, footprint->numConnections) +
+                            sum_bytes(footprint->scratchBytes, footprint->numActors) +
+                            sum_bytes(footprint->recordBytes, footprint->numOutputs) +
+                            footprint->tokenPoolBytes + footprint->sharedBufferBytes + footprint->bookkeepingBytes;
+    free(repetitionVector);
+    return footprint;
+}
+
+void delete_graph_run_footprint(CsdfGraphRunFootprint *footprint)
+{
+    free(footprint->recordBytes);
+    free(footprint->scratchBytes);
+    free(footprint->bufferBytes);
+    free(footprint);
+}
+
+void delete_graph_run(CsdfGraphRun *runData)
+{
+    destroy_buffers(runData);
+    destroy_token_pools(runData);
     for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
     {
         CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        if (actorRun == NULL)
+        {
+            continue;
+        }
         for (size_t outputId = 0; outputId < actorRun->actor->numOutputs; outputId++)
         {
             free(actorRun->outputBuffers[outputId]);
         }
-        delete_record_produced(actorRun->recordData);
+        if (actorRun->recordData != NULL)
+        {
+            delete_record_produced(actorRun->recordData);
+        }
         free(actorRun->inputBuffers);
         free(actorRun->outputBuffers);
         free(actorRun->numOutputBuffers);
         delete_actor_run(actorRun);
     }
+    if (runData->trace != NULL)
+    {
+        delete_trace(runData->trace);
+    }
+    if (runData->latency != NULL)
+    {
+        delete_latency_tracking(runData->latency);
+    }
     free(runData->buffers);
+    free(runData->tokenPools);
+    if (runData->blockSchedule != NULL)
+    {
+        delete_schedule(runData->blockSchedule);
+    }
+    if (runData->bufferPacking != NULL)
+    {
+        delete_buffer_packing(runData->bufferPacking);
+    }
+    free(runData->sharedBufferMemory);
+    free(runData->remainingFirings);
     free(runData->repetitionVector);
     free(runData->actorRuns);
     free(runData);
 }
+
+void reset_graph_run_with_tokens(CsdfGraphRun *runData, const void *const *initialTokens)
+{
+    const CsdfGraph *graph = runData->graph;
+    for (size_t bufferId = 0; bufferId < graph->numConnections; bufferId++)
+    {
+        CsdfBuffer *buffer = runData->buffers[bufferId];
+        if (buffer == NULL)
+        {
+            continue;
+        }
+        const void *bufferTokens = initialTokens != NULL && initialTokens[bufferId] != NULL
+                                       ? initialTokens[bufferId]
+                                       : graph->connections[bufferId].initialTokens;
+        buffer->reset(buffer, bufferTokens);
+    }
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        if (actorRun == NULL)
+        {
+            continue;
+        }
+        actorRun->fireCount = 0;
+        if (actorRun->recordData != NULL)
+        {
+            reset_record_produced(actorRun->recordData);
+        }
+    }
+    if (runData->trace != NULL)
+    {
+        reset_trace(runData->trace);
+    }
+    if (runData->latency != NULL)
+    {
+        reset_latency_tracking(runData->latency);
+    }
+}
+
+void reset_graph_run(CsdfGraphRun *runData)
+{
+    reset_graph_run_with_tokens(runData, NULL);
+}
+
+void attach_input_port(CsdfGraphRun *runData, CsdfInputId inputPort, CsdfBuffer *buffer)
+{
+    runData->actorRuns[inputPort.actorId]->inputBuffers[inputPort.inputId] = buffer;
+}
+
+void attach_output_port(CsdfGraphRun *runData, CsdfOutputId outputPort, CsdfBuffer *buffer)
+{
+    CsdfActorRun *actorRun = runData->actorRuns[outputPort.actorId];
+    size_t outputId = outputPort.outputId;
+    size_t numOutputBuffers = actorRun->numOutputBuffers[outputId] + 1;
+    actorRun->outputBuffers[outputId] = realloc(actorRun->outputBuffers[outputId], numOutputBuffers * sizeof(CsdfBuffer *));
+    actorRun->outputBuffers[outputId][numOutputBuffers - 1] = buffer;
+    actorRun->numOutputBuffers[outputId] = numOutputBuffers;
+}
+
+static bool is_free_input(const CsdfGraph *graph, const CsdfInputId *inputPorts, size_t portId)
+{
+    CsdfInputId port = inputPorts[portId];
+    if (port.actorId >= graph->numActors || port.inputId >= graph->actors[port.actorId].numInputs)
+    {
+        return false;
+    }
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        CsdfInputId destination = graph->connections[connectionId].destination;
+        if (destination.actorId == port.actorId && destination.inputId == port.inputId)
+        {
+            return false;
+        }
+    }
+    for (size_t previousId = 0; previousId < portId; previousId++)
+    {
+        if (inputPorts[previousId].actorId == port.actorId && inputPorts[previousId].inputId == port.inputId)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool is_free_output(const CsdfGraph *graph, const CsdfOutputId *outputPorts, size_t portId)
+{
+    CsdfOutputId port = outputPorts[portId];
+    if (port.actorId >= graph->numActors || port.outputId >= graph->actors[port.actorId].numOutputs)
+    {
+        return false;
+    }
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        CsdfOutputId source = graph->connections[connectionId].source;
+        if (source.actorId == port.actorId && source.outputId == port.outputId)
+        {
+            return false;
+        }
+    }
+    for (size_t previousId = 0; previousId < portId; previousId++)
+    {
+        if (outputPorts[previousId].actorId == port.actorId && outputPorts[previousId].outputId == port.outputId)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t count_unconnected_inputs(const CsdfGraph *graph)
+{
+    size_t numUnconnected = 0;
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        numUnconnected += graph->actors[actorId].numInputs;
+    }
+    return numUnconnected - graph->numConnections;
+}
+
+bool are_graph_ports(
+    const CsdfGraph *graph,
+    size_t numInputPorts, const CsdfInputId *inputPorts,
+    size_t numOutputPorts, const CsdfOutputId *outputPorts)
+{
+    // The ports are distinct unconnected inputs, so this covers them all.
+    if (numInputPorts != count_unconnected_inputs(graph))
+    {
+        return false;
+    }
+    for (size_t portId = 0; portId < numInputPorts; portId++)
+    {
+        if (!is_free_input(graph, inputPorts, portId))
+        {
+            return false;
+        }
+    }
+    for (size_t portId = 0; portId < numOutputPorts; portId++)
+    {
+        if (!is_free_output(graph, outputPorts, portId))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool graph_run_is_local(const CsdfGraphRun *runData)
+{
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        if (runData->actorRuns[actorId] == NULL)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool graph_run_inputs_attached(const CsdfGraphRun *runData)
+{
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        const CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        for (size_t inputId = 0; actorRun != NULL && inputId < actorRun->actor->numInputs; inputId++)
+        {
+            if (actorRun->inputBuffers[inputId] == NULL)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void replace_graph_run_buffer(CsdfGraphRun *runData, size_t connectionId, CsdfBuffer *buffer)
+{
+    const CsdfConnection *connection = runData->graph->connections + connectionId;
+    CsdfBuffer *previous = runData->buffers[connectionId];
+    uint8_t *token = malloc(connection->tokenSize);
+    while (buffer->numberOfTokens(buffer) > 0)
+    {
+        buffer->pop(buffer, token);
+    }
+    while (previous->numberOfTokens(previous) > 0)
+    {
+        previous->pop(previous, token);
+        buffer->push(buffer, token);
+    }
+    free(token);
+
+    runData->actorRuns[connection->destination.actorId]->inputBuffers[connection->destination.inputId] = buffer;
+    CsdfActorRun *sourceRun = runData->actorRuns[connection->source.actorId];
+    size_t outputId = connection->source.outputId;
+    for (size_t bufferId = 0; bufferId < sourceRun->numOutputBuffers[outputId]; bufferId++)
+    {
+        if (sourceRun->outputBuffers[outputId][bufferId] == previous)
+        {
+            sourceRun->outputBuffers[outputId][bufferId] = buffer;
+        }
+    }
+    runData->buffers[connectionId] = buffer;
+    previous->destroy(previous);
+}
+
+void enable_graph_run_trace(CsdfGraphRun *runData, size_t numThreads, size_t eventsPerThread)
+{
+    if (runData->trace != NULL)
+    {
+        delete_trace(runData->trace);
+    }
+    runData->trace = new_trace(numThreads, eventsPerThread);
+}
+
+void set_actor_run_thread(CsdfGraphRun *runData, size_t actorId, size_t threadId)
+{
+    runData->actorRuns[actorId]->traceBuffer = trace_thread_buffer(runData->trace, threadId);
+}
+
+void enable_graph_run_latency(CsdfGraphRun *runData)
+{
+    if (runData->latency != NULL)
+    {
+        return;
+    }
+    runData->latency = new_latency_tracking(runData->graph, runData->buffers, runData->actorRuns);
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        if (runData->actorRuns[actorId] != NULL)
+        {
+            runData->actorRuns[actorId]->latency = runData->latency->actors + actorId;
+        }
+    }
+}
+
+bool graph_run_latency(const CsdfGraphRun *runData, size_t actorId, CsdfLatencySummary *summary)
+{
+    if (runData->latency == NULL || actorId >= runData->latency->numActors ||
+        runData->latency->actors[actorId].histogram == NULL)
+    {
+        return false;
+    }
+    const CsdfLatencyHistogram *histogram = runData->latency->actors[actorId].histogram;
+    summary->numSamples = histogram->numSamples;
+    summary->p50Nanoseconds = latency_percentile(histogram, 50);
+    summary->p99Nanoseconds = latency_percentile(histogram, 99);
+    summary->maxNanoseconds = histogram->maxNanoseconds;
+    return true;
+}
@@ -11,20 +11,163 @@ Copyright (c) 2023 Slaven Glumac
 
 #include "buffer.h"
 #include "actorrun.h"
+#include "latency.h"
+#include "trace.h"
 
 #include <csdf/graph.h>
+#include <csdf/lifetime.h>
+#include <csdf/record.h>
+#include <csdf/schedule.h>
+
+#define CSDF_UNBOUNDED_ITERATIONS UINT_MAX
+#define CSDF_AUTO_BLOCKING_FACTOR UINT_MAX
+
+// When recordDirectory is set, every recorded actor streams its outputs into
+// "<recordDirectory>/actor<actorId>.csdfrec", see csdf/record/mmapfile.h.
+// The run fails to build when a file cannot be created.
+// Outputs with tokens of at least largeTokenThreshold bytes pass them by
+// handle through a token pool sized from their buffers; zero disables it.
+// Actors with a tokenExecution write and read such tokens in their pool
+// slots, so they are never copied and fan-out only adds references. Other
+// actors copy them in and out of the pool.
+// With shareBufferMemory, buffers are sized for the sequential schedule and
+// packed by lifetime into shared regions, replacing token pools. Such runs
+// only execute sequentially. Graphs without a sequential schedule keep
+// private buffers.
+//
+// With actorParts, the run builds only the actors whose part is localPart
+// and leaves NULL in actorRuns for the others. Connections between two
+// local actors get private buffers and connections between a local and a
+// remote actor get a buffer from crossPartBuffer. Other connections get no
+// buffer. Such partial runs skip token pools and shared buffer memory, only
+// execute with parallel_run and fail to build when crossPartBuffer returns
+// NULL.
+//
+// Buffers hold the initial tokens plus bufferedIterations iterations worth
+// of tokens, 150 when it is zero, and at least a block.
+//
+// A blockingFactor J above 1 makes sequential runs execute J iterations as
+// one block along a schedule where each actor fires back to back, see
+// new_blocked_schedule, and sizes buffers to hold a block. With
+// CSDF_AUTO_BLOCKING_FACTOR, J is the largest block whose tokens fit in
+// cacheBytes, or in the data cache when cacheBytes is zero. Runs sharing
+// buffer memory keep single iterations.
+typedef CsdfBuffer *(*CsdfBufferFactory)(void *context, size_t connectionId, unsigned maxTokens);
+
+typedef struct CsdfGraphRunOptions
+{
+    size_t numRecordSelections;
+    const CsdfRecordSelection *recordSelections;
+    const char *recordDirectory;
+    size_t largeTokenThreshold;
+    bool shareBufferMemory;
+    char _pad[3];
+    unsigned blockingFactor;
+    size_t cacheBytes;
+    const size_t *actorParts;
+    size_t localPart;
+    CsdfBufferFactory crossPartBuffer;
+    void *crossPartContext;
+    unsigned bufferedIterations;
+    char _pad2[4];
+} CsdfGraphRunOptions;
+
+// Runs with CSDF_UNBOUNDED_ITERATIONS never exhaust their actors and only
+// support last-N recording, so they fail to build without options or with
+// full or every-N record selections.
 
 typedef struct CsdfGraphRun
 {
     const CsdfGraph *graph;
     unsigned int *repetitionVector;
     CsdfBuffer **buffers;
+    size_t numTokenPools;
+    CsdfTokenPool **tokenPools;
+    CsdfBufferPacking *bufferPacking;
+    uint8_t *sharedBufferMemory;
     CsdfActorRun **actorRuns;
     unsigned int numIterations;
+    unsigned int blockingFactor;
+    unsigned int bufferedIterations;
+    char _pad[4];
+    CsdfSchedule *blockSchedule;
+    unsigned int *remainingFirings;
+    CsdfTrace *trace;
+    CsdfLatencyTracking *latency;
 } CsdfGraphRun;
 
+// The number of token slots new_graph_run gives a connection's ring, one
+// more than the tokens it can hold.
+unsigned graph_buffer_capacity(const CsdfGraph *graph, const unsigned *repetitionVector, const CsdfConnection *connection);
+
 CsdfGraphRun *new_graph_run(const CsdfGraph *graph, unsigned numIterations);
 
+CsdfGraphRun *new_graph_run_with_options(const CsdfGraph *graph, unsigned numIterations, const CsdfGraphRunOptions *options);
+
 void delete_graph_run(CsdfGraphRun *runData);
 
+// The bytes new_graph_run_with_options would allocate for the same
+// arguments, planned without building the run. Buffers hold their ring and
+// bookkeeping, scratch is the consumed and produced tokens of each actor
+// and records are numbered by actor output, the outputs of actor 0 first.
+// Records in recordDirectory are counted although they are file mappings,
+// while buffers from crossPartBuffer, traces and latency stamps are not counted.
+typedef struct CsdfGraphRunFootprint
+{
+    size_t numConnections;
+    size_t *bufferBytes;
+    size_t numActors;
+    size_t *scratchBytes;
+    size_t numOutputs;
+    size_t *recordBytes;
+    size_t tokenPoolBytes;
+    size_t sharedBufferBytes;
+    size_t bookkeepingBytes;
+    size_t totalBytes;
+} CsdfGraphRunFootprint;
+
+// Returns NULL when the graph has no repetition vector or the run would be
+// rejected for its records.
+CsdfGraphRunFootprint *new_graph_run_footprint(const CsdfGraph *graph, unsigned numIterations, const CsdfGraphRunOptions *options);
+
+void delete_graph_run_footprint(CsdfGraphRunFootprint *footprint);
+
+void reset_graph_run(CsdfGraphRun *runData);
+
+void reset_graph_run_with_tokens(CsdfGraphRun *runData, const void *const *initialTokens);
+
+void attach_input_port(CsdfGraphRun *runData, CsdfInputId inputPort, CsdfBuffer *buffer);
+
+void attach_output_port(CsdfGraphRun *runData, CsdfOutputId outputPort, CsdfBuffer *buffer);
+
+// Whether the input ports are distinct and cover every unconnected input of
+// graph, and the output ports are distinct unconnected outputs.
+bool are_graph_ports(
+    const CsdfGraph *graph,
+    size_t numInputPorts, const CsdfInputId *inputPorts,
+    size_t numOutputPorts, const CsdfOutputId *outputPorts);
+
+// Whether the run holds every actor, unlike the part of a partitioned run.
+bool graph_run_is_local(const CsdfGraphRun *runData);
+
+// Whether every input of the run's actors has a buffer. Unconnected inputs
+// only get one from attach_input_port, and runs fail while they lack it.
+bool graph_run_inputs_attached(const CsdfGraphRun *runData);
+
+// Moves the queued tokens of a connection into buffer, rewires its actors
+// and destroys the previous buffer. No actor of the run may be firing.
+void replace_graph_run_buffer(CsdfGraphRun *runData, size_t connectionId, CsdfBuffer *buffer);
+
+void enable_graph_run_trace(CsdfGraphRun *runData, size_t numThreads, size_t eventsPerThread);
+
+void set_actor_run_thread(CsdfGraphRun *runData, size_t actorId, size_t threadId);
+
+// Tags every token with the time its oldest ancestor was produced, see
+// latency.h. Enable it before the run starts; reset_graph_run clears the
+// histograms.
+void enable_graph_run_latency(CsdfGraphRun *runData);
+
+// Returns false unless latency is enabled and actorId is a sink of the run.
+bool graph_run_latency(const CsdfGraphRun *runData, size_t actorId, CsdfLatencySummary *summary);
+
 #endif // CSDF_EXECUTION_GRAPHRUN_H
\ No newline at end of file
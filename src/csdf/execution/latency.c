@@ -0,0 +1,270 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "latency.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Whether the connection closes a cycle, that is whether its source can be
+// reached from its destination.
+static bool is_on_cycle(const CsdfGraph *graph, const CsdfConnection *connection)
+{
+    bool *visited = calloc(graph->numActors, sizeof(bool));
+    size_t *pending = malloc(graph->numActors * sizeof(size_t));
+    size_t numPending = 1;
+    pending[0] = connection->destination.actorId;
+    visited[connection->destination.actorId] = true;
+    while (numPending > 0 && !visited[connection->source.actorId])
+    {
+        size_t actorId = pending[--numPending];
+        for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+        {
+            size_t destination = graph->connections[connectionId].destination.actorId;
+            if (graph->connections[connectionId].source.actorId == actorId && !visited[destination])
+            {
+                visited[destination] = true;
+                pending[numPending++] = destination;
+            }
+        }
+    }
+    bool onCycle = visited[connection->source.actorId];
+    free(pending);
+    free(visited);
+    return onCycle;
+}
+
+static bool is_tracked(const CsdfGraph *graph, const CsdfConnection *connection, CsdfActorRun *const *actorRuns, CsdfBuffer *buffer)
+{
+    return buffer != NULL &&
+           connection->source.actorId != connection->destination.actorId &&
+           actorRuns[connection->source.actorId] != NULL &&
+           actorRuns[connection->destination.actorId] != NULL &&
+           (connection->numTokens == 0 || !is_on_cycle(graph, connection));
+}
+
+static void reset_ring(CsdfStampRing *ring)
+{
+    for (unsigned stampId = 0; stampId < ring->numInitial; stampId++)
+    {
+        ring->stamps[stampId] = CSDF_NO_ORIGIN;
+    }
+    ring->writeIndex = ring->numInitial;
+    ring->readIndex = 0;
+}
+
+static void create_rings(CsdfLatencyTracking *tracking, const CsdfGraph *graph, CsdfBuffer *const *buffers, CsdfActorRun *const *actorRuns)
+{
+    tracking->numConnections = graph->numConnections;
+    tracking->rings = malloc(graph->numConnections * sizeof(CsdfStampRing));
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        CsdfStampRing *ring = tracking->rings + connectionId;
+        CsdfBuffer *buffer = buffers[connectionId];
+        if (!is_tracked(graph, graph->connections + connectionId, actorRuns, buffer))
+        {
+            ring->stamps = NULL;
+            ring->capacity = 0;
+            ring->numInitial = 0;
+            continue;
+        }
+        ring->capacity = buffer->freeSpace(buffer) + buffer->numberOfTokens(buffer) + 1;
+        ring->stamps = malloc(ring->capacity * sizeof(uint64_t));
+        ring->numInitial = graph->connections[connectionId].numTokens;
+        reset_ring(ring);
+    }
+}
+
+static void link_actors(CsdfLatencyTracking *tracking, const CsdfGraph *graph)
+{
+    CsdfActorLatency *actors = tracking->actors;
+    bool *isSink = malloc(graph->numActors * sizeof(bool));
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        actors[actorId].inputRings = calloc(graph->actors[actorId].numInputs, sizeof(CsdfStampRing *));
+        actors[actorId].numOutputRings = 0;
+        actors[actorId].outputRings = NULL;
+        actors[actorId].outputProductions = NULL;
+        isSink[actorId] = true;
+    }
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        CsdfStampRing *ring = tracking->rings + connectionId;
+        if (connection->source.actorId != connection->destination.actorId)
+        {
+            isSink[connection->source.actorId] = false;
+        }
+        if (ring->stamps == NULL)
+        {
+            continue;
+        }
+        actors[connection->destination.actorId].inputRings[connection->destination.inputId] = ring;
+        CsdfActorLatency *source = actors + connection->source.actorId;
+        size_t numOutputRings = source->numOutputRings + 1;
+        source->outputRings = realloc(source->outputRings, numOutputRings * sizeof(CsdfStampRing *));
+        source->outputProductions = realloc(source->outputProductions, numOutputRings * sizeof(unsigned));
+        source->outputRings[numOutputRings - 1] = ring;
+        source->outputProductions[numOutputRings - 1] = graph->actors[connection->source.actorId].outputs[connection->source.outputId].production;
+        source->numOutputRings = numOutputRings;
+    }
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        actors[actorId].histogram = isSink[actorId] ? tracking->histograms + actorId : NULL;
+    }
+    free(isSink);
+}
+
+CsdfLatencyTracking *new_latency_tracking(const CsdfGraph *graph, CsdfBuffer *const *buffers, CsdfActorRun *const *actorRuns)
+{
+    CsdfLatencyTracking *tracking = malloc(sizeof(CsdfLatencyTracking));
+    create_rings(tracking, graph, buffers, actorRuns);
+    tracking->numActors = graph->numActors;
+    tracking->actors = malloc(graph->numActors * sizeof(CsdfActorLatency));
+    tracking->histograms = calloc(graph->numActors, sizeof(CsdfLatencyHistogram));
+    link_actors(tracking, graph);
+    return tracking;
+}
+
+void delete_latency_tracking(CsdfLatencyTracking *tracking)
+{
+    for (size_t actorId = 0; actorId < tracking->numActors; actorId++)
+    {
+        CsdfActorLatency *latency = tracking->actors + actorId;
+        free(latency->inputRings);
+        free(latency->outputRings);
+        free(latency->outputProductions);
+    }
+    for (size_t connectionId = 0; connectionId < tracking->numConnections; connectionId++)
+    {
+        free(tracking->rings[connectionId].stamps);
+    }
+    free(tracking->histograms);
+    free(tracking->actors);
+    free(tracking->rings);
+    free(tracking);
+}
+
+void reset_latency_tracking(CsdfLatencyTracking *tracking)
+{
+    for (size_t connectionId = 0; connectionId < tracking->numConnections; connectionId++)
+    {
+        CsdfStampRing *ring = tracking->rings + connectionId;
+        if (ring->stamps != NULL)
+        {
+            reset_ring(ring);
+        }
+    }
+    memset(tracking->histograms, 0, tracking->numActors * sizeof(CsdfLatencyHistogram));
+}
+
+uint64_t take_origin(CsdfActorLatency *latency, const CsdfActor *actor)
+{
+    uint64_t origin = CSDF_NO_ORIGIN;
+    for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
+    {
+        CsdfStampRing *ring = latency->inputRings[inputId];
+        if (ring == NULL)
+        {
+            continue;
+        }
+        for (unsigned tokenId = 0; tokenId < actor->inputs[inputId].consumption; tokenId++)
+        {
+            uint64_t stamp = ring->stamps[ring->readIndex];
+            origin = stamp < origin ? stamp : origin;
+            ring->readIndex = ring->readIndex + 1 < ring->capacity ? ring->readIndex + 1 : 0;
+        }
+    }
+    return origin;
+}
+
+void stamp_outputs(CsdfActorLatency *latency, uint64_t origin)
+{
+    uint64_t now = trace_timestamp();
+    if (latency->histogram != NULL && origin != CSDF_NO_ORIGIN)
+    {
+        record_latency(latency->histogram, now > origin ? now - origin : 0);
+    }
+    uint64_t stamp = origin != CSDF_NO_ORIGIN ? origin : now;
+    for (size_t ringId = 0; ringId < latency->numOutputRings; ringId++)
+    {
+        CsdfStampRing *ring = latency->outputRings[ringId];
+        for (unsigned tokenId = 0; tokenId < latency->outputProductions[ringId]; tokenId++)
+        {
+            ring->stamps[ring->writeIndex] = stamp;
+            ring->writeIndex = ring->writeIndex + 1 < ring->capacity ? ring->writeIndex + 1 : 0;
+        }
+    }
+}
+
+static unsigned highest_bit(uint64_t value)
+{
+    unsigned bit = 0;
+    for (unsigned shift = 32; shift > 0; shift /= 2)
+    {
+        if (value >> (bit + shift) != 0)
+        {
+            bit += shift;
+        }
+    }
+    return bit;
+}
+
+static size_t bucket_of(uint64_t nanoseconds)
+{
+    if (nanoseconds < CSDF_LATENCY_SUB_BUCKETS)
+    {
+        return (size_t)nanoseconds;
+    }
+    unsigned exponent = highest_bit(nanoseconds);
+    size_t subBucket = (size_t)(nanoseconds >> (exponent - 3)) - CSDF_LATENCY_SUB_BUCKETS;
+    return (exponent - 2) * CSDF_LATENCY_SUB_BUCKETS + subBucket;
+}
+
+static uint64_t bucket_upper_bound(size_t bucketId)
+{
+    if (bucketId < CSDF_LATENCY_SUB_BUCKETS)
+    {
+        return bucketId;
+    }
+    unsigned exponent = (unsigned)(bucketId / CSDF_LATENCY_SUB_BUCKETS) + 2;
+    uint64_t subBucket = bucketId % CSDF_LATENCY_SUB_BUCKETS + CSDF_LATENCY_SUB_BUCKETS;
+    return ((subBucket + 1) << (exponent - 3)) - 1;
+}
+
+void record_latency(CsdfLatencyHistogram *histogram, uint64_t nanoseconds)
+{
+    histogram->counts[bucket_of(nanoseconds)]++;
+    histogram->numSamples++;
+    if (nanoseconds > histogram->maxNanoseconds)
+    {
+        histogram->maxNanoseconds = nanoseconds;
+    }
+}
+
+uint64_t latency_percentile(const CsdfLatencyHistogram *histogram, unsigned percent)
+{
+    if (histogram->numSamples == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = (histogram->numSamples * percent + 99) / 100;
+    rank = rank > 0 ? rank : 1;
+    uint64_t numBelow = 0;
+    for (size_t bucketId = 0; bucketId < CSDF_LATENCY_NUM_BUCKETS; bucketId++)
+    {
+        numBelow += histogram->counts[bucketId];
+        if (numBelow >= rank)
+        {
+            uint64_t upperBound = bucket_upper_bound(bucketId);
+            return upperBound < histogram->maxNanoseconds ? upperBound : histogram->maxNanoseconds;
+        }
+    }
+    return histogram->maxNanoseconds;
+}
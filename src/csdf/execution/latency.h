@@ -0,0 +1,100 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_LATENCY_H
+#define CSDF_EXECUTION_LATENCY_H
+
+#include "actorrun.h"
+#include "buffer.h"
+
+#include <csdf/graph.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CSDF_NO_ORIGIN UINT64_MAX
+#define CSDF_LATENCY_SUB_BUCKETS 8
+#define CSDF_LATENCY_NUM_BUCKETS (64 * CSDF_LATENCY_SUB_BUCKETS)
+
+// The origin timestamps of the tokens queued on one connection, in the
+// order of its buffer. The producer writes a stamp before it pushes the
+// token and the consumer reads it before it pops, so the buffer orders
+// both sides. Initial tokens have no origin.
+typedef struct CsdfStampRing
+{
+    uint64_t *stamps;
+    unsigned capacity;
+    unsigned writeIndex;
+    unsigned readIndex;
+    unsigned numInitial;
+} CsdfStampRing;
+
+// Latencies fall into CSDF_LATENCY_SUB_BUCKETS linear buckets per power of
+// two, so percentiles are within an eighth of the true value.
+typedef struct CsdfLatencyHistogram
+{
+    uint64_t numSamples;
+    uint64_t maxNanoseconds;
+    uint64_t counts[CSDF_LATENCY_NUM_BUCKETS];
+} CsdfLatencyHistogram;
+
+struct CsdfActorLatency
+{
+    CsdfStampRing **inputRings;
+    size_t numOutputRings;
+    CsdfStampRing **outputRings;
+    unsigned *outputProductions;
+    CsdfLatencyHistogram *histogram;
+};
+
+// Only connections between two actors of the run carry stamps, except for
+// self-loops and the connections with initial tokens that close a cycle.
+// Otherwise every token that went around a feedback loop would inherit the
+// origin of the first sample. Actors without stamped inputs stamp their
+// outputs with the time they fire, and actors without outgoing connections
+// other than self-loops record the latency from the oldest origin they
+// consumed.
+typedef struct CsdfLatencyTracking
+{
+    size_t numConnections;
+    CsdfStampRing *rings;
+    size_t numActors;
+    CsdfActorLatency *actors;
+    CsdfLatencyHistogram *histograms;
+} CsdfLatencyTracking;
+
+typedef struct CsdfLatencySummary
+{
+    uint64_t numSamples;
+    uint64_t p50Nanoseconds;
+    uint64_t p99Nanoseconds;
+    uint64_t maxNanoseconds;
+} CsdfLatencySummary;
+
+CsdfLatencyTracking *new_latency_tracking(const CsdfGraph *graph, CsdfBuffer *const *buffers, CsdfActorRun *const *actorRuns);
+
+void delete_latency_tracking(CsdfLatencyTracking *tracking);
+
+// Back to the initial tokens of the graph with empty histograms.
+void reset_latency_tracking(CsdfLatencyTracking *tracking);
+
+// Pops the stamps of the tokens one firing consumes and returns the oldest,
+// CSDF_NO_ORIGIN when none has an origin.
+uint64_t take_origin(CsdfActorLatency *latency, const CsdfActor *actor);
+
+// Pushes the stamps of the tokens one firing produces and records the
+// latency of sinks.
+void stamp_outputs(CsdfActorLatency *latency, uint64_t origin);
+
+void record_latency(CsdfLatencyHistogram *histogram, uint64_t nanoseconds);
+
+// The upper bound of the bucket holding the given percentile, at most the
+// largest sample.
+uint64_t latency_percentile(const CsdfLatencyHistogram *histogram, unsigned percent);
+
+#endif // CSDF_EXECUTION_LATENCY_H
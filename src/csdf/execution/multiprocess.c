@@ -0,0 +1,235 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "multiprocess.h"
+#include "parallel.h"
+#include "buffer/shm.h"
+
+#include <csdf/repetition.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SHM_NAME_SIZE 64
+
+typedef struct CsdfProcessRings
+{
+    const CsdfGraph *graph;
+    pid_t launcher;
+    char _pad[4];
+} CsdfProcessRings;
+
+static void ring_name(pid_t launcher, size_t connectionId, char *name)
+{
+    snprintf(name, SHM_NAME_SIZE, "/csdf-%ld-%zu", (long)launcher, connectionId);
+}
+
+static CsdfBuffer *attach_ring(void *context, size_t connectionId, unsigned maxTokens)
+{
+    (void)maxTokens;
+    const CsdfProcessRings *rings = context;
+    char name[SHM_NAME_SIZE];
+    ring_name(rings->launcher, connectionId, name);
+    return open_shm_buffer(rings->graph->connections + connectionId, name);
+}
+
+static bool is_cross(const CsdfConnection *connection, const size_t *actorParts)
+{
+    return actorParts[connection->source.actorId] != actorParts[connection->destination.actorId];
+}
+
+static CsdfBuffer **create_rings(const CsdfGraph *graph, const size_t *actorParts, pid_t launcher)
+{
+    unsigned *repetitionVector = malloc(graph->numActors * sizeof(unsigned));
+    if (!csdf_repetition_vector(graph, repetitionVector))
+    {
+        free(repetitionVector);
+        return NULL;
+    }
+    CsdfBuffer **rings = calloc(graph->numConnections, sizeof(CsdfBuffer *));
+    bool created = true;
+    for (size_t connectionId = 0; connectionId < graph->numConnections && created; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        if (is_cross(connection, actorParts))
+        {
+            char name[SHM_NAME_SIZE];
+            ring_name(launcher, connectionId, name);
+            unsigned maxTokens = graph_buffer_capacity(graph, repetitionVector, connection);
+            rings[connectionId] = new_shm_buffer(connection, maxTokens, name);
+            created = rings[connectionId] != NULL;
+        }
+    }
+    free(repetitionVector);
+    if (!created)
+    {
+        for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+        {
+            if (rings[connectionId] != NULL)
+            {
+                delete_shm_buffer(rings[connectionId]);
+            }
+        }
+        free(rings);
+        return NULL;
+    }
+    return rings;
+}
+
+static void run_part(
+    const CsdfThreading *threading, const CsdfGraph *graph, unsigned numIterations,
+    size_t part, const size_t *actorParts, const CsdfGraphRunOptions *options, pid_t launcher)
+{
+    CsdfProcessRings rings = {.graph = graph, .launcher = launcher};
+    CsdfGraphRunOptions partOptions = {0};
+    if (options != NULL)
+    {
+        partOptions = *options;
+    }
+    partOptions.actorParts = actorParts;
+    partOptions.localPart = part;
+    partOptions.crossPartBuffer = attach_ring;
+    partOptions.crossPartContext = &rings;
+
+    CsdfGraphRun *runData = new_graph_run_with_options(graph, numIterations, &partOptions);
+    bool completed = runData != NULL && parallel_run(threading, runData);
+    if (runData != NULL)
+    {
+        delete_graph_run(runData);
+    }
+    _exit(completed ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+// Polls instead of blocking in waitpid, so a failed process is noticed
+// while the others still wait for its tokens.
+static bool wait_parts(const CsdfThreading *threading, pid_t *pids, size_t numParts)
+{
+    bool completed = true;
+    size_t numRunning = 0;
+    for (size_t part = 0; part < numParts; part++)
+    {
+        numRunning += pids[part] > 0;
+    }
+    while (numRunning > 0)
+    {
+        for (size_t part = 0; part < numParts; part++)
+        {
+            int status;
+            if (pids[part] <= 0 || waitpid(pids[part], &status, WNOHANG) != pids[part])
+            {
+                continue;
+            }
+            pids[part] = 0;
+            numRunning--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            {
+                completed = false;
+                for (size_t other = 0; other < numParts; other++)
+                {
+                    if (pids[other] > 0)
+                    {
+                        kill(pids[other], SIGKILL);
+                    }
+                }
+            }
+        }
+        if (numRunning > 0)
+        {
+            threading->sleep(threading->microsecondsSleep);
+        }
+    }
+    return completed;
+}
+
+static bool are_valid_parts(const CsdfGraph *graph, size_t numParts, const size_t *actorParts)
+{
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        if (actorParts[actorId] >= numParts)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool multiprocess_run(
+    const CsdfThreading *threading, const CsdfGraph *graph, unsigned numIterations,
+    size_t numParts, const size_t *actorParts, const CsdfGraphRunOptions *options)
+{
+    // An actor in no forked part would leave its neighbours waiting forever.
+    if (!are_valid_parts(graph, numParts, actorParts))
+    {
+        return false;
+    }
+    pid_t launcher = getpid();
+    CsdfBuffer **rings = create_rings(graph, actorParts, launcher);
+    if (rings == NULL)
+    {
+        return false;
+    }
+
+    fflush(NULL);
+    pid_t *pids = calloc(numParts, sizeof(pid_t));
+    bool forked = true;
+    for (size_t part = 0; part < numParts && forked; part++)
+    {
+        pids[part] = fork();
+        if (pids[part] == 0)
+        {
+            run_part(threading, graph, numIterations, part, actorParts, options, launcher);
+        }
+        forked = pids[part] > 0;
+    }
+    if (!forked)
+    {
+        for (size_t part = 0; part < numParts; part++)
+        {
+            if (pids[part] > 0)
+            {
+                kill(pids[part], SIGKILL);
+            }
+        }
+    }
+    bool completed = wait_parts(threading, pids, numParts) && forked;
+    free(pids);
+
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        if (rings[connectionId] != NULL)
+        {
+            delete_shm_buffer(rings[connectionId]);
+        }
+    }
+    free(rings);
+    return completed;
+}
+
+#else
+
+bool multiprocess_run(
+    const CsdfThreading *threading, const CsdfGraph *graph, unsigned numIterations,
+    size_t numParts, const size_t *actorParts, const CsdfGraphRunOptions *options)
+{
+    (void)threading;
+    (void)graph;
+    (void)numIterations;
+    (void)numParts;
+    (void)actorParts;
+    (void)options;
+    return false;
+}
+
+#endif
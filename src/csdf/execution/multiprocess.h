@@ -0,0 +1,31 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_MULTIPROCESS_H
+#define CSDF_EXECUTION_MULTIPROCESS_H
+
+#include "graphrun.h"
+
+#include <threading4csdf.h>
+
+// Runs numIterations iterations of graph in numParts processes forked from
+// the caller, where actorParts[actorId] is the process of each actor.
+// Connections between processes go through shared memory rings created
+// before the fork, see csdf/execution/buffer/shm.h. Each process builds its
+// part of the run from options (if any) and runs it with parallel_run, so
+// records only reach the caller through options->recordDirectory.
+//
+// Returns false when an actor has a part of numParts or more, when a ring
+// cannot be created or some process fails. Once
+// one process dies, the others are killed instead of waiting for its
+// tokens.
+bool multiprocess_run(
+    const CsdfThreading *threading, const CsdfGraph *graph, unsigned numIterations,
+    size_t numParts, const size_t *actorParts, const CsdfGraphRunOptions *options);
+
+#endif // CSDF_EXECUTION_MULTIPROCESS_H
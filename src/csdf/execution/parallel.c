@@ -10,28 +10,214 @@ Copyright (c) 2023 Slaven Glumac
 
 #include <stdlib.h>
 
+static void rehome_inputs(CsdfActorRun *actorRun)
+{
+    for (size_t inputId = 0; inputId < actorRun->actor->numInputs; inputId++)
+    {
+        CsdfBuffer *buffer = actorRun->inputBuffers[inputId];
+        buffer->rehome(buffer);
+    }
+}
+
+static void wait_start(const CsdfThreading *threading, CsdfParallelStart *start)
+{
+    atomic_fetch_add(&start->numReady, 1);
+    while (atomic_load(&start->numReady) < start->numThreads)
+    {
+        threading->sleep(threading->microsecondsSleep);
+    }
+}
+
+typedef struct CsdfAbortableWait
+{
+    CsdfWaitCondition condition;
+    void *conditionData;
+    atomic_bool *aborted;
+} CsdfAbortableWait;
+
+static bool condition_or_aborted(void *waitData)
+{
+    CsdfAbortableWait *abortableWait = waitData;
+    return atomic_load_explicit(abortableWait->aborted, memory_order_relaxed) ||
+           abortableWait->condition(abortableWait->conditionData);
+}
+
+// Returns false when the run was aborted while waiting.
+static bool wait_unless_aborted(CsdfWaiter *waiter, atomic_bool *aborted, CsdfWaitCondition condition, void *conditionData)
+{
+    CsdfAbortableWait abortableWait = {.condition = condition, .conditionData = conditionData, .aborted = aborted};
+    wait_until(waiter, condition_or_aborted, &abortableWait);
+    return !atomic_load_explicit(aborted, memory_order_relaxed);
+}
+
+// Threads that started wait for neighbours that may never start, so a run
+// failing to start all its threads lets them return before joining them.
+static void abort_run(atomic_bool *aborted, CsdfParallelStart *start, CsdfProgress *progress)
+{
+    atomic_store(aborted, true);
+    if (start != NULL)
+    {
+        atomic_fetch_add(&start->numReady, start->numThreads);
+    }
+    signal_progress(progress);
+}
+
+// The wait conditions also hold once the actor can never fire, so that
+// the waiting thread can abort the run.
+static bool actor_can_fire(void *actorRun)
+{
+    return can_fire(actorRun) || can_never_fire(actorRun);
+}
+
+static bool actor_has_input_tokens(void *actorRun)
+{
+    return has_input_tokens(actorRun) || can_never_fire(actorRun);
+}
+
+static bool actor_has_output_space(void *actorRun)
+{
+    return has_output_space(actorRun) || can_never_fire(actorRun);
+}
+
+// Aborts the run when the wait ended because the actor can never fire.
+static bool check_can_fire(CsdfActorRun *actorRun, atomic_bool *aborted, CsdfProgress *progress)
+{
+    if (can_never_fire(actorRun))
+    {
+        abort_run(aborted, NULL, progress);
+        return false;
+    }
+    return true;
+}
+
 static bool run_actor(void *taskData)
 {
     CsdfParallelActorRun *parallel = taskData;
     CsdfActorRun *actorRun = parallel->actorRun;
     const CsdfThreading *threading = parallel->threading;
 
+    if (parallel->start != NULL)
+    {
+        if (!pin_current_thread(parallel->cpus))
+        {
+            abort_run(parallel->aborted, parallel->start, parallel->progress);
+            return false;
+        }
+        rehome_inputs(actorRun);
+        wait_start(threading, parallel->start);
+    }
+
+    CsdfWaiter waiter;
+    init_waiter(&waiter, parallel->wait, threading, parallel->progress);
     while (actorRun->fireCount < actorRun->maxFireCount)
     {
-        while (!can_fire(actorRun))
+        if (!wait_unless_aborted(&waiter, parallel->aborted, actor_can_fire, actorRun) ||
+            !check_can_fire(actorRun, parallel->aborted, parallel->progress))
         {
-            threading->sleep(threading->microsecondsSleep);
+            return false;
         }
         fire(actorRun);
+        signal_progress(parallel->progress);
     }
     return true;
 }
 
-CsdfParallelActorRun *create_parallel_actor_run(const CsdfThreading *threading, CsdfActorRun *actorRun)
+typedef struct CsdfTurn
+{
+    atomic_uint *turn;
+    unsigned ticket;
+    char _pad[4];
+} CsdfTurn;
+
+static bool is_turn(void *turnData)
+{
+    CsdfTurn *turn = turnData;
+    return atomic_load_explicit(turn->turn, memory_order_acquire) == turn->ticket;
+}
+
+static bool wait_turn(CsdfWaiter *waiter, atomic_bool *aborted, atomic_uint *turn, unsigned ticket)
+{
+    CsdfTurn turnData = {.turn = turn, .ticket = ticket};
+    return wait_unless_aborted(waiter, aborted, is_turn, &turnData);
+}
+
+static bool run_replica(void *taskData)
+{
+    CsdfReplicatedActorRun *replicated = taskData;
+    CsdfActorRun *actorRun = replicated->actorRun;
+    const CsdfThreading *threading = replicated->threading;
+    if (replicated->start != NULL)
+    {
+        if (!pin_current_thread(replicated->cpus))
+        {
+            abort_run(replicated->aborted, replicated->start, replicated->progress);
+            return false;
+        }
+        if (!atomic_exchange(&replicated->rehomed, true))
+        {
+            rehome_inputs(actorRun);
+        }
+        wait_start(threading, replicated->start);
+    }
+    size_t replicaId = atomic_fetch_add(&replicated->nextReplica, 1);
+    CsdfTraceBuffer *traceBuffer = trace_thread_buffer(replicated->trace, replicated->firstThreadId + replicaId);
+    uint8_t *consumed = malloc(actorRun->consumedSize);
+    uint8_t *produced = malloc(actorRun->producedSize);
+    CsdfProgress *progress = replicated->progress;
+    CsdfWaiter waiter;
+    init_waiter(&waiter, replicated->wait, threading, progress);
+
+    atomic_bool *aborted = replicated->aborted;
+    bool completed = true;
+    unsigned ticket = atomic_fetch_add(&replicated->nextTicket, 1);
+    while (ticket < actorRun->maxFireCount && completed)
+    {
+        completed = wait_turn(&waiter, aborted, &replicated->consumeTurn, ticket) &&
+                    wait_unless_aborted(&waiter, aborted, actor_has_input_tokens, actorRun) &&
+                    check_can_fire(actorRun, aborted, progress);
+        if (!completed)
+        {
+            break;
+        }
+        uint64_t beginNanoseconds = traceBuffer != NULL ? trace_timestamp() : 0;
+        uint64_t origin = fire_consume(actorRun, consumed);
+        atomic_store_explicit(&replicated->consumeTurn, ticket + 1, memory_order_release);
+        signal_progress(progress);
+
+        csdf_actor_execute_in(actorRun->actor, actorRun->context, consumed, produced);
+
+        completed = wait_turn(&waiter, aborted, &replicated->produceTurn, ticket) &&
+                    wait_unless_aborted(&waiter, aborted, actor_has_output_space, actorRun) &&
+                    check_can_fire(actorRun, aborted, progress);
+        if (!completed)
+        {
+            break;
+        }
+        fire_produce(actorRun, produced, origin);
+        atomic_store_explicit(&replicated->produceTurn, ticket + 1, memory_order_release);
+        signal_progress(progress);
+        if (traceBuffer != NULL)
+        {
+            trace_firing(traceBuffer, actorRun->actor, ticket, beginNanoseconds);
+        }
+
+        ticket = atomic_fetch_add(&replicated->nextTicket, 1);
+    }
+    free(produced);
+    free(consumed);
+    return completed;
+}
+
+CsdfParallelActorRun *create_parallel_actor_run(const CsdfThreading *threading, CsdfActorRun *actorRun, CsdfParallelStart *start, const CsdfCpuSet *cpus, const CsdfWaitStrategy *wait, CsdfProgress *progress, atomic_bool *aborted)
 {
     CsdfParallelActorRun *parallelActorRun = malloc(sizeof(CsdfParallelActorRun));
     parallelActorRun->threading = threading;
     parallelActorRun->actorRun = actorRun;
+    parallelActorRun->start = start;
+    parallelActorRun->cpus = cpus;
+    parallelActorRun->wait = wait;
+    parallelActorRun->progress = progress;
+    parallelActorRun->aborted = aborted;
 
     parallelActorRun->threadData = malloc(threading->threadDataSize);
 
@@ -56,30 +242,150 @@ void delete_parallel_actor_run(CsdfParallelActorRun *parallelActorRun)
     free(parallelActorRun);
 }
 
-bool parallel_run(const CsdfThreading *threading, CsdfGraphRun *runData)
+CsdfReplicatedActorRun *create_replicated_actor_run(const CsdfThreading *threading, CsdfActorRun *actorRun, size_t numReplicas, CsdfTrace *trace, size_t firstThreadId, CsdfParallelStart *start, const CsdfCpuSet *cpus, const CsdfWaitStrategy *wait, CsdfProgress *progress, atomic_bool *aborted)
+{
+    CsdfReplicatedActorRun *replicatedActorRun = malloc(sizeof(CsdfReplicatedActorRun));
+    replicatedActorRun->threading = threading;
+    replicatedActorRun->actorRun = actorRun;
+    atomic_init(&replicatedActorRun->nextTicket, actorRun->fireCount);
+    atomic_init(&replicatedActorRun->consumeTurn, actorRun->fireCount);
+    atomic_init(&replicatedActorRun->produceTurn, actorRun->fireCount);
+    atomic_init(&replicatedActorRun->rehomed, false);
+    atomic_init(&replicatedActorRun->nextReplica, 0);
+    replicatedActorRun->trace = trace;
+    replicatedActorRun->firstThreadId = firstThreadId;
+    replicatedActorRun->start = start;
+    replicatedActorRun->cpus = cpus;
+    replicatedActorRun->wait = wait;
+    replicatedActorRun->progress = progress;
+    replicatedActorRun->aborted = aborted;
+    replicatedActorRun->numReplicas = 0;
+    replicatedActorRun->threadData = malloc(numReplicas * sizeof(void *));
+
+    for (size_t replicaId = 0; replicaId < numReplicas; replicaId++)
+    {
+        void *threadData = malloc(threading->threadDataSize);
+        if (!threading->createThread(threadData, run_replica, replicatedActorRun))
+        {
+            free(threadData);
+            abort_run(aborted, start, progress);
+            join_replicated_actor_run(replicatedActorRun);
+            delete_replicated_actor_run(replicatedActorRun);
+            return NULL;
+        }
+        replicatedActorRun->threadData[replicatedActorRun->numReplicas++] = threadData;
+    }
+    return replicatedActorRun;
+}
+
+bool join_replicated_actor_run(CsdfReplicatedActorRun *replicatedActorRun)
+{
+    const CsdfThreading *threading = replicatedActorRun->threading;
+    bool joined = true;
+    for (size_t replicaId = 0; replicaId < replicatedActorRun->numReplicas; replicaId++)
+    {
+        joined = threading->joinThread(replicatedActorRun->threadData[replicaId]) && joined;
+    }
+    return joined;
+}
+
+void delete_replicated_actor_run(CsdfReplicatedActorRun *replicatedActorRun)
+{
+    for (size_t replicaId = 0; replicaId < replicatedActorRun->numReplicas; replicaId++)
+    {
+        free(replicatedActorRun->threadData[replicaId]);
+    }
+    free(replicatedActorRun->threadData);
+    free(replicatedActorRun);
+}
+
+static bool is_replicated(const CsdfActor *actor, const CsdfParallelOptions *options)
+{
+    return actor->stateless && options != NULL && options->statelessReplicas > 1;
+}
+
+static size_t count_threads(const CsdfGraphRun *runData, const CsdfParallelOptions *options)
+{
+    size_t numThreads = 0;
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        const CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        if (actorRun != NULL)
+        {
+            numThreads += is_replicated(actorRun->actor, options) ? options->statelessReplicas : 1;
+        }
+    }
+    return numThreads;
+}
+
+bool parallel_run_with_options(const CsdfThreading *threading, CsdfGraphRun *runData, const CsdfParallelOptions *options)
 {
     const CsdfGraph *graph = runData->graph;
+    if (runData->sharedBufferMemory != NULL || !graph_run_inputs_attached(runData))
+    {
+        return false;
+    }
 
-    CsdfParallelActorRun **parallelActorRuns = malloc(graph->numActors * sizeof(CsdfParallelActorRun *));
+    const CsdfPlacement *placement = options != NULL ? options->placement : NULL;
+    CsdfParallelStart start = {.numThreads = count_threads(runData, options)};
+    atomic_init(&start.numReady, 0);
+    CsdfParallelStart *placedStart = placement != NULL ? &start : NULL;
+    const CsdfWaitStrategy *wait = options != NULL ? options->wait : NULL;
+    CsdfProgress progress;
+    init_progress(&progress);
+    atomic_bool aborted;
+    atomic_init(&aborted, false);
 
-    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    void **actorThreads = calloc(graph->numActors, sizeof(void *));
+    size_t threadId = 0;
+    bool completed = true;
+
+    for (size_t actorId = 0; actorId < graph->numActors && completed; actorId++)
     {
-        CsdfParallelActorRun *parallelActorRun = create_parallel_actor_run(threading, runData->actorRuns[actorId]);
-        if (parallelActorRun == NULL)
+        CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        if (actorRun == NULL)
         {
-            return false;
+            continue;
+        }
+        const CsdfCpuSet *cpus = placement != NULL ? placement->actorCpus + actorId : NULL;
+        if (is_replicated(actorRun->actor, options))
+        {
+            actorThreads[actorId] = create_replicated_actor_run(threading, actorRun, options->statelessReplicas, runData->trace, threadId, placedStart, cpus, wait, &progress, &aborted);
+            threadId += options->statelessReplicas;
         }
-        parallelActorRuns[actorId] = parallelActorRun;
+        else
+        {
+            set_actor_run_thread(runData, actorId, threadId++);
+            actorThreads[actorId] = create_parallel_actor_run(threading, actorRun, placedStart, cpus, wait, &progress, &aborted);
+        }
+        completed = actorThreads[actorId] != NULL;
     };
+    if (!completed)
+    {
+        abort_run(&aborted, &start, &progress);
+    }
     for (size_t actorId = 0; actorId < graph->numActors; actorId++)
     {
-        CsdfParallelActorRun *parallelActorRun = parallelActorRuns[actorId];
-        if (!join_parallel_actor_run(parallelActorRun))
+        if (actorThreads[actorId] == NULL)
         {
-            return false;
+            continue;
+        }
+        if (is_replicated(runData->actorRuns[actorId]->actor, options))
+        {
+            completed = join_replicated_actor_run(actorThreads[actorId]) && completed;
+            delete_replicated_actor_run(actorThreads[actorId]);
+        }
+        else
+        {
+            completed = join_parallel_actor_run(actorThreads[actorId]) && completed;
+            delete_parallel_actor_run(actorThreads[actorId]);
         }
-        delete_parallel_actor_run(parallelActorRun);
     }
-    free(parallelActorRuns);
-    return true;
+    free(actorThreads);
+    return completed;
+}
+
+bool parallel_run(const CsdfThreading *threading, CsdfGraphRun *runData)
+{
+    return parallel_run_with_options(threading, runData, NULL);
 }
@@ -10,22 +10,91 @@ Copyright (c) 2023 Slaven Glumac
 #define CSDF_EXECUTION_PARALLEL_H
 
 #include "graphrun.h"
+#include "placement.h"
+#include "wait.h"
 
 #include <threading4csdf.h>
 
+#include <stdatomic.h>
+
+// Start line shared by the threads of one placed run. Each thread pins
+// itself, moves the rings it consumes from onto its node and waits until
+// all numThreads threads are ready before firing.
+typedef struct CsdfParallelStart
+{
+    size_t numThreads;
+    atomic_size_t numReady;
+} CsdfParallelStart;
+
 typedef struct CsdfParallelActorRun
 {
     const CsdfThreading *threading;
     CsdfActorRun *actorRun;
+    CsdfParallelStart *start;
+    const CsdfCpuSet *cpus;
+    const CsdfWaitStrategy *wait;
+    CsdfProgress *progress;
+    atomic_bool *aborted;
     void *threadData;
 } CsdfParallelActorRun;
 
+// Firings of a stateless actor are spread over several replica threads.
+// Each firing takes a ticket, consumes and produces in ticket order and
+// executes concurrently with the other replicas. Replica i traces into the
+// buffer of thread firstThreadId + i.
+typedef struct CsdfReplicatedActorRun
+{
+    const CsdfThreading *threading;
+    CsdfActorRun *actorRun;
+    atomic_uint nextTicket;
+    atomic_uint consumeTurn;
+    atomic_uint produceTurn;
+    atomic_bool rehomed;
+    atomic_size_t nextReplica;
+    CsdfTrace *trace;
+    size_t firstThreadId;
+    CsdfParallelStart *start;
+    const CsdfCpuSet *cpus;
+    const CsdfWaitStrategy *wait;
+    CsdfProgress *progress;
+    atomic_bool *aborted;
+    size_t numReplicas;
+    void **threadData;
+} CsdfReplicatedActorRun;
+
+// statelessReplicas is the number of threads running each actor marked as
+// stateless. Threads are numbered in actor order, a replicated actor taking
+// one number per replica, and trace into the buffer of their number. Values below 2 give such actors a single thread. With a
+// placement, the threads of each actor run on its CPU set and first touch
+// the actor's input buffers, see CsdfParallelStart, and the run fails when
+// a thread cannot be pinned. Threads blocked on
+// tokens or space wait as set by wait, which defaults to sleeping.
+typedef struct CsdfParallelOptions
+{
+    size_t statelessReplicas;
+    const CsdfPlacement *placement;
+    const CsdfWaitStrategy *wait;
+} CsdfParallelOptions;
+
+// Runs whose buffers share memory are rejected, see CsdfGraphRunOptions.
+// A run fails once an actor can never fire again, see can_never_fire.
 bool parallel_run(const CsdfThreading *threading, CsdfGraphRun *runData);
 
-CsdfParallelActorRun *create_parallel_actor_run(const CsdfThreading *threading, CsdfActorRun *actorRun);
+bool parallel_run_with_options(const CsdfThreading *threading, CsdfGraphRun *runData, const CsdfParallelOptions *options);
+
+// Threads stop waiting and fail once *aborted is set, which the run sets
+// when one of its threads fails to start or to be pinned, or finds its
+// actor unable to ever fire again.
+CsdfParallelActorRun *create_parallel_actor_run(const CsdfThreading *threading, CsdfActorRun *actorRun, CsdfParallelStart *start, const CsdfCpuSet *cpus, const CsdfWaitStrategy *wait, CsdfProgress *progress, atomic_bool *aborted);
 
 bool join_parallel_actor_run(CsdfParallelActorRun *parallelActorRun);
 
 void delete_parallel_actor_run(CsdfParallelActorRun *parallelActorRun);
 
+CsdfReplicatedActorRun *create_replicated_actor_run(const CsdfThreading *threading, CsdfActorRun *actorRun, size_t numReplicas, CsdfTrace *trace, size_t firstThreadId, CsdfParallelStart *start, const CsdfCpuSet *cpus, const CsdfWaitStrategy *wait, CsdfProgress *progress, atomic_bool *aborted);
+
+bool join_replicated_actor_run(CsdfReplicatedActorRun *replicatedActorRun);
+
+void delete_replicated_actor_run(CsdfReplicatedActorRun *replicatedActorRun);
+
 #endif // CSDF_EXECUTION_PARALLEL_H
@@ -0,0 +1,277 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "placement.h"
+
+#include <csdf/partition.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define MAX_NUMA_NODES 64
+#define CPU_LIST_SIZE 4096
+
+void clear_cpu_set(CsdfCpuSet *cpus)
+{
+    memset(cpus, 0, sizeof(CsdfCpuSet));
+}
+
+void add_cpu(CsdfCpuSet *cpus, size_t cpu)
+{
+    if (cpu < CSDF_MAX_CPUS)
+    {
+        cpus->words[cpu / 64] |= UINT64_C(1) << (cpu % 64);
+    }
+}
+
+bool has_cpu(const CsdfCpuSet *cpus, size_t cpu)
+{
+    return cpu < CSDF_MAX_CPUS && (cpus->words[cpu / 64] >> (cpu % 64) & 1) != 0;
+}
+
+size_t count_cpus(const CsdfCpuSet *cpus)
+{
+    size_t numCpus = 0;
+    for (size_t cpu = 0; cpu < CSDF_MAX_CPUS; cpu++)
+    {
+        numCpus += has_cpu(cpus, cpu);
+    }
+    return numCpus;
+}
+
+bool parse_cpu_list(const char *cpuList, CsdfCpuSet *cpus)
+{
+    clear_cpu_set(cpus);
+    const char *it = cpuList;
+    while (*it != '\0' && *it != '\n')
+    {
+        char *end;
+        unsigned long first = strtoul(it, &end, 10);
+        if (end == it)
+        {
+            return false;
+        }
+        unsigned long last = first;
+        it = end;
+        if (*it == '-')
+        {
+            last = strtoul(it + 1, &end, 10);
+            if (end == it + 1 || last < first)
+            {
+                return false;
+            }
+            it = end;
+        }
+        for (unsigned long cpu = first; cpu <= last && cpu < CSDF_MAX_CPUS; cpu++)
+        {
+            add_cpu(cpus, cpu);
+        }
+        if (*it == ',')
+        {
+            it++;
+        }
+    }
+    return true;
+}
+
+static bool read_cpu_list(const char *path, CsdfCpuSet *cpus)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    char cpuList[CPU_LIST_SIZE];
+    bool parsed = fgets(cpuList, sizeof(cpuList), file) != NULL && parse_cpu_list(cpuList, cpus);
+    fclose(file);
+    return parsed;
+}
+
+static void online_cpus(CsdfCpuSet *cpus)
+{
+    if (read_cpu_list("/sys/devices/system/cpu/online", cpus))
+    {
+        return;
+    }
+    clear_cpu_set(cpus);
+    long numCpus = 1;
+#ifndef _WIN32
+    numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    for (long cpu = 0; cpu < numCpus; cpu++)
+    {
+        add_cpu(cpus, (size_t)cpu);
+    }
+}
+
+CsdfNumaTopology *read_numa_topology(void)
+{
+    CsdfNumaTopology *topology = malloc(sizeof(CsdfNumaTopology));
+    topology->numNodes = 0;
+    topology->nodeCpus = malloc(MAX_NUMA_NODES * sizeof(CsdfCpuSet));
+    for (size_t nodeId = 0; nodeId < MAX_NUMA_NODES; nodeId++)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%zu/cpulist", nodeId);
+        CsdfCpuSet *nodeCpus = topology->nodeCpus + topology->numNodes;
+        if (read_cpu_list(path, nodeCpus) && count_cpus(nodeCpus) > 0)
+        {
+            topology->numNodes++;
+        }
+    }
+    if (topology->numNodes == 0)
+    {
+        online_cpus(topology->nodeCpus);
+        topology->numNodes = 1;
+    }
+    return topology;
+}
+
+void delete_numa_topology(CsdfNumaTopology *topology)
+{
+    free(topology->nodeCpus);
+    free(topology);
+}
+
+CsdfPlacement *new_placement(size_t numActors)
+{
+    CsdfPlacement *placement = malloc(sizeof(CsdfPlacement));
+    placement->numActors = numActors;
+    placement->actorCpus = calloc(numActors, sizeof(CsdfCpuSet));
+    placement->actorNodes = malloc(numActors * sizeof(size_t));
+    for (size_t actorId = 0; actorId < numActors; actorId++)
+    {
+        placement->actorNodes[actorId] = CSDF_NO_NUMA_NODE;
+    }
+    return placement;
+}
+
+static uint64_t *new_traffic_matrix(const CsdfGraph *graph, const unsigned *repetitionVector)
+{
+    size_t numActors = graph->numActors;
+    uint64_t *traffic = calloc(numActors * numActors, sizeof(uint64_t));
+    uint64_t *connectionTraffic = malloc(graph->numConnections * sizeof(uint64_t));
+    connection_traffic(graph, repetitionVector, connectionTraffic);
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        size_t source = connection->source.actorId;
+        size_t destination = connection->destination.actorId;
+        traffic[source * numActors + destination] += connectionTraffic[connectionId];
+        traffic[destination * numActors + source] += connectionTraffic[connectionId];
+    }
+    free(connectionTraffic);
+    return traffic;
+}
+
+static size_t next_group_actor(const CsdfPlacement *placement, const uint64_t *traffic, size_t nodeId)
+{
+    size_t numActors = placement->numActors;
+    size_t bestActorId = CSDF_NO_NUMA_NODE;
+    uint64_t bestGroupTraffic = 0;
+    uint64_t bestTotalTraffic = 0;
+    for (size_t actorId = 0; actorId < numActors; actorId++)
+    {
+        if (placement->actorNodes[actorId] != CSDF_NO_NUMA_NODE)
+        {
+            continue;
+        }
+        uint64_t groupTraffic = 0;
+        uint64_t totalTraffic = 0;
+        for (size_t otherId = 0; otherId < numActors; otherId++)
+        {
+            uint64_t bytes = traffic[actorId * numActors + otherId];
+            totalTraffic += bytes;
+            groupTraffic += placement->actorNodes[otherId] == nodeId ? bytes : 0;
+        }
+        if (bestActorId == CSDF_NO_NUMA_NODE || groupTraffic > bestGroupTraffic ||
+            (groupTraffic == bestGroupTraffic && totalTraffic > bestTotalTraffic))
+        {
+            bestActorId = actorId;
+            bestGroupTraffic = groupTraffic;
+            bestTotalTraffic = totalTraffic;
+        }
+    }
+    return bestActorId;
+}
+
+CsdfPlacement *new_topology_placement(const CsdfGraph *graph, const unsigned *repetitionVector, const CsdfNumaTopology *topology)
+{
+    CsdfPlacement *placement = new_placement(graph->numActors);
+    uint64_t *traffic = new_traffic_matrix(graph, repetitionVector);
+    size_t remainingActors = graph->numActors;
+    size_t remainingCpus = 0;
+    for (size_t nodeId = 0; nodeId < topology->numNodes; nodeId++)
+    {
+        remainingCpus += count_cpus(topology->nodeCpus + nodeId);
+    }
+    for (size_t nodeId = 0; nodeId < topology->numNodes && remainingActors > 0; nodeId++)
+    {
+        size_t nodeCpus = count_cpus(topology->nodeCpus + nodeId);
+        if (nodeCpus == 0)
+        {
+            continue;
+        }
+        // The last node with CPUs takes every remaining actor.
+        size_t groupSize = nodeCpus == remainingCpus
+                               ? remainingActors
+                               : (remainingActors * nodeCpus + remainingCpus - 1) / remainingCpus;
+        for (size_t member = 0; member < groupSize; member++)
+        {
+            size_t actorId = next_group_actor(placement, traffic, nodeId);
+            placement->actorNodes[actorId] = nodeId;
+            placement->actorCpus[actorId] = topology->nodeCpus[nodeId];
+        }
+        remainingActors -= groupSize;
+        remainingCpus -= nodeCpus;
+    }
+    free(traffic);
+    return placement;
+}
+
+void delete_placement(CsdfPlacement *placement)
+{
+    free(placement->actorNodes);
+    free(placement->actorCpus);
+    free(placement);
+}
+
+bool pin_current_thread(const CsdfCpuSet *cpus)
+{
+    if (count_cpus(cpus) == 0)
+    {
+        return true;
+    }
+#if defined(__linux__)
+    cpu_set_t affinity;
+    CPU_ZERO(&affinity);
+    for (size_t cpu = 0; cpu < CSDF_MAX_CPUS && cpu < CPU_SETSIZE; cpu++)
+    {
+        if (has_cpu(cpus, cpu))
+        {
+            CPU_SET(cpu, &affinity);
+        }
+    }
+    return sched_setaffinity(0, sizeof(affinity), &affinity) == 0;
+#else
+    return true;
+#endif
+}
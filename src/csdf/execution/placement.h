@@ -0,0 +1,72 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_PLACEMENT_H
+#define CSDF_EXECUTION_PLACEMENT_H
+
+#include <csdf/graph.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CSDF_MAX_CPUS 1024
+#define CSDF_NO_NUMA_NODE SIZE_MAX
+
+typedef struct CsdfCpuSet
+{
+    uint64_t words[CSDF_MAX_CPUS / 64];
+} CsdfCpuSet;
+
+// CPUs of each NUMA node. Systems without node information are reported as
+// a single node holding every online CPU.
+typedef struct CsdfNumaTopology
+{
+    size_t numNodes;
+    CsdfCpuSet *nodeCpus;
+} CsdfNumaTopology;
+
+// CPU set and NUMA node per actor. Actors with an empty CPU set run
+// wherever the OS puts them.
+typedef struct CsdfPlacement
+{
+    size_t numActors;
+    CsdfCpuSet *actorCpus;
+    size_t *actorNodes;
+} CsdfPlacement;
+
+void clear_cpu_set(CsdfCpuSet *cpus);
+
+void add_cpu(CsdfCpuSet *cpus, size_t cpu);
+
+bool has_cpu(const CsdfCpuSet *cpus, size_t cpu);
+
+size_t count_cpus(const CsdfCpuSet *cpus);
+
+// Parses the kernel cpulist format, e.g. "0-3,8,10-11".
+bool parse_cpu_list(const char *cpuList, CsdfCpuSet *cpus);
+
+CsdfNumaTopology *read_numa_topology(void);
+
+void delete_numa_topology(CsdfNumaTopology *topology);
+
+CsdfPlacement *new_placement(size_t numActors);
+
+// Grows one group of actors per node, each time adding the actor that
+// exchanges the most bytes per iteration with the group, and sizes groups
+// by the number of CPUs on their node. Nodes without CPUs get no actors, and
+// without any CPUs every actor stays unplaced.
+CsdfPlacement *new_topology_placement(const CsdfGraph *graph, const unsigned *repetitionVector, const CsdfNumaTopology *topology);
+
+void delete_placement(CsdfPlacement *placement);
+
+// Restricts the calling thread to cpus and returns false when the OS
+// refuses. Empty sets and platforms without affinity support leave the
+// thread as it is.
+bool pin_current_thread(const CsdfCpuSet *cpus);
+
+#endif // CSDF_EXECUTION_PLACEMENT_H
@@ -0,0 +1,105 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+static bool make_directory(const char *path)
+{
+#ifndef _WIN32
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+static CsdfGraphRun *new_pooled_run(const CsdfGraph *graph, unsigned numIterations, const CsdfGraphRunOptions *options, size_t runId)
+{
+    if (options == NULL || options->recordDirectory == NULL)
+    {
+        return new_graph_run_with_options(graph, numIterations, options);
+    }
+    size_t directorySize = strlen(options->recordDirectory) + 32;
+    char *runDirectory = malloc(directorySize);
+    snprintf(runDirectory, directorySize, "%s/run%zu", options->recordDirectory, runId);
+    CsdfGraphRun *runData = NULL;
+    if (make_directory(runDirectory))
+    {
+        CsdfGraphRunOptions runOptions = *options;
+        runOptions.recordDirectory = runDirectory;
+        runData = new_graph_run_with_options(graph, numIterations, &runOptions);
+    }
+    free(runDirectory);
+    return runData;
+}
+
+CsdfGraphRunPool *new_graph_run_pool(const CsdfGraph *graph, unsigned numIterations, const CsdfGraphRunOptions *options, size_t numRuns)
+{
+    CsdfGraphRunPool *pool = malloc(sizeof(CsdfGraphRunPool));
+    pool->numRuns = numRuns;
+    pool->runs = malloc(numRuns * sizeof(CsdfGraphRun *));
+    pool->checkedOut = malloc(numRuns * sizeof(atomic_bool));
+    for (size_t runId = 0; runId < numRuns; runId++)
+    {
+        pool->runs[runId] = new_pooled_run(graph, numIterations, options, runId);
+        if (pool->runs[runId] == NULL)
+        {
+            pool->numRuns = runId;
+            delete_graph_run_pool(pool);
+            return NULL;
+        }
+        atomic_init(&pool->checkedOut[runId], false);
+    }
+    return pool;
+}
+
+void delete_graph_run_pool(CsdfGraphRunPool *pool)
+{
+    for (size_t runId = 0; runId < pool->numRuns; runId++)
+    {
+        delete_graph_run(pool->runs[runId]);
+    }
+    free(pool->checkedOut);
+    free(pool->runs);
+    free(pool);
+}
+
+CsdfGraphRun *checkout_graph_run(CsdfGraphRunPool *pool)
+{
+    for (size_t runId = 0; runId < pool->numRuns; runId++)
+    {
+        if (!atomic_load_explicit(&pool->checkedOut[runId], memory_order_relaxed) &&
+            !atomic_exchange_explicit(&pool->checkedOut[runId], true, memory_order_acquire))
+        {
+            return pool->runs[runId];
+        }
+    }
+    return NULL;
+}
+
+void return_graph_run(CsdfGraphRunPool *pool, CsdfGraphRun *runData)
+{
+    for (size_t runId = 0; runId < pool->numRuns; runId++)
+    {
+        if (pool->runs[runId] == runData)
+        {
+            reset_graph_run(runData);
+            atomic_store_explicit(&pool->checkedOut[runId], false, memory_order_release);
+            return;
+        }
+    }
+}
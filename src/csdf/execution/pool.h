@@ -0,0 +1,36 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_POOL_H
+#define CSDF_EXECUTION_POOL_H
+
+#include "graphrun.h"
+
+#include <stdatomic.h>
+
+// Prebuilt runs of one graph. Runs are reset when they are returned, so a
+// checkout neither allocates nor analyses the graph. With recordDirectory,
+// run i records into its own "<recordDirectory>/run<i>" directory, which
+// is created when missing.
+typedef struct CsdfGraphRunPool
+{
+    size_t numRuns;
+    CsdfGraphRun **runs;
+    atomic_bool *checkedOut;
+} CsdfGraphRunPool;
+
+// Returns NULL when a run fails to build.
+CsdfGraphRunPool *new_graph_run_pool(const CsdfGraph *graph, unsigned numIterations, const CsdfGraphRunOptions *options, size_t numRuns);
+
+void delete_graph_run_pool(CsdfGraphRunPool *pool);
+
+CsdfGraphRun *checkout_graph_run(CsdfGraphRunPool *pool);
+
+void return_graph_run(CsdfGraphRunPool *pool, CsdfGraphRun *runData);
+
+#endif // CSDF_EXECUTION_POOL_H
@@ -0,0 +1,181 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "profile.h"
+
+#include <csdf/partition.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PROFILE_MAGIC "csdf-profile"
+#define PROFILE_VERSION 1
+#define FNV_OFFSET_BASIS UINT64_C(14695981039346656037)
+#define FNV_PRIME UINT64_C(1099511628211)
+
+static uint64_t hash_value(uint64_t hash, uint64_t value)
+{
+    for (size_t byteId = 0; byteId < sizeof(value); byteId++)
+    {
+        hash ^= (value >> (8 * byteId)) & 0xff;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t graph_fingerprint(const CsdfGraph *graph)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash = hash_value(hash, graph->numActors);
+    hash = hash_value(hash, graph->numConnections);
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        const CsdfActor *actor = graph->actors + actorId;
+        hash = hash_value(hash, actor->numInputs);
+        for (size_t inputId = 0; inputId < actor->numInputs; inputId++)
+        {
+            hash = hash_value(hash, actor->inputs[inputId].tokenSize);
+            hash = hash_value(hash, actor->inputs[inputId].consumption);
+        }
+        hash = hash_value(hash, actor->numOutputs);
+        for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+        {
+            hash = hash_value(hash, actor->outputs[outputId].tokenSize);
+            hash = hash_value(hash, actor->outputs[outputId].production);
+        }
+    }
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        hash = hash_value(hash, connection->source.actorId);
+        hash = hash_value(hash, connection->source.outputId);
+        hash = hash_value(hash, connection->destination.actorId);
+        hash = hash_value(hash, connection->destination.inputId);
+        hash = hash_value(hash, connection->tokenSize);
+        hash = hash_value(hash, connection->numTokens);
+    }
+    return hash;
+}
+
+CsdfRunProfile *new_run_profile(const CsdfGraph *graph, const unsigned *repetitionVector, size_t numThreads)
+{
+    CsdfRunProfile *profile = malloc(sizeof(CsdfRunProfile));
+    profile->fingerprint = graph_fingerprint(graph);
+    profile->numActors = graph->numActors;
+    profile->firingNanoseconds = calloc(graph->numActors, sizeof(uint64_t));
+    profile->numConnections = graph->numConnections;
+    profile->connectionBytes = malloc(graph->numConnections * sizeof(uint64_t));
+    connection_traffic(graph, repetitionVector, profile->connectionBytes);
+    profile->numThreads = numThreads;
+    profile->actorThreads = calloc(graph->numActors, sizeof(size_t));
+    return profile;
+}
+
+void delete_run_profile(CsdfRunProfile *profile)
+{
+    free(profile->actorThreads);
+    free(profile->connectionBytes);
+    free(profile->firingNanoseconds);
+    free(profile);
+}
+
+void repartition_run_profile(CsdfRunProfile *profile, const CsdfGraph *graph, const unsigned *repetitionVector)
+{
+    uint64_t *actorCosts = malloc(graph->numActors * sizeof(uint64_t));
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        actorCosts[actorId] = repetitionVector[actorId] * (profile->firingNanoseconds[actorId] + 1);
+    }
+    balanced_partition(graph, actorCosts, profile->connectionBytes, profile->numThreads, profile->actorThreads);
+    free(actorCosts);
+}
+
+bool save_run_profile(const CsdfRunProfile *profile, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "%s %d\n", PROFILE_MAGIC, PROFILE_VERSION);
+    fprintf(file, "fingerprint %016" PRIx64 "\n", profile->fingerprint);
+    fprintf(file, "threads %zu\n", profile->numThreads);
+    fprintf(file, "actors %zu\n", profile->numActors);
+    for (size_t actorId = 0; actorId < profile->numActors; actorId++)
+    {
+        fprintf(file, "actor %zu %zu %" PRIu64 "\n", actorId, profile->actorThreads[actorId], profile->firingNanoseconds[actorId]);
+    }
+    fprintf(file, "connections %zu\n", profile->numConnections);
+    for (size_t connectionId = 0; connectionId < profile->numConnections; connectionId++)
+    {
+        fprintf(file, "connection %zu %" PRIu64 "\n", connectionId, profile->connectionBytes[connectionId]);
+    }
+    return fclose(file) == 0;
+}
+
+static bool read_profile_body(FILE *file, CsdfRunProfile *profile)
+{
+    size_t numActors, numConnections;
+    if (fscanf(file, " actors %zu", &numActors) != 1 || numActors != profile->numActors)
+    {
+        return false;
+    }
+    for (size_t actorId = 0; actorId < numActors; actorId++)
+    {
+        size_t readActorId, threadId;
+        uint64_t nanoseconds;
+        if (fscanf(file, " actor %zu %zu %" SCNu64, &readActorId, &threadId, &nanoseconds) != 3 ||
+            readActorId != actorId || threadId >= profile->numThreads)
+        {
+            return false;
+        }
+        profile->actorThreads[actorId] = threadId;
+        profile->firingNanoseconds[actorId] = nanoseconds;
+    }
+    if (fscanf(file, " connections %zu", &numConnections) != 1 || numConnections != profile->numConnections)
+    {
+        return false;
+    }
+    for (size_t connectionId = 0; connectionId < numConnections; connectionId++)
+    {
+        size_t readConnectionId;
+        uint64_t bytes;
+        if (fscanf(file, " connection %zu %" SCNu64, &readConnectionId, &bytes) != 2 || readConnectionId != connectionId)
+        {
+            return false;
+        }
+        profile->connectionBytes[connectionId] = bytes;
+    }
+    return true;
+}
+
+CsdfRunProfile *load_run_profile(const CsdfGraph *graph, const unsigned *repetitionVector, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    int version;
+    uint64_t fingerprint;
+    size_t numThreads;
+    CsdfRunProfile *profile = NULL;
+    if (fscanf(file, PROFILE_MAGIC " %d fingerprint %" SCNx64 " threads %zu", &version, &fingerprint, &numThreads) == 3 &&
+        version == PROFILE_VERSION && fingerprint == graph_fingerprint(graph) && numThreads > 0)
+    {
+        profile = new_run_profile(graph, repetitionVector, numThreads);
+        if (!read_profile_body(file, profile))
+        {
+            delete_run_profile(profile);
+            profile = NULL;
+        }
+    }
+    fclose(file);
+    return profile;
+}
@@ -0,0 +1,47 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_PROFILE_H
+#define CSDF_EXECUTION_PROFILE_H
+
+#include <csdf/graph.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Measured nanoseconds per firing of each actor and bytes per iteration of
+// each connection, with the thread assignment derived from them. The
+// fingerprint ties a saved profile to the structure of its graph.
+typedef struct CsdfRunProfile
+{
+    uint64_t fingerprint;
+    size_t numActors;
+    uint64_t *firingNanoseconds;
+    size_t numConnections;
+    uint64_t *connectionBytes;
+    size_t numThreads;
+    size_t *actorThreads;
+} CsdfRunProfile;
+
+uint64_t graph_fingerprint(const CsdfGraph *graph);
+
+CsdfRunProfile *new_run_profile(const CsdfGraph *graph, const unsigned *repetitionVector, size_t numThreads);
+
+void delete_run_profile(CsdfRunProfile *profile);
+
+// Recomputes actorThreads by balanced_partition over the cost of one
+// iteration of each actor and the connection traffic.
+void repartition_run_profile(CsdfRunProfile *profile, const CsdfGraph *graph, const unsigned *repetitionVector);
+
+bool save_run_profile(const CsdfRunProfile *profile, const char *path);
+
+// Returns NULL when the file is missing, malformed or made for a graph
+// with another fingerprint.
+CsdfRunProfile *load_run_profile(const CsdfGraph *graph, const unsigned *repetitionVector, const char *path);
+
+#endif // CSDF_EXECUTION_PROFILE_H
@@ -0,0 +1,429 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "selftimed.h"
+#include "buffer/plain.h"
+#include "buffer/stdlockfree.h"
+#include "profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct CsdfSelfTimedActor
+{
+    size_t numCrossInputs;
+    CsdfBuffer **crossInputs;
+    unsigned *crossConsumptions;
+    size_t numCrossOutputs;
+    CsdfBuffer **crossOutputs;
+    unsigned *crossProductions;
+    uint64_t busyNanoseconds;
+};
+
+typedef struct CsdfSelfTimedThread
+{
+    CsdfSelfTimedRun *selfTimed;
+    const CsdfSchedule *schedule;
+    void *threadData;
+} CsdfSelfTimedThread;
+
+void partition_schedule_order(const CsdfSchedule *schedule, size_t numActors, size_t numThreads, size_t *actorThreads)
+{
+    size_t *firings = calloc(numActors, sizeof(size_t));
+    size_t *order = malloc(numActors * sizeof(size_t));
+    size_t numOrdered = 0;
+    for (size_t entryId = 0; entryId < schedule->numEntries; entryId++)
+    {
+        const CsdfScheduleEntry *entry = schedule->entries + entryId;
+        if (firings[entry->actorId] == 0)
+        {
+            order[numOrdered++] = entry->actorId;
+        }
+        firings[entry->actorId] += entry->count;
+    }
+    size_t totalFirings = schedule_num_firings(schedule);
+    size_t firingsBefore = 0;
+    for (size_t orderId = 0; orderId < numOrdered; orderId++)
+    {
+        size_t actorId = order[orderId];
+        size_t threadId = totalFirings > 0 ? firingsBefore * numThreads / totalFirings : 0;
+        actorThreads[actorId] = threadId < numThreads ? threadId : numThreads - 1;
+        firingsBefore += firings[actorId];
+    }
+    for (size_t actorId = 0; actorId < numActors; actorId++)
+    {
+        if (firings[actorId] == 0)
+        {
+            actorThreads[actorId] = 0;
+        }
+    }
+    free(order);
+    free(firings);
+}
+
+static unsigned buffer_capacity(CsdfBuffer *buffer)
+{
+    return buffer->freeSpace(buffer) + buffer->numberOfTokens(buffer) + 1;
+}
+
+static bool is_internal(const CsdfSelfTimedRun *selfTimed, const CsdfConnection *connection)
+{
+    return selfTimed->actorThreads[connection->source.actorId] == selfTimed->actorThreads[connection->destination.actorId];
+}
+
+static void swap_internal_buffers(CsdfSelfTimedRun *selfTimed, bool plain)
+{
+    CsdfGraphRun *runData = selfTimed->runData;
+    const CsdfGraph *graph = runData->graph;
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        CsdfBuffer *buffer = runData->buffers[connectionId];
+        if (!is_internal(selfTimed, connection) || buffer->pool != NULL)
+        {
+            continue;
+        }
+        unsigned maxTokens = buffer_capacity(buffer);
+        replace_graph_run_buffer(runData, connectionId, plain
+                                                            ? new_plain_buffer(connection, maxTokens)
+                                                            : new_stdlockfree_buffer(connection, maxTokens));
+    }
+}
+
+static void init_actor(CsdfSelfTimedRun *selfTimed, size_t actorId)
+{
+    const CsdfGraph *graph = selfTimed->runData->graph;
+    CsdfActorRun *actorRun = selfTimed->runData->actorRuns[actorId];
+    const CsdfActor *actor = actorRun->actor;
+    CsdfSelfTimedActor *selfTimedActor = selfTimed->actors + actorId;
+    selfTimedActor->busyNanoseconds = 0;
+    selfTimedActor->numCrossInputs = 0;
+    selfTimedActor->crossInputs = malloc(actor->numInputs * sizeof(CsdfBuffer *));
+    selfTimedActor->crossConsumptions = malloc(actor->numInputs * sizeof(unsigned));
+    selfTimedActor->numCrossOutputs = 0;
+    selfTimedActor->crossOutputs = malloc(graph->numConnections * sizeof(CsdfBuffer *));
+    selfTimedActor->crossProductions = malloc(graph->numConnections * sizeof(unsigned));
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        if (is_internal(selfTimed, connection))
+        {
+            continue;
+        }
+        if (connection->destination.actorId == actorId)
+        {
+            size_t crossId = selfTimedActor->numCrossInputs++;
+            selfTimedActor->crossInputs[crossId] = actorRun->inputBuffers[connection->destination.inputId];
+            selfTimedActor->crossConsumptions[crossId] = actor->inputs[connection->destination.inputId].consumption;
+        }
+        if (connection->source.actorId == actorId)
+        {
+            size_t crossId = selfTimedActor->numCrossOutputs++;
+            selfTimedActor->crossOutputs[crossId] = selfTimed->runData->buffers[connectionId];
+            selfTimedActor->crossProductions[crossId] = actor->outputs[connection->source.outputId].production;
+        }
+    }
+}
+
+static void free_actor(CsdfSelfTimedActor *selfTimedActor)
+{
+    free(selfTimedActor->crossInputs);
+    free(selfTimedActor->crossConsumptions);
+    free(selfTimedActor->crossOutputs);
+    free(selfTimedActor->crossProductions);
+}
+
+static bool cross_ready(const CsdfSelfTimedActor *selfTimedActor)
+{
+    for (size_t crossId = 0; crossId < selfTimedActor->numCrossInputs; crossId++)
+    {
+        CsdfBuffer *buffer = selfTimedActor->crossInputs[crossId];
+        if (!buffer->hasTokens(buffer, selfTimedActor->crossConsumptions[crossId]))
+        {
+            return false;
+        }
+    }
+    for (size_t crossId = 0; crossId < selfTimedActor->numCrossOutputs; crossId++)
+    {
+        CsdfBuffer *buffer = selfTimedActor->crossOutputs[crossId];
+        if (!buffer->hasSpace(buffer, selfTimedActor->crossProductions[crossId]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+typedef struct CsdfCrossWait
+{
+    CsdfSelfTimedRun *selfTimed;
+    const CsdfSelfTimedActor *selfTimedActor;
+} CsdfCrossWait;
+
+static bool cross_ready_or_aborted(void *crossWaitData)
+{
+    CsdfCrossWait *crossWait = crossWaitData;
+    return atomic_load_explicit(&crossWait->selfTimed->aborted, memory_order_relaxed) ||
+           cross_ready(crossWait->selfTimedActor);
+}
+
+static bool run_thread(void *taskData)
+{
+    CsdfSelfTimedThread *thread = taskData;
+    CsdfSelfTimedRun *selfTimed = thread->selfTimed;
+    const CsdfSchedule *schedule = thread->schedule;
+    bool profiling = selfTimed->busyNanoseconds != NULL;
+    CsdfWaiter waiter;
+    init_waiter(&waiter, selfTimed->wait, selfTimed->threading, &selfTimed->progress);
+    for (unsigned iteration = 0; iteration < selfTimed->numIterations; iteration++)
+    {
+        for (size_t entryId = 0; entryId < schedule->numEntries; entryId++)
+        {
+            const CsdfScheduleEntry *entry = schedule->entries + entryId;
+            CsdfSelfTimedActor *selfTimedActor = selfTimed->actors + entry->actorId;
+            CsdfActorRun *actorRun = selfTimed->runData->actorRuns[entry->actorId];
+            for (unsigned firing = 0; firing < entry->count; firing++)
+            {
+                CsdfCrossWait crossWait = {.selfTimed = selfTimed, .selfTimedActor = selfTimedActor};
+                wait_until(&waiter, cross_ready_or_aborted, &crossWait);
+                if (atomic_load_explicit(&selfTimed->aborted, memory_order_relaxed))
+                {
+                    return false;
+                }
+                uint64_t beginNanoseconds = profiling ? trace_timestamp() : 0;
+                fire(actorRun);
+                signal_progress(&selfTimed->progress);
+                if (profiling)
+                {
+                    selfTimedActor->busyNanoseconds += trace_timestamp() - beginNanoseconds;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static CsdfSchedule **new_thread_schedules(const CsdfSchedule *schedule, const size_t *actorThreads, size_t numThreads)
+{
+    CsdfSchedule **threadSchedules = malloc(numThreads * sizeof(CsdfSchedule *));
+    for (size_t threadId = 0; threadId < numThreads; threadId++)
+    {
+        threadSchedules[threadId] = malloc(sizeof(CsdfSchedule));
+        threadSchedules[threadId]->numEntries = 0;
+        threadSchedules[threadId]->entries = malloc(schedule->numEntries * sizeof(CsdfScheduleEntry));
+    }
+    for (size_t entryId = 0; entryId < schedule->numEntries; entryId++)
+    {
+        const CsdfScheduleEntry *entry = schedule->entries + entryId;
+        CsdfSchedule *threadSchedule = threadSchedules[actorThreads[entry->actorId]];
+        size_t numEntries = threadSchedule->numEntries;
+        if (numEntries > 0 && threadSchedule->entries[numEntries - 1].actorId == entry->actorId)
+        {
+            threadSchedule->entries[numEntries - 1].count += entry->count;
+        }
+        else
+        {
+            threadSchedule->entries[threadSchedule->numEntries++] = *entry;
+        }
+    }
+    return threadSchedules;
+}
+
+static bool run_threads(CsdfSelfTimedRun *selfTimed)
+{
+    const CsdfThreading *threading = selfTimed->threading;
+    CsdfSelfTimedThread *threads = malloc(selfTimed->numThreads * sizeof(CsdfSelfTimedThread));
+    size_t numStarted = 0;
+    bool completed = true;
+    for (size_t threadId = 0; threadId < selfTimed->numThreads && completed; threadId++)
+    {
+        CsdfSelfTimedThread *thread = threads + threadId;
+        thread->selfTimed = selfTimed;
+        thread->schedule = selfTimed->threadSchedules[threadId];
+        thread->threadData = malloc(threading->threadDataSize);
+        completed = threading->createThread(thread->threadData, run_thread, thread);
+        numStarted += completed;
+    }
+    if (!completed)
+    {
+        atomic_store(&selfTimed->aborted, true);
+        signal_progress(&selfTimed->progress);
+    }
+    for (size_t threadId = 0; threadId < numStarted; threadId++)
+    {
+        completed = threading->joinThread(threads[threadId].threadData) && completed;
+    }
+    for (size_t threadId = 0; threadId < selfTimed->numThreads && threadId <= numStarted; threadId++)
+    {
+        free(threads[threadId].threadData);
+    }
+    free(threads);
+    return completed;
+}
+
+static bool run_phase(CsdfSelfTimedRun *selfTimed, const CsdfSchedule *schedule, unsigned numIterations)
+{
+    CsdfGraphRun *runData = selfTimed->runData;
+    const CsdfGraph *graph = runData->graph;
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        set_actor_run_thread(runData, actorId, selfTimed->actorThreads[actorId]);
+    }
+    selfTimed->numIterations = numIterations;
+    selfTimed->threadSchedules = new_thread_schedules(schedule, selfTimed->actorThreads, selfTimed->numThreads);
+    swap_internal_buffers(selfTimed, true);
+    selfTimed->actors = malloc(graph->numActors * sizeof(CsdfSelfTimedActor));
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        init_actor(selfTimed, actorId);
+    }
+
+    bool completed = run_threads(selfTimed);
+
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        if (selfTimed->busyNanoseconds != NULL)
+        {
+            selfTimed->busyNanoseconds[actorId] = selfTimed->actors[actorId].busyNanoseconds;
+        }
+        free_actor(selfTimed->actors + actorId);
+    }
+    free(selfTimed->actors);
+    swap_internal_buffers(selfTimed, false);
+    for (size_t threadId = 0; threadId < selfTimed->numThreads; threadId++)
+    {
+        delete_schedule(selfTimed->threadSchedules[threadId]);
+    }
+    free(selfTimed->threadSchedules);
+    return completed;
+}
+
+static CsdfRunProfile *profile_warmup(CsdfSelfTimedRun *selfTimed, const CsdfSchedule *schedule, unsigned warmupIterations)
+{
+    CsdfGraphRun *runData = selfTimed->runData;
+    const CsdfGraph *graph = runData->graph;
+    selfTimed->busyNanoseconds = malloc(graph->numActors * sizeof(uint64_t));
+    bool completed = run_phase(selfTimed, schedule, warmupIterations);
+
+    CsdfRunProfile *profile = NULL;
+    if (completed)
+    {
+        profile = new_run_profile(graph, runData->repetitionVector, selfTimed->numThreads);
+        for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+        {
+            uint64_t numFirings = (uint64_t)warmupIterations * runData->repetitionVector[actorId];
+            profile->firingNanoseconds[actorId] = numFirings > 0 ? selfTimed->busyNanoseconds[actorId] / numFirings : 0;
+        }
+        repartition_run_profile(profile, graph, runData->repetitionVector);
+    }
+    free(selfTimed->busyNanoseconds);
+    selfTimed->busyNanoseconds = NULL;
+    return profile;
+}
+
+static bool are_valid_threads(const size_t *actorThreads, size_t numActors, size_t numThreads)
+{
+    for (size_t actorId = 0; actorId < numActors && actorThreads != NULL; actorId++)
+    {
+        if (actorThreads[actorId] >= numThreads)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void init_partition(CsdfSelfTimedRun *selfTimed, const CsdfSchedule *schedule, const CsdfSelfTimedOptions *options)
+{
+    size_t numActors = selfTimed->runData->graph->numActors;
+    if (options != NULL && options->actorThreads != NULL)
+    {
+        memcpy(selfTimed->actorThreads, options->actorThreads, numActors * sizeof(size_t));
+    }
+    else
+    {
+        partition_schedule_order(schedule, numActors, selfTimed->numThreads, selfTimed->actorThreads);
+    }
+}
+
+static bool load_partition(CsdfSelfTimedRun *selfTimed, const char *profilePath)
+{
+    CsdfGraphRun *runData = selfTimed->runData;
+    CsdfRunProfile *profile = profilePath != NULL
+                                  ? load_run_profile(runData->graph, runData->repetitionVector, profilePath)
+                                  : NULL;
+    bool loaded = profile != NULL && profile->numThreads == selfTimed->numThreads;
+    if (loaded)
+    {
+        memcpy(selfTimed->actorThreads, profile->actorThreads, runData->graph->numActors * sizeof(size_t));
+    }
+    if (profile != NULL)
+    {
+        delete_run_profile(profile);
+    }
+    return loaded;
+}
+
+bool self_timed_run(const CsdfThreading *threading, CsdfGraphRun *runData, const CsdfSelfTimedOptions *options)
+{
+    const CsdfGraph *graph = runData->graph;
+    size_t numThreads = options != NULL && options->numThreads > 0 ? options->numThreads : 1;
+    if (runData->sharedBufferMemory != NULL || runData->numIterations == CSDF_UNBOUNDED_ITERATIONS ||
+        !graph_run_is_local(runData) || !graph_run_inputs_attached(runData) ||
+        !are_valid_threads(options != NULL ? options->actorThreads : NULL, graph->numActors, numThreads))
+    {
+        return false;
+    }
+    CsdfSchedule *schedule = new_sequential_schedule(graph, runData->repetitionVector);
+    if (schedule == NULL)
+    {
+        return false;
+    }
+
+    CsdfSelfTimedRun selfTimed = {
+        .threading = threading,
+        .runData = runData,
+        .numThreads = numThreads,
+        .busyNanoseconds = NULL,
+        .wait = options != NULL ? options->wait : NULL};
+    init_progress(&selfTimed.progress);
+    atomic_init(&selfTimed.aborted, false);
+    selfTimed.actorThreads = malloc(graph->numActors * sizeof(size_t));
+    const char *profilePath = options != NULL ? options->profilePath : NULL;
+    unsigned warmupIterations = options != NULL ? options->warmupIterations : 0;
+    bool tuned = load_partition(&selfTimed, profilePath);
+    if (!tuned)
+    {
+        init_partition(&selfTimed, schedule, options);
+    }
+    if (tuned || warmupIterations >= runData->numIterations)
+    {
+        warmupIterations = 0;
+    }
+
+    bool completed = true;
+    if (warmupIterations > 0)
+    {
+        CsdfRunProfile *profile = profile_warmup(&selfTimed, schedule, warmupIterations);
+        completed = profile != NULL;
+        if (completed)
+        {
+            memcpy(selfTimed.actorThreads, profile->actorThreads, graph->numActors * sizeof(size_t));
+            if (profilePath != NULL)
+            {
+                save_run_profile(profile, profilePath);
+            }
+            delete_run_profile(profile);
+        }
+    }
+    completed = completed && run_phase(&selfTimed, schedule, runData->numIterations - warmupIterations);
+
+    delete_schedule(schedule);
+    free(selfTimed.actorThreads);
+    return completed;
+}
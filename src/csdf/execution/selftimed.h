@@ -0,0 +1,70 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_SELFTIMED_H
+#define CSDF_EXECUTION_SELFTIMED_H
+
+#include "graphrun.h"
+#include "wait.h"
+
+#include <csdf/schedule.h>
+#include <threading4csdf.h>
+
+#include <stdatomic.h>
+
+typedef struct CsdfSelfTimedActor CsdfSelfTimedActor;
+
+// Actors are split over numThreads threads. Each thread repeats the
+// sequential schedule restricted to its own actors and only waits on
+// connections that cross threads. Connections inside a thread use plain
+// rings while the run lasts. actorThreads maps each actor to its thread;
+// NULL cuts the schedule order into groups with similar firing counts.
+// Runs fail on thread ids of numThreads or more and on the parts of
+// partitioned runs.
+//
+// With warmupIterations, the first iterations time every firing. After
+// them the actors are repartitioned from the measured costs and traffic,
+// see csdf/execution/profile.h, and the remaining iterations run on the new
+// assignment. A profile at profilePath made for the same graph and thread
+// count replaces both the initial assignment and the warm-up. A new
+// profile is written there after a warm-up.
+//
+// Threads blocked on a crossing connection wait as set by wait, which
+// defaults to sleeping.
+typedef struct CsdfSelfTimedOptions
+{
+    size_t numThreads;
+    const size_t *actorThreads;
+    unsigned warmupIterations;
+    char _pad[4];
+    const char *profilePath;
+    const CsdfWaitStrategy *wait;
+} CsdfSelfTimedOptions;
+
+typedef struct CsdfSelfTimedRun
+{
+    const CsdfThreading *threading;
+    CsdfGraphRun *runData;
+    size_t numThreads;
+    size_t *actorThreads;
+    CsdfSchedule **threadSchedules;
+    CsdfSelfTimedActor *actors;
+    uint64_t *busyNanoseconds;
+    const CsdfWaitStrategy *wait;
+    CsdfProgress progress;
+    unsigned numIterations;
+    atomic_bool aborted;
+} CsdfSelfTimedRun;
+
+// Splits the actors over numThreads threads in the order they first fire
+// in schedule, keeping the firings per thread close to even.
+void partition_schedule_order(const CsdfSchedule *schedule, size_t numActors, size_t numThreads, size_t *actorThreads);
+
+bool self_timed_run(const CsdfThreading *threading, CsdfGraphRun *runData, const CsdfSelfTimedOptions *options);
+
+#endif // CSDF_EXECUTION_SELFTIMED_H
@@ -10,6 +10,9 @@ Copyright (c) 2023 Slaven Glumac
 #include "buffer/stdlockfree.h"
 #include "actorrun.h"
 
+#include <csdf/demand.h>
+
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
@@ -26,15 +29,14 @@ static bool all_zero(unsigned int *repetitionVector, size_t numActors)
     return true;
 }
 
-static bool sequential_iteration(CsdfGraphRun *runData)
+// Fires the remainingFirings of each actor in any order the tokens allow.
+static bool fire_remaining(CsdfGraphRun *runData)
 {
     bool blocked = false;
 
     unsigned int numActors = runData->graph->numActors;
 
-    unsigned int *repetitionVector = malloc(numActors * sizeof(unsigned int));
-
-    memcpy(repetitionVector, runData->repetitionVector, numActors * sizeof(unsigned int));
+    unsigned int *repetitionVector = runData->remainingFirings;
 
     while (!blocked)
     {
@@ -53,14 +55,100 @@ static bool sequential_iteration(CsdfGraphRun *runData)
             }
         }
     }
-    bool iterationCompleted = all_zero(repetitionVector, numActors);
-    free(repetitionVector);
-    return iterationCompleted;
+    return all_zero(repetitionVector, numActors);
+}
+
+static bool sequential_iteration(CsdfGraphRun *runData)
+{
+    memcpy(runData->remainingFirings, runData->repetitionVector, runData->graph->numActors * sizeof(unsigned int));
+    return fire_remaining(runData);
+}
+
+// Buffers hold a whole block, so its firings need no readiness checks.
+static void sequential_block(CsdfGraphRun *runData)
+{
+    const CsdfSchedule *schedule = runData->blockSchedule;
+    for (size_t entryId = 0; entryId < schedule->numEntries; entryId++)
+    {
+        const CsdfScheduleEntry *entry = schedule->entries + entryId;
+        CsdfActorRun *actorRun = runData->actorRuns[entry->actorId];
+        for (unsigned firing = 0; firing < entry->count; firing++)
+        {
+            fire(actorRun);
+        }
+    }
+}
+
+// The iterations every actor has completed, UINT_MAX when the actors stand
+// at different points of an iteration.
+static unsigned completed_iterations(const CsdfGraphRun *runData)
+{
+    unsigned completed = UINT_MAX;
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        const CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        unsigned repetitions = runData->repetitionVector[actorId];
+        unsigned actorCompleted = actorRun->fireCount / repetitions;
+        if (actorRun->fireCount % repetitions != 0 || (completed != UINT_MAX && actorCompleted != completed))
+        {
+            return UINT_MAX;
+        }
+        completed = actorCompleted;
+    }
+    return completed;
+}
+
+// Brings every actor to the end of the iteration the furthest one has
+// started and returns the iterations then completed.
+static bool complete_iteration(CsdfGraphRun *runData, unsigned *completed)
+{
+    unsigned boundary = 0;
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        const CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        unsigned repetitions = runData->repetitionVector[actorId];
+        unsigned started = (actorRun->fireCount + repetitions - 1) / repetitions;
+        boundary = started > boundary ? started : boundary;
+    }
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        const CsdfActorRun *actorRun = runData->actorRuns[actorId];
+        runData->remainingFirings[actorId] = boundary * runData->repetitionVector[actorId] - actorRun->fireCount;
+    }
+    *completed = boundary;
+    return fire_remaining(runData);
 }
 
 bool sequential_run(CsdfGraphRun *runData)
 {
-    for (unsigned int executed = 0; executed < runData->numIterations; executed++)
+    if (!graph_run_is_local(runData) || !graph_run_inputs_attached(runData))
+    {
+        return false;
+    }
+    // Actors a demand run has exhausted just wait for the others to catch up.
+    unsigned executed = completed_iterations(runData);
+    if (executed == runData->numIterations)
+    {
+        return false;
+    }
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        set_actor_run_thread(runData, actorId, 0);
+    }
+    if (executed == UINT_MAX && !complete_iteration(runData, &executed))
+    {
+        return false;
+    }
+    if (runData->blockSchedule != NULL)
+    {
+        // Blocks skip can_fire, so they only start on an iteration boundary
+        // and stay within the iterations the actors have left.
+        for (; runData->numIterations - executed >= runData->blockingFactor; executed += runData->blockingFactor)
+        {
+            sequential_block(runData);
+        }
+    }
+    for (; executed < runData->numIterations; executed++)
     {
         if (!sequential_iteration(runData))
         {
@@ -68,4 +156,58 @@ bool sequential_run(CsdfGraphRun *runData)
         }
     }
     return true;
-}
\ No newline at end of file
+}
+
+// Unbounded runs allow each actor the iterations target needs plus one
+// block of lag per actor on the way.
+static unsigned demand_bound(const CsdfGraphRun *runData, const CsdfActorRun *actorRun, size_t actorId, uint64_t targetIterations)
+{
+    if (actorRun->maxFireCount != CSDF_UNBOUNDED_FIRE_COUNT)
+    {
+        return actorRun->maxFireCount - actorRun->fireCount;
+    }
+    uint64_t numBlocks = (uint64_t)runData->graph->numActors * ((uint64_t)runData->blockingFactor + 1);
+    uint64_t bound = (uint64_t)runData->repetitionVector[actorId] * (targetIterations + numBlocks);
+    return bound < UINT_MAX ? (unsigned)bound : UINT_MAX - 1;
+}
+
+static bool plan_demand(CsdfGraphRun *runData, CsdfOutputId target, unsigned numTokens)
+{
+    const CsdfGraph *graph = runData->graph;
+    unsigned *numQueued = malloc(graph->numConnections * sizeof(unsigned));
+    unsigned *capacities = malloc(graph->numConnections * sizeof(unsigned));
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        CsdfBuffer *buffer = runData->buffers[connectionId];
+        numQueued[connectionId] = buffer->numberOfTokens(buffer);
+        capacities[connectionId] = numQueued[connectionId] + buffer->freeSpace(buffer);
+    }
+    unsigned production = graph->actors[target.actorId].outputs[target.outputId].production;
+    uint64_t targetFirings = ((uint64_t)numTokens + production - 1) / production;
+    unsigned targetRepetitions = runData->repetitionVector[target.actorId];
+    uint64_t targetIterations = (targetFirings + targetRepetitions - 1) / targetRepetitions;
+    unsigned *maxFirings = malloc(graph->numActors * sizeof(unsigned));
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        maxFirings[actorId] = demand_bound(runData, runData->actorRuns[actorId], actorId, targetIterations);
+    }
+    bool planned = firing_demand(graph, numQueued, capacities, maxFirings, target, numTokens, runData->remainingFirings);
+    free(maxFirings);
+    free(capacities);
+    free(numQueued);
+    return planned;
+}
+
+bool sequential_demand_run(CsdfGraphRun *runData, CsdfOutputId target, unsigned numTokens)
+{
+    if (runData->bufferPacking != NULL || !graph_run_is_local(runData) || !graph_run_inputs_attached(runData) ||
+        !plan_demand(runData, target, numTokens))
+    {
+        return false;
+    }
+    for (size_t actorId = 0; actorId < runData->graph->numActors; actorId++)
+    {
+        set_actor_run_thread(runData, actorId, 0);
+    }
+    return fire_remaining(runData);
+}
@@ -11,6 +11,18 @@ Copyright (c) 2023 Slaven Glumac
 
 #include <csdf/execution/graphrun.h>
 
+// Runs the iterations the run has left. After a demand run it first
+// completes the iteration the furthest actor has started. Returns false
+// once every iteration has run, until reset_graph_run, and for partial
+// runs.
 bool sequential_run(CsdfGraphRun *runData);
 
+// Fires only the firings target needs to produce numTokens more tokens
+// from the current state of the run, see firing_demand, so actors off the
+// path to target stay idle. Calls continue where the previous run stopped,
+// and so does a later sequential_run.
+// Returns false when the demand exceeds the iterations of the run, when it
+// deadlocks and for partial runs or runs sharing buffer memory.
+bool sequential_demand_run(CsdfGraphRun *runData, CsdfOutputId target, unsigned numTokens);
+
 #endif // CSDF_EXECUTION_SEQUENTIAL_H
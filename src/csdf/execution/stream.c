@@ -0,0 +1,192 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "stream.h"
+#include "buffer/stdlockfree.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct CsdfStreamActorRun
+{
+    CsdfStream *stream;
+    CsdfActorRun *actorRun;
+    void *threadData;
+};
+
+static bool run_stream_actor(void *taskData)
+{
+    CsdfStreamActorRun *streamActorRun = taskData;
+    CsdfStream *stream = streamActorRun->stream;
+    CsdfActorRun *actorRun = streamActorRun->actorRun;
+    const CsdfThreading *threading = stream->threading;
+
+    while (!atomic_load_explicit(&stream->stopped, memory_order_relaxed))
+    {
+        if (can_fire(actorRun))
+        {
+            fire(actorRun);
+        }
+        else
+        {
+            threading->sleep(threading->microsecondsSleep);
+        }
+    }
+    return true;
+}
+
+static void init_port_connection(CsdfConnection *portConnection, CsdfOutputId source, CsdfInputId destination, size_t tokenSize)
+{
+    CsdfConnection connection = {
+        .source = source,
+        .destination = destination,
+        .tokenSize = tokenSize,
+        .numTokens = 0,
+        .initialTokens = NULL};
+    memcpy(portConnection, &connection, sizeof(CsdfConnection));
+}
+
+static void attach_input_ports(CsdfStream *stream, const CsdfInputId *inputPorts, unsigned portCapacity)
+{
+    const CsdfGraph *graph = stream->runData->graph;
+    for (size_t portId = 0; portId < stream->numInputPorts; portId++)
+    {
+        const CsdfInputId *inputPort = inputPorts + portId;
+        const CsdfInput *input = graph->actors[inputPort->actorId].inputs + inputPort->inputId;
+        CsdfOutputId host = {.actorId = SIZE_MAX, .outputId = portId};
+        CsdfConnection *portConnection = stream->portConnections + portId;
+        init_port_connection(portConnection, host, *inputPort, input->tokenSize);
+        CsdfBuffer *buffer = new_stdlockfree_buffer(portConnection, portCapacity + 1);
+        stream->inputPorts[portId] = buffer;
+        attach_input_port(stream->runData, *inputPort, buffer);
+    }
+}
+
+static void attach_output_ports(CsdfStream *stream, const CsdfOutputId *outputPorts, unsigned portCapacity)
+{
+    const CsdfGraph *graph = stream->runData->graph;
+    for (size_t portId = 0; portId < stream->numOutputPorts; portId++)
+    {
+        const CsdfOutputId *outputPort = outputPorts + portId;
+        const CsdfOutput *output = graph->actors[outputPort->actorId].outputs + outputPort->outputId;
+        CsdfInputId host = {.actorId = SIZE_MAX, .inputId = portId};
+        CsdfConnection *portConnection = stream->portConnections + stream->numInputPorts + portId;
+        init_port_connection(portConnection, *outputPort, host, output->tokenSize);
+        CsdfBuffer *buffer = new_stdlockfree_buffer(portConnection, portCapacity + 1);
+        stream->outputPorts[portId] = buffer;
+        attach_output_port(stream->runData, *outputPort, buffer);
+    }
+}
+
+static void delete_stream(CsdfStream *stream)
+{
+    for (size_t actorId = 0; actorId < stream->runData->graph->numActors; actorId++)
+    {
+        free(stream->streamActorRuns[actorId].threadData);
+    }
+    delete_graph_run(stream->runData);
+    for (size_t portId = 0; portId < stream->numInputPorts; portId++)
+    {
+        delete_stdlockfree_buffer(stream->inputPorts[portId]);
+    }
+    for (size_t portId = 0; portId < stream->numOutputPorts; portId++)
+    {
+        delete_stdlockfree_buffer(stream->outputPorts[portId]);
+    }
+    free(stream->streamActorRuns);
+    free(stream->portConnections);
+    free(stream->inputPorts);
+    free(stream->outputPorts);
+    free(stream);
+}
+
+CsdfStream *start_stream(
+    const CsdfThreading *threading, const CsdfGraph *graph,
+    size_t numInputPorts, const CsdfInputId *inputPorts,
+    size_t numOutputPorts, const CsdfOutputId *outputPorts,
+    unsigned portCapacity)
+{
+    if (!are_graph_ports(graph, numInputPorts, inputPorts, numOutputPorts, outputPorts))
+    {
+        return NULL;
+    }
+    CsdfGraphRunOptions options = {.numRecordSelections = 0};
+    CsdfGraphRun *runData = new_graph_run_with_options(graph, CSDF_UNBOUNDED_ITERATIONS, &options);
+    if (runData == NULL)
+    {
+        return NULL;
+    }
+
+    CsdfStream *stream = malloc(sizeof(CsdfStream));
+    stream->threading = threading;
+    stream->runData = runData;
+    stream->numInputPorts = numInputPorts;
+    stream->inputPorts = malloc(numInputPorts * sizeof(CsdfBuffer *));
+    stream->numOutputPorts = numOutputPorts;
+    stream->outputPorts = malloc(numOutputPorts * sizeof(CsdfBuffer *));
+    stream->portConnections = malloc((numInputPorts + numOutputPorts) * sizeof(CsdfConnection));
+    atomic_init(&stream->stopped, false);
+    attach_input_ports(stream, inputPorts, portCapacity);
+    attach_output_ports(stream, outputPorts, portCapacity);
+
+    stream->streamActorRuns = malloc(graph->numActors * sizeof(CsdfStreamActorRun));
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        CsdfStreamActorRun *streamActorRun = stream->streamActorRuns + actorId;
+        streamActorRun->stream = stream;
+        streamActorRun->actorRun = stream->runData->actorRuns[actorId];
+        streamActorRun->threadData = malloc(threading->threadDataSize);
+    }
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        CsdfStreamActorRun *streamActorRun = stream->streamActorRuns + actorId;
+        set_actor_run_thread(stream->runData, actorId, actorId);
+        if (!threading->createThread(streamActorRun->threadData, run_stream_actor, streamActorRun))
+        {
+            atomic_store(&stream->stopped, true);
+            for (size_t startedId = 0; startedId < actorId; startedId++)
+            {
+                threading->joinThread(stream->streamActorRuns[startedId].threadData);
+            }
+            delete_stream(stream);
+            return NULL;
+        }
+    }
+    return stream;
+}
+
+size_t stream_push(CsdfStream *stream, size_t portId, const void *tokens, size_t numTokens)
+{
+    CsdfBuffer *buffer = stream->inputPorts[portId];
+    size_t freeSpace = buffer->freeSpace(buffer);
+    size_t numPushed = numTokens < freeSpace ? numTokens : freeSpace;
+    buffer->pushTokens(buffer, tokens, numPushed);
+    return numPushed;
+}
+
+size_t stream_pull(CsdfStream *stream, size_t portId, void *tokens, size_t maxTokens)
+{
+    CsdfBuffer *buffer = stream->outputPorts[portId];
+    size_t numTokens = buffer->numberOfTokens(buffer);
+    size_t numPulled = maxTokens < numTokens ? maxTokens : numTokens;
+    buffer->popTokens(buffer, tokens, numPulled);
+    return numPulled;
+}
+
+bool stop_stream(CsdfStream *stream)
+{
+    bool joined = true;
+    atomic_store(&stream->stopped, true);
+    for (size_t actorId = 0; actorId < stream->runData->graph->numActors; actorId++)
+    {
+        joined = stream->threading->joinThread(stream->streamActorRuns[actorId].threadData) && joined;
+    }
+    delete_stream(stream);
+    return joined;
+}
@@ -0,0 +1,50 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_STREAM_H
+#define CSDF_EXECUTION_STREAM_H
+
+#include "graphrun.h"
+
+#include <threading4csdf.h>
+
+#include <stdatomic.h>
+
+typedef struct CsdfStreamActorRun CsdfStreamActorRun;
+
+// A continuously running graph whose unconnected input ports are fed and
+// whose output ports are drained by the host. Each port expects a single
+// host thread pushing or pulling. start_stream returns NULL unless every
+// port is an unconnected port of the graph, listed once, and every
+// unconnected input is an input port.
+typedef struct CsdfStream
+{
+    const CsdfThreading *threading;
+    CsdfGraphRun *runData;
+    size_t numInputPorts;
+    CsdfBuffer **inputPorts;
+    size_t numOutputPorts;
+    CsdfBuffer **outputPorts;
+    CsdfConnection *portConnections;
+    CsdfStreamActorRun *streamActorRuns;
+    atomic_bool stopped;
+} CsdfStream;
+
+CsdfStream *start_stream(
+    const CsdfThreading *threading, const CsdfGraph *graph,
+    size_t numInputPorts, const CsdfInputId *inputPorts,
+    size_t numOutputPorts, const CsdfOutputId *outputPorts,
+    unsigned portCapacity);
+
+size_t stream_push(CsdfStream *stream, size_t portId, const void *tokens, size_t numTokens);
+
+size_t stream_pull(CsdfStream *stream, size_t portId, void *tokens, size_t maxTokens);
+
+bool stop_stream(CsdfStream *stream);
+
+#endif // CSDF_EXECUTION_STREAM_H
@@ -0,0 +1,146 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+CsdfTrace *new_trace(size_t numThreads, size_t eventsPerThread)
+{
+    CsdfTrace *trace = malloc(sizeof(CsdfTrace));
+    trace->numThreads = numThreads;
+    trace->threadBuffers = malloc(numThreads * sizeof(CsdfTraceBuffer));
+    for (size_t threadId = 0; threadId < numThreads; threadId++)
+    {
+        CsdfTraceBuffer *traceBuffer = trace->threadBuffers + threadId;
+        traceBuffer->events = malloc(eventsPerThread * sizeof(CsdfTraceEvent));
+        traceBuffer->capacity = eventsPerThread;
+        traceBuffer->numWritten = 0;
+    }
+    return trace;
+}
+
+void delete_trace(CsdfTrace *trace)
+{
+    for (size_t threadId = 0; threadId < trace->numThreads; threadId++)
+    {
+        free(trace->threadBuffers[threadId].events);
+    }
+    free(trace->threadBuffers);
+    free(trace);
+}
+
+void reset_trace(CsdfTrace *trace)
+{
+    for (size_t threadId = 0; threadId < trace->numThreads; threadId++)
+    {
+        trace->threadBuffers[threadId].numWritten = 0;
+    }
+}
+
+CsdfTraceBuffer *trace_thread_buffer(CsdfTrace *trace, size_t threadId)
+{
+    return trace != NULL && threadId < trace->numThreads ? trace->threadBuffers + threadId : NULL;
+}
+
+uint64_t trace_timestamp(void)
+{
+    struct timespec now;
+#ifndef _WIN32
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+    timespec_get(&now, TIME_UTC);
+#endif
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+void trace_firing(CsdfTraceBuffer *traceBuffer, const CsdfActor *actor, unsigned fireCount, uint64_t beginNanoseconds)
+{
+    if (traceBuffer->capacity == 0)
+    {
+        return;
+    }
+    CsdfTraceEvent *event = traceBuffer->events + traceBuffer->numWritten % traceBuffer->capacity;
+    event->actor = actor;
+    event->fireCount = fireCount;
+    event->beginNanoseconds = beginNanoseconds;
+    event->endNanoseconds = trace_timestamp();
+    traceBuffer->numWritten++;
+}
+
+size_t trace_num_events(const CsdfTrace *trace, size_t threadId)
+{
+    const CsdfTraceBuffer *traceBuffer = trace->threadBuffers + threadId;
+    return traceBuffer->numWritten < traceBuffer->capacity
+               ? traceBuffer->numWritten
+               : traceBuffer->capacity;
+}
+
+static size_t first_event_id(const CsdfTraceBuffer *traceBuffer)
+{
+    return traceBuffer->numWritten < traceBuffer->capacity
+               ? 0
+               : traceBuffer->numWritten - traceBuffer->capacity;
+}
+
+static uint64_t earliest_timestamp(const CsdfTrace *trace)
+{
+    uint64_t earliest = UINT64_MAX;
+    for (size_t threadId = 0; threadId < trace->numThreads; threadId++)
+    {
+        const CsdfTraceBuffer *traceBuffer = trace->threadBuffers + threadId;
+        if (trace_num_events(trace, threadId) > 0)
+        {
+            const CsdfTraceEvent *event = traceBuffer->events + first_event_id(traceBuffer) % traceBuffer->capacity;
+            if (event->beginNanoseconds < earliest)
+            {
+                earliest = event->beginNanoseconds;
+            }
+        }
+    }
+    return earliest;
+}
+
+bool export_chrome_trace(const CsdfTrace *trace, const CsdfGraph *graph, const unsigned *repetitionVector, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    uint64_t origin = earliest_timestamp(trace);
+    const char *separator = "";
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (size_t threadId = 0; threadId < trace->numThreads; threadId++)
+    {
+        const CsdfTraceBuffer *traceBuffer = trace->threadBuffers + threadId;
+        for (size_t eventId = first_event_id(traceBuffer); eventId < traceBuffer->numWritten; eventId++)
+        {
+            const CsdfTraceEvent *event = traceBuffer->events + eventId % traceBuffer->capacity;
+            size_t actorId = (size_t)(event->actor - graph->actors);
+            unsigned iteration = event->fireCount / repetitionVector[actorId];
+            fprintf(file,
+                    "%s\n{\"name\":\"actor %zu\",\"cat\":\"fire\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,"
+                    "\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"args\":{\"actor\":%zu,\"firing\":%u,\"iteration\":%u}}",
+                    separator, actorId, threadId,
+                    (double)(event->beginNanoseconds - origin) / 1000.,
+                    (double)(event->endNanoseconds - event->beginNanoseconds) / 1000.,
+                    actorId, event->fireCount, iteration);
+            separator = ",";
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
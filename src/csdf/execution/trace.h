@@ -0,0 +1,61 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_TRACE_H
+#define CSDF_EXECUTION_TRACE_H
+
+#include <csdf/graph.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct CsdfTraceEvent
+{
+    const CsdfActor *actor;
+    uint64_t beginNanoseconds;
+    uint64_t endNanoseconds;
+    unsigned fireCount;
+    char _pad[4];
+} CsdfTraceEvent;
+
+// Each thread writes only to its own buffer, so recording needs no locks.
+// When full, the oldest events are overwritten.
+typedef struct CsdfTraceBuffer
+{
+    CsdfTraceEvent *events;
+    size_t capacity;
+    size_t numWritten;
+} CsdfTraceBuffer;
+
+typedef struct CsdfTrace
+{
+    size_t numThreads;
+    CsdfTraceBuffer *threadBuffers;
+} CsdfTrace;
+
+CsdfTrace *new_trace(size_t numThreads, size_t eventsPerThread);
+
+void delete_trace(CsdfTrace *trace);
+
+// Forgets the recorded events and keeps the buffers.
+void reset_trace(CsdfTrace *trace);
+
+// Returns NULL when trace is NULL or has no buffer for threadId.
+CsdfTraceBuffer *trace_thread_buffer(CsdfTrace *trace, size_t threadId);
+
+// Monotonic nanoseconds, so only differences between timestamps are
+// meaningful. Windows falls back to the wall clock.
+uint64_t trace_timestamp(void);
+
+void trace_firing(CsdfTraceBuffer *traceBuffer, const CsdfActor *actor, unsigned fireCount, uint64_t beginNanoseconds);
+
+size_t trace_num_events(const CsdfTrace *trace, size_t threadId);
+
+bool export_chrome_trace(const CsdfTrace *trace, const CsdfGraph *graph, const unsigned *repetitionVector, const char *path);
+
+#endif // CSDF_EXECUTION_TRACE_H
@@ -0,0 +1,174 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "wait.h"
+
+#include <limits.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
+#define DEFAULT_SPIN_LIMIT 1000u
+#define DEFAULT_PARK_MICROSECONDS 1000u
+#define MIN_ADAPTIVE_SPIN_LIMIT 16u
+#define MAX_ADAPTIVE_SPIN_LIMIT 100000u
+
+static void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static void yield_cpu(const CsdfThreading *threading)
+{
+#ifndef _WIN32
+    sched_yield();
+    (void)threading;
+#else
+    threading->sleep(0);
+#endif
+}
+
+static void park(CsdfWaiter *waiter, unsigned seenEpoch)
+{
+#if defined(__linux__)
+    struct timespec timeout = {
+        .tv_sec = waiter->parkMicroseconds / 1000000u,
+        .tv_nsec = (long)(waiter->parkMicroseconds % 1000000u) * 1000};
+    syscall(SYS_futex, &waiter->progress->epoch, FUTEX_WAIT_PRIVATE, seenEpoch, &timeout, NULL, 0);
+#else
+    (void)seenEpoch;
+    waiter->threading->sleep(waiter->parkMicroseconds);
+#endif
+}
+
+void init_progress(CsdfProgress *progress)
+{
+    atomic_init(&progress->epoch, 0);
+    atomic_init(&progress->numParked, 0);
+}
+
+void init_waiter(CsdfWaiter *waiter, const CsdfWaitStrategy *strategy, const CsdfThreading *threading, CsdfProgress *progress)
+{
+    waiter->mode = strategy != NULL ? strategy->mode : CSDF_WAIT_SLEEP;
+    waiter->spinLimit = strategy != NULL && strategy->spinLimit > 0 ? strategy->spinLimit : DEFAULT_SPIN_LIMIT;
+    waiter->parkMicroseconds = strategy != NULL && strategy->parkMicroseconds > 0 ? strategy->parkMicroseconds : DEFAULT_PARK_MICROSECONDS;
+    waiter->threading = threading;
+    waiter->progress = progress;
+}
+
+static bool spin(CsdfWaiter *waiter, CsdfWaitCondition condition, void *conditionData, unsigned *numSpins)
+{
+    for (*numSpins = 0; *numSpins < waiter->spinLimit; ++*numSpins)
+    {
+        if (condition(conditionData))
+        {
+            return true;
+        }
+        cpu_relax();
+    }
+    return false;
+}
+
+static void park_until(CsdfWaiter *waiter, CsdfWaitCondition condition, void *conditionData)
+{
+    CsdfProgress *progress = waiter->progress;
+    while (true)
+    {
+        atomic_fetch_add(&progress->numParked, 1);
+        unsigned seenEpoch = atomic_load(&progress->epoch);
+        if (condition(conditionData))
+        {
+            atomic_fetch_sub(&progress->numParked, 1);
+            return;
+        }
+        park(waiter, seenEpoch);
+        atomic_fetch_sub(&progress->numParked, 1);
+    }
+}
+
+static void adapt_spin_limit(CsdfWaiter *waiter, bool spun, unsigned numSpins)
+{
+    unsigned spinLimit = spun
+                             ? (waiter->spinLimit + 2 * numSpins + 1) / 2
+                             : waiter->spinLimit / 2;
+    spinLimit = spinLimit < MIN_ADAPTIVE_SPIN_LIMIT ? MIN_ADAPTIVE_SPIN_LIMIT : spinLimit;
+    waiter->spinLimit = spinLimit > MAX_ADAPTIVE_SPIN_LIMIT ? MAX_ADAPTIVE_SPIN_LIMIT : spinLimit;
+}
+
+void wait_until(CsdfWaiter *waiter, CsdfWaitCondition condition, void *conditionData)
+{
+    const CsdfThreading *threading = waiter->threading;
+    if (waiter->mode == CSDF_WAIT_SLEEP)
+    {
+        while (!condition(conditionData))
+        {
+            threading->sleep(threading->microsecondsSleep);
+        }
+        return;
+    }
+    unsigned numSpins;
+    bool spun = spin(waiter, condition, conditionData, &numSpins);
+    if (waiter->mode == CSDF_WAIT_ADAPTIVE)
+    {
+        adapt_spin_limit(waiter, spun, numSpins);
+    }
+    if (spun)
+    {
+        return;
+    }
+    switch (waiter->mode)
+    {
+    case CSDF_WAIT_SPIN:
+        while (!condition(conditionData))
+        {
+            cpu_relax();
+        }
+        break;
+    case CSDF_WAIT_YIELD:
+        while (!condition(conditionData))
+        {
+            yield_cpu(threading);
+        }
+        break;
+    default:
+        park_until(waiter, condition, conditionData);
+        break;
+    }
+}
+
+void signal_progress(CsdfProgress *progress)
+{
+    // Orders the caller's release store before the numParked load; pairs
+    // with the increment in park_until so a parking waiter either sees the
+    // progress or is seen here.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&progress->numParked) == 0)
+    {
+        return;
+    }
+    atomic_fetch_add(&progress->epoch, 1);
+#if defined(__linux__)
+    syscall(SYS_futex, &progress->epoch, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+}
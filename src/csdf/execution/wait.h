@@ -0,0 +1,71 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_EXECUTION_WAIT_H
+#define CSDF_EXECUTION_WAIT_H
+
+#include <threading4csdf.h>
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// How executor threads wait for input tokens or output space.
+// CSDF_WAIT_SLEEP calls CsdfThreading::sleep between checks. The others
+// first spin with a CPU pause hint for spinLimit checks. CSDF_WAIT_SPIN
+// never stops spinning, CSDF_WAIT_YIELD then yields the CPU and
+// CSDF_WAIT_PARK then parks until another thread signals progress or
+// parkMicroseconds pass. CSDF_WAIT_ADAPTIVE parks like CSDF_WAIT_PARK, but
+// each thread moves its spin limit toward the spins its recent waits
+// needed.
+typedef enum CsdfWaitMode
+{
+    CSDF_WAIT_SLEEP,
+    CSDF_WAIT_SPIN,
+    CSDF_WAIT_YIELD,
+    CSDF_WAIT_PARK,
+    CSDF_WAIT_ADAPTIVE
+} CsdfWaitMode;
+
+typedef struct CsdfWaitStrategy
+{
+    CsdfWaitMode mode;
+    unsigned spinLimit;
+    unsigned parkMicroseconds;
+} CsdfWaitStrategy;
+
+// Shared by the threads of one run. Parked threads sleep on epoch, which
+// only advances while some thread is parked.
+typedef struct CsdfProgress
+{
+    atomic_uint epoch;
+    atomic_uint numParked;
+} CsdfProgress;
+
+typedef struct CsdfWaiter
+{
+    CsdfWaitMode mode;
+    unsigned spinLimit;
+    unsigned parkMicroseconds;
+    char _pad[4];
+    const CsdfThreading *threading;
+    CsdfProgress *progress;
+} CsdfWaiter;
+
+typedef bool (*CsdfWaitCondition)(void *conditionData);
+
+void init_progress(CsdfProgress *progress);
+
+// A NULL strategy sleeps through CsdfThreading.
+void init_waiter(CsdfWaiter *waiter, const CsdfWaitStrategy *strategy, const CsdfThreading *threading, CsdfProgress *progress);
+
+void wait_until(CsdfWaiter *waiter, CsdfWaitCondition condition, void *conditionData);
+
+// Called after a thread pushed or popped tokens that others may wait for.
+void signal_progress(CsdfProgress *progress);
+
+#endif // CSDF_EXECUTION_WAIT_H
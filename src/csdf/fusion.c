@@ -0,0 +1,410 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "fusion.h"
+#include "repetition.h"
+#include "schedule.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct CsdfFusedActor
+{
+    const CsdfActor first;
+    const CsdfActor second;
+    unsigned numFirst;
+    unsigned numSecond;
+    CsdfInput *inputs;
+    CsdfOutput *outputs;
+    size_t firstConsumedSize;
+    size_t intermediateSize;
+    size_t secondProducedSize;
+};
+
+// The scratch of one actor run of a fused actor, along with the run
+// contexts of the two actors it fires.
+typedef struct FusedRun
+{
+    const CsdfFusedActor *fused;
+    void *firstContext;
+    void *secondContext;
+    uint8_t *firstConsumed;
+    uint8_t *intermediate;
+    uint8_t *secondProduced;
+} FusedRun;
+
+typedef struct FusionStep
+{
+    size_t numActors;
+    CsdfActor *actors;
+    size_t numConnections;
+    CsdfConnection *connections;
+    size_t *connectionIds;
+} FusionStep;
+
+static unsigned gcd(unsigned a, unsigned b)
+{
+    while (b != 0)
+    {
+        unsigned temp = b;
+        b = a % b;
+        a = temp;
+    }
+    return a;
+}
+
+static const uint8_t *gather_inputs(FusedRun *fusedRun, const uint8_t *consumed, unsigned firing)
+{
+    const CsdfFusedActor *fused = fusedRun->fused;
+    const CsdfActor *first = &fused->first;
+    if (first->numInputs == 1)
+    {
+        return consumed + firing * first->inputs[0].consumption * first->inputs[0].tokenSize;
+    }
+    uint8_t *firstConsumed = fusedRun->firstConsumed;
+    const uint8_t *region = consumed;
+    for (size_t inputId = 0; inputId < first->numInputs; inputId++)
+    {
+        const CsdfInput *input = first->inputs + inputId;
+        size_t sliceSize = input->consumption * input->tokenSize;
+        memcpy(firstConsumed, region + firing * sliceSize, sliceSize);
+        firstConsumed += sliceSize;
+        region += fused->numFirst * sliceSize;
+    }
+    return fusedRun->firstConsumed;
+}
+
+static void scatter_outputs(FusedRun *fusedRun, uint8_t *produced, unsigned firing)
+{
+    const CsdfFusedActor *fused = fusedRun->fused;
+    const CsdfActor *second = &fused->second;
+    const uint8_t *secondProduced = fusedRun->secondProduced;
+    uint8_t *region = produced;
+    for (size_t outputId = 0; outputId < second->numOutputs; outputId++)
+    {
+        const CsdfOutput *output = second->outputs + outputId;
+        size_t sliceSize = output->production * output->tokenSize;
+        memcpy(region + firing * sliceSize, secondProduced, sliceSize);
+        secondProduced += sliceSize;
+        region += fused->numSecond * sliceSize;
+    }
+}
+
+static void fused_execute(void *runContext, const void *consumed, void *produced)
+{
+    FusedRun *fusedRun = runContext;
+    const CsdfFusedActor *fused = fusedRun->fused;
+    const CsdfActor *first = &fused->first;
+    const CsdfActor *second = &fused->second;
+    size_t intermediateSize = first->outputs[0].production * first->outputs[0].tokenSize;
+    for (unsigned firing = 0; firing < fused->numFirst; firing++)
+    {
+        const uint8_t *firstConsumed = gather_inputs(fusedRun, consumed, firing);
+        csdf_actor_execute_in(first, fusedRun->firstContext, firstConsumed, fusedRun->intermediate + firing * intermediateSize);
+    }
+    size_t secondConsumedSize = second->inputs[0].consumption * second->inputs[0].tokenSize;
+    for (unsigned firing = 0; firing < fused->numSecond; firing++)
+    {
+        const uint8_t *secondConsumed = fusedRun->intermediate + firing * secondConsumedSize;
+        if (second->numOutputs == 1)
+        {
+            size_t producedSize = second->outputs[0].production * second->outputs[0].tokenSize;
+            csdf_actor_execute_in(second, fusedRun->secondContext, secondConsumed, (uint8_t *)produced + firing * producedSize);
+        }
+        else
+        {
+            csdf_actor_execute_in(second, fusedRun->secondContext, secondConsumed, fusedRun->secondProduced);
+            scatter_outputs(fusedRun, produced, firing);
+        }
+    }
+}
+
+static void *new_fused_run(void *context)
+{
+    const CsdfFusedActor *fused = context;
+    FusedRun *fusedRun = malloc(sizeof(FusedRun));
+    fusedRun->fused = fused;
+    fusedRun->firstContext = csdf_actor_new_run_context(&fused->first);
+    fusedRun->secondContext = csdf_actor_new_run_context(&fused->second);
+    fusedRun->firstConsumed = malloc(fused->firstConsumedSize);
+    fusedRun->intermediate = malloc(fused->intermediateSize);
+    fusedRun->secondProduced = malloc(fused->secondProducedSize);
+    return fusedRun;
+}
+
+static void delete_fused_run(void *runContext)
+{
+    FusedRun *fusedRun = runContext;
+    csdf_actor_delete_run_context(&fusedRun->fused->first, fusedRun->firstContext);
+    csdf_actor_delete_run_context(&fusedRun->fused->second, fusedRun->secondContext);
+    free(fusedRun->secondProduced);
+    free(fusedRun->intermediate);
+    free(fusedRun->firstConsumed);
+    free(fusedRun);
+}
+
+static CsdfFusedActor *new_fused_actor(const CsdfActor *first, const CsdfActor *second, unsigned numFirst, unsigned numSecond)
+{
+    CsdfFusedActor *fused = malloc(sizeof(CsdfFusedActor));
+    memcpy((void *)&fused->first, first, sizeof(CsdfActor));
+    memcpy((void *)&fused->second, second, sizeof(CsdfActor));
+    fused->numFirst = numFirst;
+    fused->numSecond = numSecond;
+
+    size_t firstConsumedSize = 0;
+    fused->inputs = malloc(first->numInputs * sizeof(CsdfInput));
+    for (size_t inputId = 0; inputId < first->numInputs; inputId++)
+    {
+        const CsdfInput *input = first->inputs + inputId;
+        CsdfInput fusedInput = {.tokenSize = input->tokenSize, .consumption = input->consumption * numFirst};
+        memcpy(fused->inputs + inputId, &fusedInput, sizeof(CsdfInput));
+        firstConsumedSize += input->consumption * input->tokenSize;
+    }
+    size_t secondProducedSize = 0;
+    fused->outputs = malloc(second->numOutputs * sizeof(CsdfOutput));
+    for (size_t outputId = 0; outputId < second->numOutputs; outputId++)
+    {
+        const CsdfOutput *output = second->outputs + outputId;
+        CsdfOutput fusedOutput = {.tokenSize = output->tokenSize, .production = output->production * numSecond};
+        memcpy(fused->outputs + outputId, &fusedOutput, sizeof(CsdfOutput));
+        secondProducedSize += output->production * output->tokenSize;
+    }
+    const CsdfOutput *intermediate = first->outputs;
+    fused->firstConsumedSize = firstConsumedSize;
+    fused->intermediateSize = numFirst * intermediate->production * intermediate->tokenSize;
+    fused->secondProducedSize = secondProducedSize;
+    return fused;
+}
+
+static void delete_fused_actor(CsdfFusedActor *fused)
+{
+    free(fused->outputs);
+    free(fused->inputs);
+    free(fused);
+}
+
+static void init_connection(CsdfConnection *destination, const CsdfConnection *connection, size_t sourceActorId, size_t destinationActorId)
+{
+    CsdfConnection remapped = {
+        .source = {.actorId = sourceActorId, .outputId = connection->source.outputId},
+        .destination = {.actorId = destinationActorId, .inputId = connection->destination.inputId},
+        .tokenSize = connection->tokenSize,
+        .numTokens = connection->numTokens,
+        .initialTokens = connection->initialTokens};
+    memcpy(destination, &remapped, sizeof(CsdfConnection));
+}
+
+static void init_step(FusionStep *step, const CsdfGraph *graph)
+{
+    step->numActors = graph->numActors;
+    step->actors = malloc(graph->numActors * sizeof(CsdfActor));
+    memcpy(step->actors, graph->actors, graph->numActors * sizeof(CsdfActor));
+    step->numConnections = graph->numConnections;
+    step->connections = malloc(graph->numConnections * sizeof(CsdfConnection));
+    memcpy(step->connections, graph->connections, graph->numConnections * sizeof(CsdfConnection));
+    step->connectionIds = malloc(graph->numConnections * sizeof(size_t));
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        step->connectionIds[connectionId] = connectionId;
+    }
+}
+
+static void free_step(FusionStep *step)
+{
+    free(step->actors);
+    free(step->connections);
+    free(step->connectionIds);
+}
+
+static CsdfGraph step_graph(const FusionStep *step)
+{
+    CsdfGraph graph = {
+        .numActors = step->numActors,
+        .actors = step->actors,
+        .numConnections = step->numConnections,
+        .connections = step->connections};
+    return graph;
+}
+
+static bool is_fusable(const FusionStep *step, size_t fusedConnectionId)
+{
+    const CsdfConnection *fusedConnection = step->connections + fusedConnectionId;
+    size_t firstId = fusedConnection->source.actorId;
+    size_t secondId = fusedConnection->destination.actorId;
+    if (firstId == secondId || fusedConnection->numTokens > 0 ||
+        step->actors[firstId].numOutputs != 1 || step->actors[secondId].numInputs != 1)
+    {
+        return false;
+    }
+    for (size_t connectionId = 0; connectionId < step->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = step->connections + connectionId;
+        if (connectionId != fusedConnectionId &&
+            (connection->source.actorId == firstId ||
+             (connection->source.actorId == secondId && connection->destination.actorId == firstId)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t remap_actor(size_t actorId, size_t firstId, size_t secondId)
+{
+    size_t fusedId = actorId == secondId ? firstId : actorId;
+    return fusedId > secondId ? fusedId - 1 : fusedId;
+}
+
+static void fuse_step(const FusionStep *step, size_t fusedConnectionId, CsdfFusedActor *fused, FusionStep *fusedStep)
+{
+    size_t firstId = step->connections[fusedConnectionId].source.actorId;
+    size_t secondId = step->connections[fusedConnectionId].destination.actorId;
+
+    fusedStep->numActors = step->numActors - 1;
+    fusedStep->actors = malloc(fusedStep->numActors * sizeof(CsdfActor));
+    for (size_t actorId = 0; actorId < step->numActors; actorId++)
+    {
+        if (actorId != secondId && actorId != firstId)
+        {
+            memcpy(fusedStep->actors + remap_actor(actorId, firstId, secondId), step->actors + actorId, sizeof(CsdfActor));
+        }
+    }
+    CsdfActor composite = {
+        .execution = NULL,
+        .numInputs = fused->first.numInputs,
+        .inputs = fused->inputs,
+        .numOutputs = fused->second.numOutputs,
+        .outputs = fused->outputs,
+        .contextExecution = fused_execute,
+        .context = fused,
+        .newRunContext = new_fused_run,
+        .deleteRunContext = delete_fused_run,
+        .stateless = false};
+    memcpy(fusedStep->actors + remap_actor(firstId, firstId, secondId), &composite, sizeof(CsdfActor));
+
+    fusedStep->numConnections = step->numConnections - 1;
+    fusedStep->connections = malloc(fusedStep->numConnections * sizeof(CsdfConnection));
+    fusedStep->connectionIds = malloc(fusedStep->numConnections * sizeof(size_t));
+    size_t fusedId = 0;
+    for (size_t connectionId = 0; connectionId < step->numConnections; connectionId++)
+    {
+        if (connectionId == fusedConnectionId)
+        {
+            continue;
+        }
+        const CsdfConnection *connection = step->connections + connectionId;
+        init_connection(
+            fusedStep->connections + fusedId, connection,
+            remap_actor(connection->source.actorId, firstId, secondId),
+            remap_actor(connection->destination.actorId, firstId, secondId));
+        fusedStep->connectionIds[fusedId++] = step->connectionIds[connectionId];
+    }
+}
+
+static bool completes_iteration(const FusionStep *step)
+{
+    CsdfGraph graph = step_graph(step);
+    unsigned *repetitionVector = malloc(step->numActors * sizeof(unsigned));
+    bool consistent = csdf_repetition_vector(&graph, repetitionVector);
+    CsdfSchedule *schedule = consistent ? new_sequential_schedule(&graph, repetitionVector) : NULL;
+    free(repetitionVector);
+    if (schedule == NULL)
+    {
+        return false;
+    }
+    delete_schedule(schedule);
+    return true;
+}
+
+static bool try_fusion(CsdfFusedGraph *fusedGraph, FusionStep *step, const unsigned *repetitionVector)
+{
+    for (size_t connectionId = 0; connectionId < step->numConnections; connectionId++)
+    {
+        if (!is_fusable(step, connectionId))
+        {
+            continue;
+        }
+        size_t firstId = step->connections[connectionId].source.actorId;
+        size_t secondId = step->connections[connectionId].destination.actorId;
+        unsigned divisor = gcd(repetitionVector[firstId], repetitionVector[secondId]);
+        unsigned numFirst = repetitionVector[firstId] / divisor;
+        unsigned numSecond = repetitionVector[secondId] / divisor;
+        CsdfFusedActor *fused = new_fused_actor(step->actors + firstId, step->actors + secondId, numFirst, numSecond);
+
+        FusionStep fusedStep;
+        fuse_step(step, connectionId, fused, &fusedStep);
+        if ((numFirst > 1 || numSecond > 1) && !completes_iteration(&fusedStep))
+        {
+            free_step(&fusedStep);
+            delete_fused_actor(fused);
+            continue;
+        }
+
+        fusedGraph->eliminatedConnections[fusedGraph->numEliminatedConnections++] = step->connectionIds[connectionId];
+        fusedGraph->fusedActors[fusedGraph->numFusedActors++] = fused;
+        for (size_t actorId = 0; actorId < fusedGraph->numOriginalActors; actorId++)
+        {
+            fusedGraph->actorIds[actorId] = remap_actor(fusedGraph->actorIds[actorId], firstId, secondId);
+        }
+        free_step(step);
+        *step = fusedStep;
+        return true;
+    }
+    return false;
+}
+
+CsdfFusedGraph *new_fused_graph(const CsdfGraph *graph)
+{
+    CsdfFusedGraph *fusedGraph = malloc(sizeof(CsdfFusedGraph));
+    fusedGraph->numOriginalActors = graph->numActors;
+    fusedGraph->actorIds = malloc(graph->numActors * sizeof(size_t));
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        fusedGraph->actorIds[actorId] = actorId;
+    }
+    fusedGraph->numEliminatedConnections = 0;
+    fusedGraph->eliminatedConnections = malloc(graph->numConnections * sizeof(size_t));
+    fusedGraph->numFusedActors = 0;
+    fusedGraph->fusedActors = malloc(graph->numActors * sizeof(CsdfFusedActor *));
+
+    FusionStep step;
+    init_step(&step, graph);
+    unsigned *repetitionVector = malloc(graph->numActors * sizeof(unsigned));
+    bool fusing = csdf_repetition_vector(graph, repetitionVector);
+    while (fusing)
+    {
+        fusing = try_fusion(fusedGraph, &step, repetitionVector);
+        CsdfGraph fused = step_graph(&step);
+        fusing = fusing && csdf_repetition_vector(&fused, repetitionVector);
+    }
+    free(repetitionVector);
+
+    CsdfGraph fused = step_graph(&step);
+    CsdfGraph *fusedCopy = malloc(sizeof(CsdfGraph));
+    memcpy(fusedCopy, &fused, sizeof(CsdfGraph));
+    fusedGraph->graph = fusedCopy;
+    fusedGraph->connectionIds = step.connectionIds;
+    return fusedGraph;
+}
+
+void delete_fused_graph(CsdfFusedGraph *fusedGraph)
+{
+    for (size_t fusedId = 0; fusedId < fusedGraph->numFusedActors; fusedId++)
+    {
+        delete_fused_actor(fusedGraph->fusedActors[fusedId]);
+    }
+    free((void *)fusedGraph->graph->actors);
+    free((void *)fusedGraph->graph->connections);
+    free((void *)fusedGraph->graph);
+    free(fusedGraph->connectionIds);
+    free(fusedGraph->eliminatedConnections);
+    free(fusedGraph->actorIds);
+    free(fusedGraph->fusedActors);
+    free(fusedGraph);
+}
@@ -0,0 +1,39 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_FUSION_H
+#define CSDF_FUSION_H
+
+#include "graph.h"
+
+typedef struct CsdfFusedActor CsdfFusedActor;
+
+// A graph in which chains of actors are fused into composite actors. An
+// actor with a single output feeding only the single input of the next actor
+// is fused with it when the connection holds no initial tokens. The
+// composite fires the first actor repetitionVector ratio times into a scratch
+// area of its actor run and then fires the second one on that scratch, so
+// concurrent runs of the fused graph are independent. Multirate
+// fusions are kept only when the fused graph still completes an iteration.
+typedef struct CsdfFusedGraph
+{
+    const CsdfGraph *graph;
+    size_t numOriginalActors;
+    size_t *actorIds;
+    size_t *connectionIds;
+    size_t numEliminatedConnections;
+    size_t *eliminatedConnections;
+    size_t numFusedActors;
+    CsdfFusedActor **fusedActors;
+} CsdfFusedGraph;
+
+CsdfFusedGraph *new_fused_graph(const CsdfGraph *graph);
+
+void delete_fused_graph(CsdfFusedGraph *fusedGraph);
+
+#endif // CSDF_FUSION_H
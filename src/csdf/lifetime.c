@@ -0,0 +1,160 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "lifetime.h"
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+static void init_lifetimes(const CsdfGraph *graph, CsdfBufferLifetime *lifetimes, size_t *numTokens, size_t numPhases)
+{
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        CsdfBufferLifetime *lifetime = lifetimes + connectionId;
+        numTokens[connectionId] = connection->numTokens;
+        lifetime->maxTokens = connection->numTokens;
+        lifetime->firstPhase = connection->numTokens > 0 ? 0 : numPhases;
+        lifetime->lastPhase = connection->numTokens > 0 ? numPhases - 1 : 0;
+    }
+}
+
+static void trace_firing(const CsdfGraph *graph, CsdfBufferLifetime *lifetimes, size_t *numTokens, size_t actorId, size_t firing)
+{
+    const CsdfActor *actor = graph->actors + actorId;
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        CsdfBufferLifetime *lifetime = lifetimes + connectionId;
+        if (connection->destination.actorId == actorId)
+        {
+            numTokens[connectionId] -= actor->inputs[connection->destination.inputId].consumption;
+            lifetime->lastPhase = lifetime->lastPhase > 2 * firing ? lifetime->lastPhase : 2 * firing;
+        }
+        if (connection->source.actorId == actorId)
+        {
+            numTokens[connectionId] += actor->outputs[connection->source.outputId].production;
+            lifetime->firstPhase = lifetime->firstPhase < 2 * firing + 1 ? lifetime->firstPhase : 2 * firing + 1;
+            if (numTokens[connectionId] > lifetime->maxTokens)
+            {
+                lifetime->maxTokens = numTokens[connectionId];
+            }
+        }
+    }
+}
+
+static bool overlaps(const CsdfBufferLifetime *first, const CsdfBufferLifetime *second)
+{
+    return first->firstPhase <= second->lastPhase && second->firstPhase <= first->lastPhase;
+}
+
+static size_t align_region(size_t size)
+{
+    size_t alignment = alignof(max_align_t);
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static void pack_regions(const CsdfGraph *graph, CsdfBufferPacking *packing)
+{
+    size_t numConnections = graph->numConnections;
+    size_t *bytes = malloc(numConnections * sizeof(size_t));
+    size_t *order = malloc(numConnections * sizeof(size_t));
+    for (size_t connectionId = 0; connectionId < numConnections; connectionId++)
+    {
+        bytes[connectionId] = packing->lifetimes[connectionId].maxTokens * graph->connections[connectionId].tokenSize;
+        packing->unpackedBytes += bytes[connectionId];
+        size_t position = connectionId;
+        while (position > 0 && bytes[order[position - 1]] < bytes[connectionId])
+        {
+            order[position] = order[position - 1];
+            position--;
+        }
+        order[position] = connectionId;
+    }
+
+    for (size_t orderId = 0; orderId < numConnections; orderId++)
+    {
+        size_t connectionId = order[orderId];
+        size_t regionId = 0;
+        for (; regionId < packing->numRegions; regionId++)
+        {
+            bool available = true;
+            for (size_t placedId = 0; placedId < orderId && available; placedId++)
+            {
+                size_t placedConnectionId = order[placedId];
+                available = packing->regionIds[placedConnectionId] != regionId ||
+                       !overlaps(packing->lifetimes + placedConnectionId, packing->lifetimes + connectionId);
+            }
+            if (available)
+            {
+                break;
+            }
+        }
+        if (regionId == packing->numRegions)
+        {
+            packing->regionSizes[packing->numRegions++] = 0;
+        }
+        packing->regionIds[connectionId] = regionId;
+        if (bytes[connectionId] > packing->regionSizes[regionId])
+        {
+            packing->regionSizes[regionId] = bytes[connectionId];
+        }
+    }
+
+    for (size_t regionId = 0; regionId < packing->numRegions; regionId++)
+    {
+        packing->regionOffsets[regionId] = packing->packedBytes;
+        packing->packedBytes += align_region(packing->regionSizes[regionId]);
+    }
+    free(order);
+    free(bytes);
+}
+
+CsdfBufferPacking *new_buffer_packing(const CsdfGraph *graph, const CsdfSchedule *schedule)
+{
+    size_t numPhases = 2 * schedule_num_firings(schedule);
+    CsdfBufferPacking *packing = malloc(sizeof(CsdfBufferPacking));
+    packing->numConnections = graph->numConnections;
+    packing->lifetimes = malloc(graph->numConnections * sizeof(CsdfBufferLifetime));
+    packing->regionIds = malloc(graph->numConnections * sizeof(size_t));
+    packing->numRegions = 0;
+    packing->regionSizes = malloc(graph->numConnections * sizeof(size_t));
+    packing->regionOffsets = malloc(graph->numConnections * sizeof(size_t));
+    packing->unpackedBytes = 0;
+    packing->packedBytes = 0;
+
+    size_t *numTokens = malloc(graph->numConnections * sizeof(size_t));
+    init_lifetimes(graph, packing->lifetimes, numTokens, numPhases);
+    size_t firing = 0;
+    for (size_t entryId = 0; entryId < schedule->numEntries; entryId++)
+    {
+        const CsdfScheduleEntry *entry = schedule->entries + entryId;
+        for (unsigned count = 0; count < entry->count; count++, firing++)
+        {
+            trace_firing(graph, packing->lifetimes, numTokens, entry->actorId, firing);
+        }
+    }
+    free(numTokens);
+
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        packing->lifetimes[connectionId].maxTokens++;
+    }
+    pack_regions(graph, packing);
+    return packing;
+}
+
+void delete_buffer_packing(CsdfBufferPacking *packing)
+{
+    free(packing->regionOffsets);
+    free(packing->regionSizes);
+    free(packing->regionIds);
+    free(packing->lifetimes);
+    free(packing);
+}
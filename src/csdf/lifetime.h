@@ -0,0 +1,46 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_LIFETIME_H
+#define CSDF_LIFETIME_H
+
+#include "graph.h"
+#include "schedule.h"
+
+// Live range of a connection over one iteration of a schedule, in phases
+// where firing n consumes in phase 2n and produces in phase 2n + 1.
+// Connections holding tokens between iterations are live in every phase.
+// maxTokens is the ring size the connection needs under the schedule.
+typedef struct CsdfBufferLifetime
+{
+    size_t firstPhase;
+    size_t lastPhase;
+    unsigned maxTokens;
+    char _pad[4];
+} CsdfBufferLifetime;
+
+// Connections packed into shared regions so that no two connections of a
+// region are ever live at once. Region offsets are relative to a single
+// allocation of packedBytes.
+typedef struct CsdfBufferPacking
+{
+    size_t numConnections;
+    CsdfBufferLifetime *lifetimes;
+    size_t *regionIds;
+    size_t numRegions;
+    size_t *regionSizes;
+    size_t *regionOffsets;
+    size_t unpackedBytes;
+    size_t packedBytes;
+} CsdfBufferPacking;
+
+CsdfBufferPacking *new_buffer_packing(const CsdfGraph *graph, const CsdfSchedule *schedule);
+
+void delete_buffer_packing(CsdfBufferPacking *packing);
+
+#endif // CSDF_LIFETIME_H
@@ -0,0 +1,292 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "partition.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define PARTITION_IMBALANCE_PERCENT 10
+#define NO_PART SIZE_MAX
+
+// Adjacency lists of the graph without self-loops and, per actor and part,
+// the traffic the actor exchanges with that part. Placing an actor only
+// updates the affinities of its neighbours, so gains are lookups.
+typedef struct CsdfPartitioning
+{
+    size_t numActors;
+    size_t numParts;
+    const uint64_t *actorCosts;
+    uint64_t bound;
+    uint64_t *loads;
+    size_t *actorParts;
+    size_t *firstNeighbours;
+    size_t *neighbours;
+    uint64_t *neighbourTraffic;
+    uint64_t *affinities;
+} CsdfPartitioning;
+
+static void init_adjacency(CsdfPartitioning *partitioning, const CsdfGraph *graph, const uint64_t *connectionTraffic)
+{
+    size_t *firstNeighbours = calloc(graph->numActors + 1, sizeof(size_t));
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        if (connection->source.actorId != connection->destination.actorId)
+        {
+            firstNeighbours[connection->source.actorId + 1]++;
+            firstNeighbours[connection->destination.actorId + 1]++;
+        }
+    }
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        firstNeighbours[actorId + 1] += firstNeighbours[actorId];
+    }
+    size_t numEntries = firstNeighbours[graph->numActors];
+    size_t *filled = malloc(graph->numActors * sizeof(size_t));
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        filled[actorId] = firstNeighbours[actorId];
+    }
+    partitioning->neighbours = malloc(numEntries * sizeof(size_t));
+    partitioning->neighbourTraffic = malloc(numEntries * sizeof(uint64_t));
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        size_t source = connection->source.actorId;
+        size_t destination = connection->destination.actorId;
+        if (source == destination)
+        {
+            continue;
+        }
+        partitioning->neighbours[filled[source]] = destination;
+        partitioning->neighbourTraffic[filled[source]++] = connectionTraffic[connectionId];
+        partitioning->neighbours[filled[destination]] = source;
+        partitioning->neighbourTraffic[filled[destination]++] = connectionTraffic[connectionId];
+    }
+    free(filled);
+    partitioning->firstNeighbours = firstNeighbours;
+}
+
+static uint64_t affinity(const CsdfPartitioning *partitioning, size_t actorId, size_t partId)
+{
+    return partitioning->affinities[actorId * partitioning->numParts + partId];
+}
+
+// Moves actorId into partId, or out of every part for NO_PART.
+static void assign_part(CsdfPartitioning *partitioning, size_t actorId, size_t partId)
+{
+    size_t previousPartId = partitioning->actorParts[actorId];
+    uint64_t cost = partitioning->actorCosts[actorId];
+    for (size_t entryId = partitioning->firstNeighbours[actorId]; entryId < partitioning->firstNeighbours[actorId + 1]; entryId++)
+    {
+        uint64_t *neighbourAffinities = partitioning->affinities + partitioning->neighbours[entryId] * partitioning->numParts;
+        if (previousPartId != NO_PART)
+        {
+            neighbourAffinities[previousPartId] -= partitioning->neighbourTraffic[entryId];
+        }
+        if (partId != NO_PART)
+        {
+            neighbourAffinities[partId] += partitioning->neighbourTraffic[entryId];
+        }
+    }
+    if (previousPartId != NO_PART)
+    {
+        partitioning->loads[previousPartId] -= cost;
+    }
+    if (partId != NO_PART)
+    {
+        partitioning->loads[partId] += cost;
+    }
+    partitioning->actorParts[actorId] = partId;
+}
+
+static uint64_t load_bound(const uint64_t *actorCosts, size_t numActors, size_t numParts)
+{
+    uint64_t totalCost = 0;
+    uint64_t maxCost = 0;
+    for (size_t actorId = 0; actorId < numActors; actorId++)
+    {
+        totalCost += actorCosts[actorId];
+        maxCost = actorCosts[actorId] > maxCost ? actorCosts[actorId] : maxCost;
+    }
+    uint64_t bound = (totalCost + numParts - 1) / numParts * (100 + PARTITION_IMBALANCE_PERCENT) / 100;
+    return bound > maxCost ? bound : maxCost;
+}
+
+static size_t *order_by_cost(const uint64_t *actorCosts, size_t numActors)
+{
+    size_t *order = malloc(numActors * sizeof(size_t));
+    for (size_t actorId = 0; actorId < numActors; actorId++)
+    {
+        size_t position = actorId;
+        while (position > 0 && actorCosts[order[position - 1]] < actorCosts[actorId])
+        {
+            order[position] = order[position - 1];
+            position--;
+        }
+        order[position] = actorId;
+    }
+    return order;
+}
+
+static void place_greedily(CsdfPartitioning *partitioning)
+{
+    const uint64_t *loads = partitioning->loads;
+    size_t *order = order_by_cost(partitioning->actorCosts, partitioning->numActors);
+    for (size_t orderId = 0; orderId < partitioning->numActors; orderId++)
+    {
+        size_t actorId = order[orderId];
+        uint64_t cost = partitioning->actorCosts[actorId];
+        size_t bestPartId = NO_PART;
+        uint64_t bestAffinity = 0;
+        size_t lightestPartId = 0;
+        for (size_t partId = 0; partId < partitioning->numParts; partId++)
+        {
+            lightestPartId = loads[partId] < loads[lightestPartId] ? partId : lightestPartId;
+            if (loads[partId] + cost > partitioning->bound)
+            {
+                continue;
+            }
+            uint64_t partAffinity = affinity(partitioning, actorId, partId);
+            if (bestPartId == NO_PART || partAffinity > bestAffinity ||
+                (partAffinity == bestAffinity && loads[partId] < loads[bestPartId]))
+            {
+                bestPartId = partId;
+                bestAffinity = partAffinity;
+            }
+        }
+        assign_part(partitioning, actorId, bestPartId != NO_PART ? bestPartId : lightestPartId);
+    }
+    free(order);
+}
+
+static int64_t move_gain(const CsdfPartitioning *partitioning, size_t actorId, size_t partId)
+{
+    return (int64_t)affinity(partitioning, actorId, partId) -
+           (int64_t)affinity(partitioning, actorId, partitioning->actorParts[actorId]);
+}
+
+// One Fiduccia-Mattheyses pass. Every actor moves at most once, always
+// taking the feasible move with the highest gain even when it is negative,
+// and the pass then rolls back to the prefix of moves with the best total.
+static bool refine_pass(CsdfPartitioning *partitioning)
+{
+    size_t numActors = partitioning->numActors;
+    const uint64_t *loads = partitioning->loads;
+    bool *locked = calloc(numActors, sizeof(bool));
+    size_t *movedActors = malloc(numActors * sizeof(size_t));
+    size_t *previousParts = malloc(numActors * sizeof(size_t));
+    size_t numMoves = 0;
+    size_t bestNumMoves = 0;
+    int64_t totalGain = 0;
+    int64_t bestTotalGain = 0;
+    while (numMoves < numActors)
+    {
+        size_t bestActorId = NO_PART;
+        size_t bestPartId = NO_PART;
+        int64_t bestGain = 0;
+        for (size_t actorId = 0; actorId < numActors; actorId++)
+        {
+            uint64_t cost = partitioning->actorCosts[actorId];
+            for (size_t partId = 0; partId < partitioning->numParts && !locked[actorId]; partId++)
+            {
+                if (partId == partitioning->actorParts[actorId] || loads[partId] + cost > partitioning->bound)
+                {
+                    continue;
+                }
+                int64_t gain = move_gain(partitioning, actorId, partId);
+                if (bestActorId == NO_PART || gain > bestGain ||
+                    (gain == bestGain && loads[partId] < loads[bestPartId]))
+                {
+                    bestActorId = actorId;
+                    bestPartId = partId;
+                    bestGain = gain;
+                }
+            }
+        }
+        if (bestActorId == NO_PART)
+        {
+            break;
+        }
+        previousParts[numMoves] = partitioning->actorParts[bestActorId];
+        movedActors[numMoves++] = bestActorId;
+        assign_part(partitioning, bestActorId, bestPartId);
+        locked[bestActorId] = true;
+        totalGain += bestGain;
+        if (totalGain > bestTotalGain)
+        {
+            bestTotalGain = totalGain;
+            bestNumMoves = numMoves;
+        }
+    }
+    while (numMoves > bestNumMoves)
+    {
+        numMoves--;
+        assign_part(partitioning, movedActors[numMoves], previousParts[numMoves]);
+    }
+    free(previousParts);
+    free(movedActors);
+    free(locked);
+    return bestTotalGain > 0;
+}
+
+void balanced_partition(
+    const CsdfGraph *graph, const uint64_t *actorCosts, const uint64_t *connectionTraffic,
+    size_t numParts, size_t *actorParts)
+{
+    CsdfPartitioning partitioning = {
+        .numActors = graph->numActors,
+        .numParts = numParts,
+        .actorCosts = actorCosts,
+        .bound = load_bound(actorCosts, graph->numActors, numParts),
+        .loads = calloc(numParts, sizeof(uint64_t)),
+        .actorParts = actorParts,
+        .affinities = calloc(graph->numActors * numParts, sizeof(uint64_t))};
+    init_adjacency(&partitioning, graph, connectionTraffic);
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        actorParts[actorId] = NO_PART;
+    }
+    place_greedily(&partitioning);
+    bool improved = true;
+    for (size_t pass = 0; pass < graph->numActors && improved; pass++)
+    {
+        improved = refine_pass(&partitioning);
+    }
+    free(partitioning.affinities);
+    free(partitioning.neighbourTraffic);
+    free(partitioning.neighbours);
+    free(partitioning.firstNeighbours);
+    free(partitioning.loads);
+}
+
+void connection_traffic(const CsdfGraph *graph, const unsigned *repetitionVector, uint64_t *connectionTraffic)
+{
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        size_t source = connection->source.actorId;
+        const CsdfOutput *output = graph->actors[source].outputs + connection->source.outputId;
+        connectionTraffic[connectionId] = (uint64_t)repetitionVector[source] * output->production * connection->tokenSize;
+    }
+}
+
+uint64_t partition_cut(const CsdfGraph *graph, const uint64_t *connectionTraffic, const size_t *actorParts)
+{
+    uint64_t cut = 0;
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        if (actorParts[connection->source.actorId] != actorParts[connection->destination.actorId])
+        {
+            cut += connectionTraffic[connectionId];
+        }
+    }
+    return cut;
+}
@@ -0,0 +1,31 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_PARTITION_H
+#define CSDF_PARTITION_H
+
+#include "graph.h"
+
+#include <stdint.h>
+
+// The bytes each connection carries per iteration.
+void connection_traffic(const CsdfGraph *graph, const unsigned *repetitionVector, uint64_t *connectionTraffic);
+
+// Splits the actors into numParts parts whose summed actorCosts stay close
+// to the mean while keeping the connectionTraffic between parts low. Actors
+// are placed by decreasing cost next to the actors they exchange the most
+// with. Fiduccia-Mattheyses passes then refine the split while they lower
+// the cut. actorParts can drive the self-timed, multi-process and cluster
+// executors directly.
+void balanced_partition(
+    const CsdfGraph *graph, const uint64_t *actorCosts, const uint64_t *connectionTraffic,
+    size_t numParts, size_t *actorParts);
+
+uint64_t partition_cut(const CsdfGraph *graph, const uint64_t *connectionTraffic, const size_t *actorParts);
+
+#endif // CSDF_PARTITION_H
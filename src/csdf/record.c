@@ -12,7 +12,65 @@ Copyright (c) 2023 Slaven Glumac
 #include <stdlib.h>
 #include <string.h>
 
-static void store_produced_tokens(const uint8_t *produced, CsdfRecordData *recordData)
+static size_t output_tokens_size(const CsdfOutput *output)
+{
+    return output->production * output->tokenSize;
+}
+
+size_t record_capacity(const CsdfRecordOption *option, size_t maxFireCount)
+{
+    switch (option->mode)
+    {
+    case CSDF_RECORD_FULL:
+        return maxFireCount;
+    case CSDF_RECORD_LAST:
+        return option->parameter < maxFireCount ? option->parameter : maxFireCount;
+    case CSDF_RECORD_EVERY:
+        return option->parameter > 0 ? (maxFireCount + option->parameter - 1) / option->parameter : 0;
+    default:
+        return 0;
+    }
+}
+
+size_t record_produced_bytes(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions, size_t *outputBytes)
+{
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        outputBytes[outputId] = record_capacity(outputOptions + outputId, maxFireCount) * output_tokens_size(actor->outputs + outputId);
+    }
+    return sizeof(CsdfRecordData) + actor->numOutputs * sizeof(CsdfOutputRecord);
+}
+
+static void store_output_tokens(CsdfOutputRecord *outputRecord, size_t executionId, const uint8_t *producedTokens, size_t outputTokensSize)
+{
+    if (outputRecord->capacity == 0)
+    {
+        return;
+    }
+    size_t slot;
+    switch (outputRecord->option.mode)
+    {
+    case CSDF_RECORD_FULL:
+        slot = executionId;
+        break;
+    case CSDF_RECORD_LAST:
+        slot = executionId % outputRecord->capacity;
+        break;
+    case CSDF_RECORD_EVERY:
+        if (executionId % outputRecord->option.parameter != 0)
+        {
+            return;
+        }
+        slot = executionId / outputRecord->option.parameter;
+        break;
+    default:
+        return;
+    }
+    memcpy(outputRecord->tokens + slot * outputTokensSize, producedTokens, outputTokensSize);
+    outputRecord->firingsStored++;
+}
+
+void record_produced_tokens(const uint8_t *produced, CsdfRecordData *recordData)
 {
     const uint8_t *producedTokens = produced;
     if (recordData->executionsRecorded >= recordData->maxFireCount)
@@ -22,51 +80,105 @@ static void store_produced_tokens(const uint8_t *produced, CsdfRecordData *recor
     const CsdfActor *actor = recordData->actor;
     for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
     {
-        const CsdfOutput *output = actor->outputs + outputId;
-        size_t outputTokensSize = output->production * output->tokenSize;
-        size_t resultsOffset = outputTokensSize * recordData->executionsRecorded;
-        uint8_t *recordedOutputResults = recordData->recordedResults[outputId] + resultsOffset;
-        memcpy(recordedOutputResults, producedTokens, outputTokensSize);
+        size_t outputTokensSize = output_tokens_size(actor->outputs + outputId);
+        store_output_tokens(recordData->outputRecords + outputId, recordData->executionsRecorded, producedTokens, outputTokensSize);
         producedTokens += outputTokensSize;
     }
     recordData->executionsRecorded++;
 }
 
-CsdfRecordData *new_record_produced(const CsdfActor *actor, size_t maxFireCount)
+CsdfRecordData *new_record_produced_in_storage(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions, uint8_t *const *outputTokens)
 {
     CsdfRecordData *recordData = malloc(sizeof(CsdfRecordData));
     recordData->actor = actor;
-    recordData->recordedResults = malloc(actor->numOutputs * sizeof(uint8_t *));
+    recordData->outputRecords = malloc(actor->numOutputs * sizeof(CsdfOutputRecord));
     recordData->executionsRecorded = 0;
     recordData->maxFireCount = maxFireCount;
 
     for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
     {
-        const CsdfOutput *output = actor->outputs + outputId;
-        recordData->recordedResults[outputId] = malloc(
-            maxFireCount * output->production * output->tokenSize);
+        CsdfOutputRecord *outputRecord = recordData->outputRecords + outputId;
+        outputRecord->option = outputOptions[outputId];
+        outputRecord->capacity = record_capacity(&outputRecord->option, maxFireCount);
+        outputRecord->tokens = outputTokens[outputId];
+        outputRecord->firingsStored = 0;
     }
 
-    recordData->on_token_produced = store_produced_tokens;
+    recordData->on_token_produced = record_produced_tokens;
+    recordData->on_record_deleted = NULL;
+    recordData->storage = NULL;
     return recordData;
 }
 
-void delete_record_produced(CsdfRecordData *recordData)
+static void free_recorded_tokens(CsdfRecordData *recordData)
 {
-    const CsdfActor *actor = recordData->actor;
+    for (size_t outputId = 0; outputId < recordData->actor->numOutputs; outputId++)
+    {
+        free(recordData->outputRecords[outputId].tokens);
+    }
+}
+
+CsdfRecordData *new_record_produced_with_options(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions)
+{
+    uint8_t **outputTokens = malloc(actor->numOutputs * sizeof(uint8_t *));
     for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
     {
-        free(recordData->recordedResults[outputId]);
+        size_t capacity = record_capacity(outputOptions + outputId, maxFireCount);
+        outputTokens[outputId] = capacity > 0
+                                     ? malloc(capacity * output_tokens_size(actor->outputs + outputId))
+                                     : NULL;
+    }
+    CsdfRecordData *recordData = new_record_produced_in_storage(actor, maxFireCount, outputOptions, outputTokens);
+    recordData->on_record_deleted = free_recorded_tokens;
+    free(outputTokens);
+    return recordData;
+}
+
+CsdfRecordData *new_record_produced(const CsdfActor *actor, size_t maxFireCount)
+{
+    CsdfRecordOption *outputOptions = malloc(actor->numOutputs * sizeof(CsdfRecordOption));
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        outputOptions[outputId].mode = CSDF_RECORD_FULL;
+        outputOptions[outputId].parameter = 0;
+    }
+    CsdfRecordData *recordData = new_record_produced_with_options(actor, maxFireCount, outputOptions);
+    free(outputOptions);
+    return recordData;
+}
+
+void delete_record_produced(CsdfRecordData *recordData)
+{
+    if (recordData->on_record_deleted != NULL)
+    {
+        recordData->on_record_deleted(recordData);
     }
 
-    free(recordData->recordedResults);
+    free(recordData->outputRecords);
     free(recordData);
 }
 
+void reset_record_produced(CsdfRecordData *recordData)
+{
+    for (size_t outputId = 0; outputId < recordData->actor->numOutputs; outputId++)
+    {
+        recordData->outputRecords[outputId].firingsStored = 0;
+    }
+    recordData->executionsRecorded = 0;
+}
+
+size_t recorded_firings(const CsdfRecordData *recordData, size_t outputId)
+{
+    const CsdfOutputRecord *outputRecord = recordData->outputRecords + outputId;
+    return outputRecord->firingsStored < outputRecord->capacity
+               ? outputRecord->firingsStored
+               : outputRecord->capacity;
+}
+
 void *new_record_storage(const CsdfRecordData *recordData, size_t outputId)
 {
     const CsdfOutput *output = recordData->actor->outputs + outputId;
-    size_t resultsSize = recordData->executionsRecorded * output->production * output->tokenSize;
+    size_t resultsSize = recorded_firings(recordData, outputId) * output_tokens_size(output);
     return malloc(resultsSize);
 }
 
@@ -75,12 +187,28 @@ void delete_record_storage(void *recordStorage)
     free(recordStorage);
 }
 
-void copy_recorded_tokens(const CsdfRecordData *recordData, size_t outputId, void *recordStorage)
+void recorded_tokens_view(const CsdfRecordData *recordData, size_t outputId, CsdfRecordView *view)
 {
+    const CsdfOutputRecord *outputRecord = recordData->outputRecords + outputId;
     const CsdfOutput *output = recordData->actor->outputs + outputId;
-    size_t resultsSize = recordData->executionsRecorded * output->production * output->tokenSize;
+    size_t numFirings = recorded_firings(recordData, outputId);
+    size_t oldestSlot = outputRecord->option.mode == CSDF_RECORD_LAST && outputRecord->capacity > 0
+                            ? outputRecord->firingsStored % outputRecord->capacity
+                            : 0;
+    view->tokenSize = output->tokenSize;
+    view->tokens = outputRecord->tokens + oldestSlot * output_tokens_size(output);
+    view->numTokens = (numFirings - oldestSlot) * output->production;
+    view->wrappedTokens = outputRecord->tokens;
+    view->numWrappedTokens = oldestSlot * output->production;
+}
+
+void copy_recorded_tokens(const CsdfRecordData *recordData, size_t outputId, void *recordStorage)
+{
+    CsdfRecordView view;
+    recorded_tokens_view(recordData, outputId, &view);
+    memcpy(recordStorage, view.tokens, view.numTokens * view.tokenSize);
     memcpy(
-        recordStorage,
-        recordData->recordedResults[outputId],
-        resultsSize);
+        (uint8_t *)recordStorage + view.numTokens * view.tokenSize,
+        view.wrappedTokens,
+        view.numWrappedTokens * view.tokenSize);
 }
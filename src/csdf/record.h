@@ -14,23 +14,87 @@ Copyright (c) 2023 Slaven Glumac
 #include <stdbool.h>
 #include <stdint.h>
 
+typedef enum CsdfRecordMode
+{
+    CSDF_RECORD_NONE,
+    CSDF_RECORD_FULL,
+    CSDF_RECORD_LAST,
+    CSDF_RECORD_EVERY
+} CsdfRecordMode;
+
+// The parameter is the number of kept firings for CSDF_RECORD_LAST and the
+// firing stride for CSDF_RECORD_EVERY, where 0 records nothing. It is
+// ignored by the other modes.
+typedef struct CsdfRecordOption
+{
+    CsdfRecordMode mode;
+    size_t parameter;
+} CsdfRecordOption;
+
+typedef struct CsdfRecordSelection
+{
+    const CsdfOutputId output;
+    const CsdfRecordOption option;
+} CsdfRecordSelection;
+
+typedef struct CsdfOutputRecord
+{
+    CsdfRecordOption option;
+    uint8_t *tokens;
+    size_t capacity;
+    size_t firingsStored;
+} CsdfOutputRecord;
+
+// Recorded tokens in firing order. Last-N records wrap around, so their
+// newest tokens continue in the wrapped part.
+typedef struct CsdfRecordView
+{
+    const uint8_t *tokens;
+    size_t numTokens;
+    const uint8_t *wrappedTokens;
+    size_t numWrappedTokens;
+    size_t tokenSize;
+} CsdfRecordView;
+
 typedef struct CsdfRecordData CsdfRecordData;
 
 typedef void (*CsdfOnTokenProduced)(const uint8_t *produced, CsdfRecordData *recordData);
 
+typedef void (*CsdfOnRecordDeleted)(CsdfRecordData *recordData);
+
 struct CsdfRecordData
 {
     const CsdfActor *actor;
-    uint8_t **recordedResults;
+    CsdfOutputRecord *outputRecords;
     CsdfOnTokenProduced on_token_produced;
+    CsdfOnRecordDeleted on_record_deleted;
+    void *storage;
     size_t maxFireCount;
     size_t executionsRecorded;
 };
 
 CsdfRecordData *new_record_produced(const CsdfActor *actor, size_t maxFireCount);
 
+CsdfRecordData *new_record_produced_with_options(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions);
+
+CsdfRecordData *new_record_produced_in_storage(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions, uint8_t *const *outputTokens);
+
 void delete_record_produced(CsdfRecordData *recordData);
 
+void reset_record_produced(CsdfRecordData *recordData);
+
+size_t record_capacity(const CsdfRecordOption *option, size_t maxFireCount);
+
+// The token bytes new_record_produced_with_options allocates for each
+// output, stored in outputBytes. Returns the bytes of the record itself.
+size_t record_produced_bytes(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions, size_t *outputBytes);
+
+void record_produced_tokens(const uint8_t *produced, CsdfRecordData *recordData);
+
+void recorded_tokens_view(const CsdfRecordData *recordData, size_t outputId, CsdfRecordView *view);
+
+size_t recorded_firings(const CsdfRecordData *recordData, size_t outputId);
+
 void *new_record_storage(const CsdfRecordData *recordData, size_t outputId);
 
 void delete_record_storage(void *recordStorage);
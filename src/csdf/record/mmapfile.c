@@ -0,0 +1,364 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include "mmapfile.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RECORD_FILE_MAGIC "CSDFREC1"
+#define RECORD_FILE_ALIGNMENT 4096u
+#define RECORD_FLUSH_CHUNK (4u << 20)
+
+typedef struct CsdfRecordFileColumn
+{
+    uint64_t tokenSize;
+    uint64_t production;
+    uint64_t mode;
+    uint64_t capacity;
+    uint64_t firingsStored;
+    uint64_t offset;
+} CsdfRecordFileColumn;
+
+typedef struct CsdfRecordFileHeader
+{
+    char magic[8];
+    uint64_t numOutputs;
+    uint64_t executionsRecorded;
+    CsdfRecordFileColumn columns[];
+} CsdfRecordFileHeader;
+
+struct CsdfRecordFile
+{
+    int fd;
+    uint8_t *mapping;
+    size_t mappingSize;
+    size_t *flushedBytes;
+    size_t *droppedBytes;
+    size_t firingBytes;
+    size_t unflushedBytes;
+};
+
+static size_t align_up(size_t size)
+{
+    return (size + RECORD_FILE_ALIGNMENT - 1) / RECORD_FILE_ALIGNMENT * RECORD_FILE_ALIGNMENT;
+}
+
+static size_t align_down(size_t size)
+{
+    return size / RECORD_FILE_ALIGNMENT * RECORD_FILE_ALIGNMENT;
+}
+
+static CsdfRecordFileHeader *file_header(const CsdfRecordFile *recordFile)
+{
+    return (CsdfRecordFileHeader *)recordFile->mapping;
+}
+
+static void update_header(CsdfRecordData *recordData)
+{
+    CsdfRecordFileHeader *header = file_header(recordData->storage);
+    for (size_t outputId = 0; outputId < recordData->actor->numOutputs; outputId++)
+    {
+        header->columns[outputId].firingsStored = recordData->outputRecords[outputId].firingsStored;
+    }
+    header->executionsRecorded = recordData->executionsRecorded;
+}
+
+// Only starts the write-back, so the firing thread never waits for the disk.
+static void start_write_back(const CsdfRecordFile *recordFile, size_t offset, size_t size)
+{
+#if defined(__linux__)
+    sync_file_range(recordFile->fd, (off_t)offset, (off_t)size, SYNC_FILE_RANGE_WRITE);
+#else
+    msync(recordFile->mapping + offset, size, MS_ASYNC);
+#endif
+}
+
+// Each chunk is flushed in two steps a chunk apart. Its write-back starts
+// once it is written and its pages are dropped at the next flush, by which
+// time they are mostly clean and dropping them costs no I/O.
+static void flush_written_columns(CsdfRecordData *recordData, bool final)
+{
+    CsdfRecordFile *recordFile = recordData->storage;
+    const CsdfRecordFileHeader *header = file_header(recordFile);
+    for (size_t outputId = 0; outputId < recordData->actor->numOutputs; outputId++)
+    {
+        const CsdfOutputRecord *outputRecord = recordData->outputRecords + outputId;
+        const CsdfRecordFileColumn *column = header->columns + outputId;
+        if (outputRecord->option.mode == CSDF_RECORD_LAST)
+        {
+            continue;
+        }
+        size_t writtenBytes = outputRecord->firingsStored * column->production * column->tokenSize;
+        if (writtenBytes < recordFile->flushedBytes[outputId])
+        {
+            recordFile->flushedBytes[outputId] = 0;
+            recordFile->droppedBytes[outputId] = 0;
+        }
+        size_t flushEnd = final ? align_up(writtenBytes) : align_down(writtenBytes);
+        if (flushEnd >= recordFile->flushedBytes[outputId] + (final ? 1 : RECORD_FLUSH_CHUNK))
+        {
+            size_t flushStart = recordFile->flushedBytes[outputId];
+            size_t dropStart = recordFile->droppedBytes[outputId];
+            if (!final && flushStart > dropStart)
+            {
+                madvise(recordFile->mapping + column->offset + dropStart, flushStart - dropStart, MADV_DONTNEED);
+                recordFile->droppedBytes[outputId] = flushStart;
+            }
+            start_write_back(recordFile, column->offset + flushStart, flushEnd - flushStart);
+            recordFile->flushedBytes[outputId] = flushEnd;
+        }
+    }
+}
+
+// Columns are only looked at once a chunk may have been written since the
+// last look, so most firings skip the flush bookkeeping. The header then
+// counts the firings so far, so the file of a crashed run stays readable.
+static void record_into_file(const uint8_t *produced, CsdfRecordData *recordData)
+{
+    record_produced_tokens(produced, recordData);
+    CsdfRecordFile *recordFile = recordData->storage;
+    recordFile->unflushedBytes += recordFile->firingBytes;
+    if (recordFile->unflushedBytes >= RECORD_FLUSH_CHUNK)
+    {
+        recordFile->unflushedBytes = 0;
+        update_header(recordData);
+        flush_written_columns(recordData, false);
+    }
+}
+
+static void close_written_file(CsdfRecordData *recordData)
+{
+    CsdfRecordFile *recordFile = recordData->storage;
+    update_header(recordData);
+    flush_written_columns(recordData, true);
+    msync(recordFile->mapping, recordFile->mappingSize, MS_SYNC);
+    free(recordFile->flushedBytes);
+    free(recordFile->droppedBytes);
+    recordFile->flushedBytes = NULL;
+    recordFile->droppedBytes = NULL;
+    close_record_file(recordFile);
+}
+
+static CsdfRecordFile *map_record_file(int fd, size_t mappingSize, int protection)
+{
+    void *mapping = mmap(NULL, mappingSize, protection, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    CsdfRecordFile *recordFile = malloc(sizeof(CsdfRecordFile));
+    recordFile->fd = fd;
+    recordFile->mapping = mapping;
+    recordFile->mappingSize = mappingSize;
+    recordFile->flushedBytes = NULL;
+    recordFile->droppedBytes = NULL;
+    recordFile->firingBytes = 0;
+    recordFile->unflushedBytes = 0;
+    return recordFile;
+}
+
+CsdfRecordData *new_mmap_record_produced(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions, const char *path)
+{
+    size_t headerSize = sizeof(CsdfRecordFileHeader) + actor->numOutputs * sizeof(CsdfRecordFileColumn);
+    size_t *columnOffsets = malloc(actor->numOutputs * sizeof(size_t));
+    size_t fileSize = align_up(headerSize);
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        const CsdfOutput *output = actor->outputs + outputId;
+        columnOffsets[outputId] = fileSize;
+        fileSize += align_up(record_capacity(outputOptions + outputId, maxFireCount) * output->production * output->tokenSize);
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)fileSize) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        free(columnOffsets);
+        return NULL;
+    }
+    CsdfRecordFile *recordFile = map_record_file(fd, fileSize, PROT_READ | PROT_WRITE);
+    if (recordFile == NULL)
+    {
+        free(columnOffsets);
+        return NULL;
+    }
+    recordFile->flushedBytes = calloc(actor->numOutputs, sizeof(size_t));
+    recordFile->droppedBytes = calloc(actor->numOutputs, sizeof(size_t));
+
+    CsdfRecordFileHeader *header = file_header(recordFile);
+    memcpy(header->magic, RECORD_FILE_MAGIC, sizeof(header->magic));
+    header->numOutputs = actor->numOutputs;
+    header->executionsRecorded = 0;
+    uint8_t **outputTokens = malloc(actor->numOutputs * sizeof(uint8_t *));
+    for (size_t outputId = 0; outputId < actor->numOutputs; outputId++)
+    {
+        const CsdfOutput *output = actor->outputs + outputId;
+        CsdfRecordFileColumn *column = header->columns + outputId;
+        column->tokenSize = output->tokenSize;
+        column->production = output->production;
+        column->mode = outputOptions[outputId].mode;
+        column->capacity = record_capacity(outputOptions + outputId, maxFireCount);
+        column->firingsStored = 0;
+        column->offset = columnOffsets[outputId];
+        outputTokens[outputId] = recordFile->mapping + column->offset;
+        if (column->mode != CSDF_RECORD_LAST)
+        {
+            recordFile->firingBytes += output->production * output->tokenSize;
+        }
+    }
+    free(columnOffsets);
+
+    CsdfRecordData *recordData = new_record_produced_in_storage(actor, maxFireCount, outputOptions, outputTokens);
+    free(outputTokens);
+    recordData->storage = recordFile;
+    recordData->on_token_produced = record_into_file;
+    recordData->on_record_deleted = close_written_file;
+    return recordData;
+}
+
+CsdfRecordFile *open_record_file(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(CsdfRecordFileHeader))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return NULL;
+    }
+    CsdfRecordFile *recordFile = map_record_file(fd, (size_t)fileStat.st_size, PROT_READ);
+    size_t maxOutputs = ((size_t)fileStat.st_size - sizeof(CsdfRecordFileHeader)) / sizeof(CsdfRecordFileColumn);
+    if (recordFile != NULL &&
+        (memcmp(file_header(recordFile)->magic, RECORD_FILE_MAGIC, 8) != 0 || file_header(recordFile)->numOutputs > maxOutputs))
+    {
+        close_record_file(recordFile);
+        return NULL;
+    }
+    return recordFile;
+}
+
+void close_record_file(CsdfRecordFile *recordFile)
+{
+    munmap(recordFile->mapping, recordFile->mappingSize);
+    close(recordFile->fd);
+    free(recordFile->flushedBytes);
+    free(recordFile->droppedBytes);
+    free(recordFile);
+}
+
+size_t record_file_num_outputs(const CsdfRecordFile *recordFile)
+{
+    return file_header(recordFile)->numOutputs;
+}
+
+size_t record_file_executions(const CsdfRecordFile *recordFile)
+{
+    return file_header(recordFile)->executionsRecorded;
+}
+
+// Whether the column's capacity lies within the mapping.
+static bool column_fits(const CsdfRecordFileColumn *column, size_t mappingSize)
+{
+    if (column->offset > mappingSize)
+    {
+        return false;
+    }
+    uint64_t availableBytes = mappingSize - column->offset;
+    if (column->tokenSize == 0 || column->production == 0)
+    {
+        return true;
+    }
+    if (column->production > availableBytes / column->tokenSize)
+    {
+        return column->capacity == 0;
+    }
+    return column->capacity <= availableBytes / (column->production * column->tokenSize);
+}
+
+bool record_file_view(const CsdfRecordFile *recordFile, size_t outputId, CsdfRecordView *view)
+{
+    const CsdfRecordFileHeader *header = file_header(recordFile);
+    if (outputId >= header->numOutputs || !column_fits(header->columns + outputId, recordFile->mappingSize))
+    {
+        return false;
+    }
+    const CsdfRecordFileColumn *column = header->columns + outputId;
+    size_t numFirings = column->firingsStored < column->capacity ? column->firingsStored : column->capacity;
+    size_t oldestSlot = column->mode == CSDF_RECORD_LAST && column->capacity > 0
+                            ? column->firingsStored % column->capacity
+                            : 0;
+    const uint8_t *columnTokens = recordFile->mapping + column->offset;
+    view->tokenSize = column->tokenSize;
+    view->tokens = columnTokens + oldestSlot * column->production * column->tokenSize;
+    view->numTokens = (numFirings - oldestSlot) * column->production;
+    view->wrappedTokens = columnTokens;
+    view->numWrappedTokens = oldestSlot * column->production;
+    return true;
+}
+
+#else
+
+CsdfRecordData *new_mmap_record_produced(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions, const char *path)
+{
+    (void)actor;
+    (void)maxFireCount;
+    (void)outputOptions;
+    (void)path;
+    return NULL;
+}
+
+CsdfRecordFile *open_record_file(const char *path)
+{
+    (void)path;
+    return NULL;
+}
+
+void close_record_file(CsdfRecordFile *recordFile)
+{
+    (void)recordFile;
+}
+
+size_t record_file_num_outputs(const CsdfRecordFile *recordFile)
+{
+    (void)recordFile;
+    return 0;
+}
+
+size_t record_file_executions(const CsdfRecordFile *recordFile)
+{
+    (void)recordFile;
+    return 0;
+}
+
+bool record_file_view(const CsdfRecordFile *recordFile, size_t outputId, CsdfRecordView *view)
+{
+    (void)recordFile;
+    (void)outputId;
+    (void)view;
+    return false;
+}
+
+#endif
@@ -0,0 +1,35 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_RECORD_MMAPFILE_H
+#define CSDF_RECORD_MMAPFILE_H
+
+#include <csdf/record.h>
+
+// Records stream into a memory-mapped file with one column per output port.
+// Written columns are handed to the kernel for write-back in large chunks
+// and dropped from the process, so a recording can exceed the RAM size.
+// The header counts the recorded firings as of the last chunk, so files
+// of runs that crash can be read up to there.
+// Returns NULL when the file cannot be created.
+CsdfRecordData *new_mmap_record_produced(const CsdfActor *actor, size_t maxFireCount, const CsdfRecordOption *outputOptions, const char *path);
+
+typedef struct CsdfRecordFile CsdfRecordFile;
+
+CsdfRecordFile *open_record_file(const char *path);
+
+void close_record_file(CsdfRecordFile *recordFile);
+
+size_t record_file_num_outputs(const CsdfRecordFile *recordFile);
+
+size_t record_file_executions(const CsdfRecordFile *recordFile);
+
+// Returns false for unknown outputs and columns that exceed the file.
+bool record_file_view(const CsdfRecordFile *recordFile, size_t outputId, CsdfRecordView *view);
+
+#endif // CSDF_RECORD_MMAPFILE_H
@@ -0,0 +1,159 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "schedule.h"
+#include "partition.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static bool has_tokens(const CsdfGraph *graph, const size_t *numTokens, size_t actorId)
+{
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        if (connection->destination.actorId == actorId)
+        {
+            const CsdfInput *input = graph->actors[actorId].inputs + connection->destination.inputId;
+            if (numTokens[connectionId] < input->consumption)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void fire_tokens(const CsdfGraph *graph, size_t *numTokens, size_t actorId)
+{
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        const CsdfConnection *connection = graph->connections + connectionId;
+        if (connection->destination.actorId == actorId)
+        {
+            numTokens[connectionId] -= graph->actors[actorId].inputs[connection->destination.inputId].consumption;
+        }
+        if (connection->source.actorId == actorId)
+        {
+            numTokens[connectionId] += graph->actors[actorId].outputs[connection->source.outputId].production;
+        }
+    }
+}
+
+static void append_firing(CsdfSchedule *schedule, size_t actorId, size_t *capacity)
+{
+    if (schedule->numEntries > 0 && schedule->entries[schedule->numEntries - 1].actorId == actorId)
+    {
+        schedule->entries[schedule->numEntries - 1].count++;
+        return;
+    }
+    if (schedule->numEntries == *capacity)
+    {
+        *capacity = 2 * *capacity + 1;
+        schedule->entries = realloc(schedule->entries, *capacity * sizeof(CsdfScheduleEntry));
+    }
+    CsdfScheduleEntry *entry = schedule->entries + schedule->numEntries++;
+    entry->actorId = actorId;
+    entry->count = 1;
+}
+
+// With runLength, an actor that fired keeps firing while it can before the
+// search starts over from the first actor.
+static CsdfSchedule *new_schedule(const CsdfGraph *graph, const unsigned *repetitionVector, unsigned blockingFactor, bool runLength)
+{
+    CsdfSchedule *schedule = malloc(sizeof(CsdfSchedule));
+    schedule->numEntries = 0;
+    schedule->entries = NULL;
+    size_t capacity = 0;
+
+    size_t *numTokens = malloc(graph->numConnections * sizeof(size_t));
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        numTokens[connectionId] = graph->connections[connectionId].numTokens;
+    }
+    unsigned *remainingFirings = malloc(graph->numActors * sizeof(unsigned));
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        remainingFirings[actorId] = blockingFactor * repetitionVector[actorId];
+    }
+
+    bool blocked = false;
+    while (!blocked)
+    {
+        blocked = true;
+        for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+        {
+            if (remainingFirings[actorId] > 0 && has_tokens(graph, numTokens, actorId))
+            {
+                do
+                {
+                    fire_tokens(graph, numTokens, actorId);
+                    append_firing(schedule, actorId, &capacity);
+                    remainingFirings[actorId]--;
+                } while (runLength && remainingFirings[actorId] > 0 && has_tokens(graph, numTokens, actorId));
+                blocked = false;
+                break;
+            }
+        }
+    }
+
+    bool completed = true;
+    for (size_t actorId = 0; actorId < graph->numActors; actorId++)
+    {
+        completed = completed && remainingFirings[actorId] == 0;
+    }
+    free(remainingFirings);
+    free(numTokens);
+    if (!completed)
+    {
+        delete_schedule(schedule);
+        return NULL;
+    }
+    return schedule;
+}
+
+CsdfSchedule *new_sequential_schedule(const CsdfGraph *graph, const unsigned *repetitionVector)
+{
+    return new_schedule(graph, repetitionVector, 1, false);
+}
+
+CsdfSchedule *new_blocked_schedule(const CsdfGraph *graph, const unsigned *repetitionVector, unsigned blockingFactor)
+{
+    return new_schedule(graph, repetitionVector, blockingFactor, true);
+}
+
+unsigned choose_blocking_factor(const CsdfGraph *graph, const unsigned *repetitionVector, size_t cacheBytes)
+{
+    uint64_t *connectionTraffic = malloc(graph->numConnections * sizeof(uint64_t));
+    connection_traffic(graph, repetitionVector, connectionTraffic);
+    size_t iterationBytes = 0;
+    for (size_t connectionId = 0; connectionId < graph->numConnections; connectionId++)
+    {
+        iterationBytes += (size_t)connectionTraffic[connectionId];
+    }
+    free(connectionTraffic);
+    size_t blockingFactor = iterationBytes > 0 ? cacheBytes / iterationBytes : CSDF_MAX_BLOCKING_FACTOR;
+    blockingFactor = blockingFactor < 1 ? 1 : blockingFactor;
+    return blockingFactor > CSDF_MAX_BLOCKING_FACTOR ? CSDF_MAX_BLOCKING_FACTOR : (unsigned)blockingFactor;
+}
+
+void delete_schedule(CsdfSchedule *schedule)
+{
+    free(schedule->entries);
+    free(schedule);
+}
+
+size_t schedule_num_firings(const CsdfSchedule *schedule)
+{
+    size_t numFirings = 0;
+    for (size_t entryId = 0; entryId < schedule->numEntries; entryId++)
+    {
+        numFirings += schedule->entries[entryId].count;
+    }
+    return numFirings;
+}
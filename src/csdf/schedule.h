@@ -0,0 +1,47 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef CSDF_SCHEDULE_H
+#define CSDF_SCHEDULE_H
+
+#include "graph.h"
+
+#include <stdbool.h>
+
+typedef struct CsdfScheduleEntry
+{
+    size_t actorId;
+    unsigned count;
+    char _pad[4];
+} CsdfScheduleEntry;
+
+// One iteration of firings, where each entry fires an actor count times in
+// a row. The order is the one sequential_run follows.
+typedef struct CsdfSchedule
+{
+    size_t numEntries;
+    CsdfScheduleEntry *entries;
+} CsdfSchedule;
+
+#define CSDF_MAX_BLOCKING_FACTOR 1024u
+
+CsdfSchedule *new_sequential_schedule(const CsdfGraph *graph, const unsigned *repetitionVector);
+
+// blockingFactor iterations scheduled as one unit. An actor that fires keeps
+// firing while it has tokens, so its firings in the block run back to back.
+CsdfSchedule *new_blocked_schedule(const CsdfGraph *graph, const unsigned *repetitionVector, unsigned blockingFactor);
+
+// The largest blocking factor, up to CSDF_MAX_BLOCKING_FACTOR, for which the
+// tokens produced in one block fit in cacheBytes. At least 1.
+unsigned choose_blocking_factor(const CsdfGraph *graph, const unsigned *repetitionVector, size_t cacheBytes);
+
+void delete_schedule(CsdfSchedule *schedule);
+
+size_t schedule_num_firings(const CsdfSchedule *schedule);
+
+#endif // CSDF_SCHEDULE_H
@@ -0,0 +1,62 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "open.h"
+
+static void double_execute(const void *consumed, void *produced)
+{
+    const double *u = consumed;
+    double *y = produced;
+    *y = *u * 2;
+}
+
+static void pair_sum_execute(const void *consumed, void *produced)
+{
+    const double *u = consumed;
+    double *y = produced;
+    *y = u[0] + u[1];
+}
+
+static CsdfInput singleInput[] = {CSDF_INPUT(double, 1)};
+
+static CsdfInput pairInput[] = {CSDF_INPUT(double, 2)};
+
+static CsdfOutput singleOutput[] = {CSDF_OUTPUT(double, 1)};
+
+#define DOUBLE_GAIN                  \
+    {                                \
+        .execution = double_execute, \
+        .numInputs = 1,              \
+        .inputs = singleInput,       \
+        .numOutputs = 1,             \
+        .outputs = singleOutput      \
+    }
+
+#define PAIR_SUM                       \
+    {                                  \
+        .execution = pair_sum_execute, \
+        .numInputs = 1,                \
+        .inputs = pairInput,           \
+        .numOutputs = 1,               \
+        .outputs = singleOutput        \
+    }
+
+static CsdfActor ACTORS[2] = {DOUBLE_GAIN, PAIR_SUM};
+
+static CsdfConnection connections[] = {
+    {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 1, .inputId = 0}, .tokenSize = sizeof(double), .numTokens = 0, .initialTokens = NULL}};
+
+const CsdfGraph OPEN_GRAPH = {
+    .actors = ACTORS,
+    .numActors = 2,
+    .connections = connections,
+    .numConnections = 1};
+
+const CsdfInputId OPEN_GRAPH_INPUT = {.actorId = 0, .inputId = 0};
+
+const CsdfOutputId OPEN_GRAPH_OUTPUT = {.actorId = 1, .outputId = 0};
@@ -0,0 +1,20 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef OPEN_H
+#define OPEN_H
+
+#include <csdf/graph.h>
+
+extern const CsdfGraph OPEN_GRAPH;
+
+extern const CsdfInputId OPEN_GRAPH_INPUT;
+
+extern const CsdfOutputId OPEN_GRAPH_OUTPUT;
+
+#endif // OPEN_H
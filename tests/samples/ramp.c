@@ -0,0 +1,115 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#include "ramp.h"
+
+static void ramp_execute(const void *consumed, void *produced)
+{
+    const long *previous = consumed;
+    long *next = produced;
+    next[0] = *previous + 1;
+    next[1] = *previous;
+}
+
+static void square_sum_execute(const void *consumed, void *produced)
+{
+    const long *u = consumed;
+    long *y = produced;
+    *y = u[0] * u[0] + u[1] * u[1];
+}
+
+static void triplicate_execute(const void *consumed, void *produced)
+{
+    const long *u = consumed;
+    long *y = produced;
+    y[0] = y[1] = y[2] = *u;
+}
+
+static CsdfInput rampInputs[] = {CSDF_INPUT(long, 1)};
+
+static CsdfOutput rampOutputs[] = {CSDF_OUTPUT(long, 1), CSDF_OUTPUT(long, 1)};
+
+static CsdfInput squareSumInputs[] = {CSDF_INPUT(long, 2)};
+
+static CsdfOutput squareSumOutputs[] = {CSDF_OUTPUT(long, 1)};
+
+static CsdfInput triplicateInputs[] = {CSDF_INPUT(long, 1)};
+
+static CsdfOutput triplicateOutputs[] = {CSDF_OUTPUT(long, 3)};
+
+#define RAMP                       \
+    {                              \
+        .execution = ramp_execute, \
+        .numInputs = 1,            \
+        .inputs = rampInputs,      \
+        .numOutputs = 2,           \
+        .outputs = rampOutputs     \
+    }
+
+#define SQUARE_SUM                       \
+    {                                    \
+        .execution = square_sum_execute, \
+        .numInputs = 1,                  \
+        .inputs = squareSumInputs,       \
+        .numOutputs = 1,                 \
+        .outputs = squareSumOutputs,     \
+        .stateless = true                \
+    }
+
+#define TRIPLICATE                       \
+    {                                    \
+        .execution = triplicate_execute, \
+        .numInputs = 1,                  \
+        .inputs = triplicateInputs,      \
+        .numOutputs = 1,                 \
+        .outputs = triplicateOutputs     \
+    }
+
+static CsdfActor ACTORS[2] = {RAMP, SQUARE_SUM};
+
+static CsdfActor CHAIN_ACTORS[3] = {RAMP, TRIPLICATE, SQUARE_SUM};
+
+static CsdfActor FANOUT_ACTORS[3] = {RAMP, SQUARE_SUM, SQUARE_SUM};
+
+static long rampStart[] = {0};
+
+static CsdfConnection connections[] = {
+    {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 0, .inputId = 0}, .tokenSize = sizeof(long), .numTokens = 1, .initialTokens = rampStart},
+    {.source = {.actorId = 0, .outputId = 1}, .destination = {.actorId = 1, .inputId = 0}, .tokenSize = sizeof(long), .numTokens = 0, .initialTokens = NULL}};
+
+const CsdfGraph RAMP_GRAPH = {
+    .actors = ACTORS,
+    .numActors = 2,
+    .connections = connections,
+    .numConnections = 2};
+
+static long chainRampStart[] = {0};
+
+static CsdfConnection chainConnections[] = {
+    {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 0, .inputId = 0}, .tokenSize = sizeof(long), .numTokens = 1, .initialTokens = chainRampStart},
+    {.source = {.actorId = 0, .outputId = 1}, .destination = {.actorId = 1, .inputId = 0}, .tokenSize = sizeof(long), .numTokens = 0, .initialTokens = NULL},
+    {.source = {.actorId = 1, .outputId = 0}, .destination = {.actorId = 2, .inputId = 0}, .tokenSize = sizeof(long), .numTokens = 0, .initialTokens = NULL}};
+
+const CsdfGraph RAMP_CHAIN_GRAPH = {
+    .actors = CHAIN_ACTORS,
+    .numActors = 3,
+    .connections = chainConnections,
+    .numConnections = 3};
+
+static long fanoutRampStart[] = {0};
+
+static CsdfConnection fanoutConnections[] = {
+    {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 0, .inputId = 0}, .tokenSize = sizeof(long), .numTokens = 1, .initialTokens = fanoutRampStart},
+    {.source = {.actorId = 0, .outputId = 1}, .destination = {.actorId = 1, .inputId = 0}, .tokenSize = sizeof(long), .numTokens = 0, .initialTokens = NULL},
+    {.source = {.actorId = 0, .outputId = 1}, .destination = {.actorId = 2, .inputId = 0}, .tokenSize = sizeof(long), .numTokens = 0, .initialTokens = NULL}};
+
+const CsdfGraph RAMP_FANOUT_GRAPH = {
+    .actors = FANOUT_ACTORS,
+    .numActors = 3,
+    .connections = fanoutConnections,
+    .numConnections = 3};
@@ -0,0 +1,20 @@
+/****************************************************************************
+C implementation of Synchronous Data Flow (CSDF)
+
+MIT License
+
+Copyright (c) 2023 Slaven Glumac
+****************************************************************************/
+
+#ifndef RAMP_H
+#define RAMP_H
+
+#include <csdf/graph.h>
+
+extern const CsdfGraph RAMP_GRAPH;
+
+extern const CsdfGraph RAMP_CHAIN_GRAPH;
+
+extern const CsdfGraph RAMP_FANOUT_GRAPH;
+
+#endif // RAMP_H
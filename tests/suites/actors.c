@@ -10,6 +10,11 @@ Copyright (c) 2023 Slaven Glumac
 
 #include <samples/simple.h>
 
+#include <csdf/actors/file.h>
+#include <csdf/execution/sequential.h>
+
+#include <stdio.h>
+
 void test_const(YacuTestRun *testRun)
 {
     const CsdfActor *threeConst = &SIMPLE_GRAPH.actors[0];
@@ -50,8 +55,50 @@ void test_sink(YacuTestRun *testRun)
     YACU_ASSERT_EQ_UINT(testRun, doubleGain->numOutputs, 0);
 }
 
+void test_file_source_sink(YacuTestRun *testRun)
+{
+    FILE *capture = fopen("capture.bin", "wb");
+    for (int tokenId = 0; tokenId < 10; tokenId++)
+    {
+        fwrite(&tokenId, sizeof(int), 1, capture);
+    }
+    fclose(capture);
+    remove("replay.bin");
+
+    CsdfFileSource *source = new_file_source("capture.bin", sizeof(int), 2, true);
+    CsdfFileSink *sink = new_file_sink("replay.bin", sizeof(int), 3, 16);
+    YACU_ASSERT_TRUE(testRun, source != NULL);
+    YACU_ASSERT_TRUE(testRun, sink != NULL);
+    YACU_ASSERT_EQ_UINT(testRun, file_source_num_tokens(source), 10);
+    YACU_ASSERT_TRUE(testRun, new_file_source("capture.bin", 0, 2, true) == NULL);
+    YACU_ASSERT_TRUE(testRun, new_file_sink("replay.bin", 0, 3, 16) == NULL);
+
+    CsdfActor actors[] = {source->actor, sink->actor};
+    CsdfConnection connections[] = {
+        {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 1, .inputId = 0}, .tokenSize = sizeof(int), .numTokens = 0, .initialTokens = NULL}};
+    CsdfGraph replay = {.numActors = 2, .actors = actors, .numConnections = 1, .connections = connections};
+    CsdfGraphRun *runData = new_graph_run(&replay, 5);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    delete_graph_run(runData);
+    delete_file_source(source);
+    YACU_ASSERT_TRUE(testRun, delete_file_sink(sink));
+
+    int replayed[30];
+    FILE *replayFile = fopen("replay.bin", "rb");
+    size_t numReplayed = fread(replayed, sizeof(int), 30, replayFile);
+    fclose(replayFile);
+    YACU_ASSERT_EQ_UINT(testRun, numReplayed, 30);
+    for (size_t tokenId = 0; tokenId < 30; tokenId++)
+    {
+        YACU_ASSERT_EQ_INT(testRun, replayed[tokenId], tokenId % 10);
+    }
+    remove("capture.bin");
+    remove("replay.bin");
+}
+
 YacuTest actorsTests[] = {
     {"ConstTest", &test_const},
     {"GainTest", &test_gain},
     {"SinkTest", &test_sink},
+    {"FileSourceSinkTest", &test_file_source_sink},
     END_OF_TESTS};
@@ -10,10 +10,40 @@ Copyright (c) 2023 Slaven Glumac
 
 #include <samples/simple.h>
 #include <samples/larger.h>
+#include <samples/open.h>
+#include <samples/ramp.h>
+#include <csdf/fusion.h>
+#include <csdf/actors/composite.h>
+#include <csdf/actors/file.h>
 #include <csdf/execution/sequential.h>
 #include <csdf/execution/parallel.h>
+#include <csdf/execution/placement.h>
+#include <csdf/execution/selftimed.h>
+#include <csdf/execution/profile.h>
+#include <csdf/execution/stream.h>
+#include <csdf/execution/pool.h>
+#include <csdf/execution/batch.h>
+#include <csdf/execution/multiprocess.h>
+#include <csdf/execution/cluster.h>
+#include <csdf/execution/edf.h>
+#include <csdf/execution/buffer/plain.h>
+#include <csdf/execution/buffer/stdlockfree.h>
+#include <csdf/execution/buffer/shm.h>
+#include <csdf/execution/buffer/tokenpool.h>
+#include <csdf/record/mmapfile.h>
 #include <pthread4csdf.h>
 
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 void test_simple_sequential_iteration(YacuTestRun *testRun)
 {
     CsdfGraphRun *runData = new_graph_run(&SIMPLE_GRAPH, 1);
@@ -155,16 +185,1130 @@ void test_larger_produced_record(YacuTestRun *testRun)
     delete_graph_run(runData);
 }
 
+void test_simple_selected_record(YacuTestRun *testRun)
+{
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 0, .outputId = 0}, .option = {.mode = CSDF_RECORD_LAST, .parameter = 3}},
+        {.output = {.actorId = 1, .outputId = 0}, .option = {.mode = CSDF_RECORD_EVERY, .parameter = 10}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 2, .recordSelections = recordSelections};
+    CsdfGraphRun *runData = new_graph_run_with_options(&SIMPLE_GRAPH, 100, &options);
+    bool runCompleted = sequential_run(runData);
+    YACU_ASSERT_TRUE(testRun, runCompleted);
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(runData->actorRuns[0]->recordData, 0), 3);
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(runData->actorRuns[1]->recordData, 0), 10);
+    YACU_ASSERT_TRUE(testRun, runData->actorRuns[2]->recordData == NULL);
+    double *gainOutput = new_record_storage(runData->actorRuns[1]->recordData, 0);
+    copy_recorded_tokens(runData->actorRuns[1]->recordData, 0, gainOutput);
+    for (size_t tokenId = 0; tokenId < 10; tokenId++)
+    {
+        YACU_ASSERT_APPROX_EQ_DBL(testRun, gainOutput[tokenId], 6., 1e-3);
+    }
+    delete_record_storage(gainOutput);
+    delete_graph_run(runData);
+}
+
+void test_larger_last_record(YacuTestRun *testRun)
+{
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 1, .outputId = 1}, .option = {.mode = CSDF_RECORD_LAST, .parameter = 1}},
+        {.output = {.actorId = 0, .outputId = 0}, .option = {.mode = CSDF_RECORD_LAST, .parameter = 0}},
+        {.output = {.actorId = 0, .outputId = 1}, .option = {.mode = CSDF_RECORD_EVERY, .parameter = 0}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 3, .recordSelections = recordSelections};
+    CsdfGraphRun *runData = new_graph_run_with_options(&LARGER_GRAPH, 3, &options);
+    bool runCompleted = sequential_run(runData);
+    YACU_ASSERT_TRUE(testRun, runCompleted);
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(runData->actorRuns[0]->recordData, 0), 0);
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(runData->actorRuns[0]->recordData, 1), 0);
+    int *rightIntOutputProducedTokens = new_record_storage(runData->actorRuns[1]->recordData, 1);
+    copy_recorded_tokens(runData->actorRuns[1]->recordData, 1, rightIntOutputProducedTokens);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[0], 2);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[1], 3);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[2], 5);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[3], 7);
+    delete_record_storage(rightIntOutputProducedTokens);
+    delete_graph_run(runData);
+}
+
+void test_larger_file_record(YacuTestRun *testRun)
+{
+#ifndef _WIN32
+    char directory[] = "/tmp/csdfrecXXXXXX";
+    YACU_ASSERT_TRUE(testRun, mkdtemp(directory) != NULL);
+    char path[64];
+    snprintf(path, sizeof(path), "%s/actor1.csdfrec", directory);
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 1, .outputId = 1}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 1, .recordSelections = recordSelections, .recordDirectory = directory};
+    CsdfGraphRun *runData = new_graph_run_with_options(&LARGER_GRAPH, 100, &options);
+    bool runCompleted = sequential_run(runData);
+    YACU_ASSERT_TRUE(testRun, runCompleted);
+    delete_graph_run(runData);
+
+    CsdfRecordFile *recordFile = open_record_file(path);
+    YACU_ASSERT_TRUE(testRun, recordFile != NULL);
+    YACU_ASSERT_EQ_UINT(testRun, record_file_num_outputs(recordFile), 2);
+    YACU_ASSERT_EQ_UINT(testRun, record_file_executions(recordFile), 100);
+    CsdfRecordView view;
+    YACU_ASSERT_TRUE(testRun, record_file_view(recordFile, 1, &view));
+    YACU_ASSERT_EQ_UINT(testRun, view.numTokens, 400);
+    YACU_ASSERT_EQ_UINT(testRun, view.numWrappedTokens, 0);
+    const int *rightIntOutputProducedTokens = (const int *)view.tokens;
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[0], 2);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[3], 7);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[396], 2);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[399], 7);
+    YACU_ASSERT_TRUE(testRun, record_file_view(recordFile, 0, &view));
+    YACU_ASSERT_EQ_UINT(testRun, view.numTokens, 0);
+    YACU_ASSERT_TRUE(testRun, !record_file_view(recordFile, 2, &view));
+    close_record_file(recordFile);
+    remove(path);
+
+    // The header follows the chunks written so far while the run lasts.
+    CsdfRecordSelection rampSelections[] = {
+        {.output = {.actorId = 1, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions rampOptions = {.numRecordSelections = 1, .recordSelections = rampSelections, .recordDirectory = directory};
+    runData = new_graph_run_with_options(&RAMP_GRAPH, 600000, &rampOptions);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    recordFile = open_record_file(path);
+    YACU_ASSERT_TRUE(testRun, recordFile != NULL);
+    size_t numExecutions = record_file_executions(recordFile);
+    YACU_ASSERT_TRUE(testRun, numExecutions >= (4u << 20) / sizeof(long) && numExecutions < 600000);
+    YACU_ASSERT_TRUE(testRun, record_file_view(recordFile, 0, &view));
+    long lastTokenId = (long)numExecutions - 1;
+    long expected = 4 * lastTokenId * lastTokenId + (2 * lastTokenId + 1) * (2 * lastTokenId + 1);
+    YACU_ASSERT_EQ_INT(testRun, ((const long *)view.tokens)[lastTokenId], expected);
+    close_record_file(recordFile);
+    delete_graph_run(runData);
+    recordFile = open_record_file(path);
+    YACU_ASSERT_EQ_UINT(testRun, record_file_executions(recordFile), 600000);
+    close_record_file(recordFile);
+    remove(path);
+    rmdir(directory);
+
+    options.recordDirectory = "/nonexistent/csdf";
+    YACU_ASSERT_TRUE(testRun, new_graph_run_with_options(&LARGER_GRAPH, 100, &options) == NULL);
+#else
+    (void)testRun;
+#endif
+}
+
+void test_larger_reset_run(YacuTestRun *testRun)
+{
+    CsdfGraphRunPool *pool = new_graph_run_pool(&LARGER_GRAPH, 10, NULL, 2);
+    CsdfGraphRun *run1Data = checkout_graph_run(pool);
+    CsdfGraphRun *run2Data = checkout_graph_run(pool);
+    YACU_ASSERT_TRUE(testRun, run1Data != NULL && run2Data != NULL && run1Data != run2Data);
+    YACU_ASSERT_TRUE(testRun, checkout_graph_run(pool) == NULL);
+
+    enable_graph_run_trace(run1Data, 1, 64);
+    YACU_ASSERT_TRUE(testRun, sequential_run(run1Data));
+    YACU_ASSERT_TRUE(testRun, trace_num_events(run1Data->trace, 0) > 0);
+    return_graph_run(pool, run1Data);
+    CsdfGraphRun *rerunData = checkout_graph_run(pool);
+    YACU_ASSERT_TRUE(testRun, rerunData == run1Data);
+    YACU_ASSERT_EQ_UINT(testRun, trace_num_events(rerunData->trace, 0), 0);
+    YACU_ASSERT_TRUE(testRun, sequential_run(rerunData));
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(rerunData->actorRuns[1]->recordData, 1), 10);
+
+    int *rightIntOutputProducedTokens = new_record_storage(rerunData->actorRuns[1]->recordData, 1);
+    copy_recorded_tokens(rerunData->actorRuns[1]->recordData, 1, rightIntOutputProducedTokens);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[0], 2);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[1], 3);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[2], 5);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[3], 7);
+    delete_record_storage(rightIntOutputProducedTokens);
+
+    return_graph_run(pool, rerunData);
+    return_graph_run(pool, run2Data);
+    delete_graph_run_pool(pool);
+
+#ifndef _WIN32
+    char directory[] = "/tmp/csdfrecXXXXXX";
+    YACU_ASSERT_TRUE(testRun, mkdtemp(directory) != NULL);
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 1, .outputId = 1}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 1, .recordSelections = recordSelections, .recordDirectory = directory};
+    pool = new_graph_run_pool(&LARGER_GRAPH, 10, &options, 2);
+    YACU_ASSERT_TRUE(testRun, pool != NULL);
+    delete_graph_run_pool(pool);
+    char path[64];
+    for (int runId = 0; runId < 2; runId++)
+    {
+        snprintf(path, sizeof(path), "%s/run%d/actor1.csdfrec", directory, runId);
+        CsdfRecordFile *recordFile = open_record_file(path);
+        YACU_ASSERT_TRUE(testRun, recordFile != NULL);
+        if (recordFile != NULL)
+        {
+            close_record_file(recordFile);
+        }
+        remove(path);
+        snprintf(path, sizeof(path), "%s/run%d", directory, runId);
+        rmdir(path);
+    }
+    rmdir(directory);
+#endif
+}
+
+void test_larger_batch_run(YacuTestRun *testRun)
+{
+    int intRight2Left[8][4];
+    const void *initialTokens[8][4] = {{NULL}};
+    for (int instanceId = 0; instanceId < 8; instanceId++)
+    {
+        for (int tokenId = 0; tokenId < 4; tokenId++)
+        {
+            intRight2Left[instanceId][tokenId] = 10 * instanceId + tokenId;
+        }
+        initialTokens[instanceId][3] = intRight2Left[instanceId];
+    }
+    int rightIntOutputs[8][4];
+    CsdfOutputId results[] = {{.actorId = 1, .outputId = 1}};
+    void *resultTokens[] = {rightIntOutputs};
+    CsdfBatch batch = {
+        .graph = &LARGER_GRAPH,
+        .numIterations = 1,
+        .numInstances = 8,
+        .initialTokens = &initialTokens[0][0],
+        .numResults = 1,
+        .results = results,
+        .resultTokens = resultTokens};
+    size_t resultSize = 0;
+    YACU_ASSERT_TRUE(testRun, batch_result_sizes(&batch, &resultSize));
+    YACU_ASSERT_EQ_UINT(testRun, resultSize, 4 * sizeof(int));
+    YACU_ASSERT_TRUE(testRun, !batch_run(&CSDF_PTHREAD_THREADING, 0, &batch));
+    YACU_ASSERT_TRUE(testRun, batch_run(&CSDF_PTHREAD_THREADING, 3, &batch));
+    for (int instanceId = 0; instanceId < 8; instanceId++)
+    {
+        for (int tokenId = 0; tokenId < 4; tokenId++)
+        {
+            YACU_ASSERT_EQ_INT(testRun, rightIntOutputs[instanceId][tokenId], 10 * instanceId + tokenId);
+        }
+    }
+}
+
+void test_simple_trace(YacuTestRun *testRun)
+{
+    CsdfGraphRun *runData = new_graph_run(&SIMPLE_GRAPH, 10);
+    enable_graph_run_trace(runData, SIMPLE_GRAPH.numActors, 16);
+    bool runCompleted = parallel_run(&CSDF_PTHREAD_THREADING, runData);
+    YACU_ASSERT_TRUE(testRun, runCompleted);
+    for (size_t threadId = 0; threadId < SIMPLE_GRAPH.numActors; threadId++)
+    {
+        YACU_ASSERT_EQ_UINT(testRun, trace_num_events(runData->trace, threadId), 10);
+    }
+    YACU_ASSERT_TRUE(testRun, export_chrome_trace(runData->trace, runData->graph, runData->repetitionVector, "simple_trace.json"));
+    remove("simple_trace.json");
+    delete_graph_run(runData);
+}
+
+void test_open_stream(YacuTestRun *testRun)
+{
+    CsdfStream *stream = start_stream(&CSDF_PTHREAD_THREADING, &OPEN_GRAPH, 1, &OPEN_GRAPH_INPUT, 1, &OPEN_GRAPH_OUTPUT, 8);
+    YACU_ASSERT_TRUE(testRun, stream != NULL);
+    double inputs[1000], outputs[500];
+    for (size_t tokenId = 0; tokenId < 1000; tokenId++)
+    {
+        inputs[tokenId] = (double)tokenId;
+    }
+    size_t numPushed = 0, numPulled = 0;
+    while (numPulled < 500)
+    {
+        numPushed += stream_push(stream, 0, inputs + numPushed, 1000 - numPushed);
+        numPulled += stream_pull(stream, 0, outputs + numPulled, 500 - numPulled);
+    }
+    YACU_ASSERT_TRUE(testRun, stop_stream(stream));
+    for (size_t tokenId = 0; tokenId < 500; tokenId++)
+    {
+        YACU_ASSERT_APPROX_EQ_DBL(testRun, outputs[tokenId], 8. * tokenId + 2., 1e-9);
+    }
+
+    CsdfInputId duplicateInputs[] = {OPEN_GRAPH_INPUT, OPEN_GRAPH_INPUT};
+    YACU_ASSERT_TRUE(testRun, start_stream(&CSDF_PTHREAD_THREADING, &OPEN_GRAPH, 2, duplicateInputs, 1, &OPEN_GRAPH_OUTPUT, 8) == NULL);
+    YACU_ASSERT_TRUE(testRun, start_stream(&CSDF_PTHREAD_THREADING, &OPEN_GRAPH, 0, NULL, 1, &OPEN_GRAPH_OUTPUT, 8) == NULL);
+    YACU_ASSERT_TRUE(testRun, new_graph_run(&OPEN_GRAPH, CSDF_UNBOUNDED_ITERATIONS) == NULL);
+
+    // Without a port the unconnected input has no buffer to fire from.
+    CsdfGraphRun *runData = new_graph_run(&OPEN_GRAPH, 2);
+    YACU_ASSERT_TRUE(testRun, !graph_run_inputs_attached(runData));
+    YACU_ASSERT_TRUE(testRun, !sequential_run(runData));
+    YACU_ASSERT_TRUE(testRun, !parallel_run(&CSDF_PTHREAD_THREADING, runData));
+    delete_graph_run(runData);
+}
+
+void test_ramp_replicated_run(YacuTestRun *testRun)
+{
+    CsdfGraphRun *run1Data = new_graph_run(&RAMP_GRAPH, 1000);
+    CsdfGraphRun *run2Data = new_graph_run(&RAMP_GRAPH, 1000);
+    CsdfParallelOptions options = {.statelessReplicas = 4};
+    enable_graph_run_trace(run2Data, 5, 1000);
+
+    YACU_ASSERT_TRUE(testRun, sequential_run(run1Data));
+    YACU_ASSERT_TRUE(testRun, parallel_run_with_options(&CSDF_PTHREAD_THREADING, run2Data, &options));
+    YACU_ASSERT_EQ_UINT(testRun, trace_num_events(run2Data->trace, 0), 1000);
+    size_t numReplicaEvents = 0;
+    for (size_t threadId = 1; threadId < 5; threadId++)
+    {
+        numReplicaEvents += trace_num_events(run2Data->trace, threadId);
+    }
+    YACU_ASSERT_EQ_UINT(testRun, numReplicaEvents, 1000);
+
+    long *squareSum1Output = new_record_storage(run1Data->actorRuns[1]->recordData, 0);
+    long *squareSum2Output = new_record_storage(run2Data->actorRuns[1]->recordData, 0);
+    copy_recorded_tokens(run1Data->actorRuns[1]->recordData, 0, squareSum1Output);
+    copy_recorded_tokens(run2Data->actorRuns[1]->recordData, 0, squareSum2Output);
+    for (long tokenId = 0; tokenId < 1000; tokenId++)
+    {
+        long expected = 4 * tokenId * tokenId + (2 * tokenId + 1) * (2 * tokenId + 1);
+        YACU_ASSERT_EQ_INT(testRun, squareSum1Output[tokenId], expected);
+        YACU_ASSERT_EQ_INT(testRun, squareSum2Output[tokenId], expected);
+    }
+    delete_record_storage(squareSum1Output);
+    delete_record_storage(squareSum2Output);
+    delete_graph_run(run1Data);
+    delete_graph_run(run2Data);
+}
+
+void test_ramp_pooled_run(YacuTestRun *testRun)
+{
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 1, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}},
+        {.output = {.actorId = 2, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 2, .recordSelections = recordSelections, .largeTokenThreshold = sizeof(long)};
+    CsdfParallelOptions parallelOptions = {.statelessReplicas = 4};
+    CsdfGraphRun *runData = new_graph_run_with_options(&RAMP_FANOUT_GRAPH, 500, &options);
+    YACU_ASSERT_TRUE(testRun, runData->buffers[1]->pool != NULL);
+    YACU_ASSERT_TRUE(testRun, runData->buffers[1]->pool == runData->buffers[2]->pool);
+    YACU_ASSERT_TRUE(testRun, runData->buffers[0]->pool != NULL);
+    YACU_ASSERT_TRUE(testRun, runData->buffers[0]->pool != runData->buffers[1]->pool);
+
+    YACU_ASSERT_TRUE(testRun, parallel_run_with_options(&CSDF_PTHREAD_THREADING, runData, &parallelOptions));
+    reset_graph_run(runData);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+
+    for (size_t actorId = 1; actorId < 3; actorId++)
+    {
+        long *squareSumOutput = new_record_storage(runData->actorRuns[actorId]->recordData, 0);
+        copy_recorded_tokens(runData->actorRuns[actorId]->recordData, 0, squareSumOutput);
+        for (long tokenId = 0; tokenId < 500; tokenId++)
+        {
+            long expected = 4 * tokenId * tokenId + (2 * tokenId + 1) * (2 * tokenId + 1);
+            YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], expected);
+        }
+        delete_record_storage(squareSumOutput);
+    }
+    delete_graph_run(runData);
+}
+
+typedef struct Frame
+{
+    long index;
+    char payload[4088];
+} Frame;
+
+typedef struct FrameSink
+{
+    long indexSum;
+    const void *lastFrame;
+} FrameSink;
+
+static void write_frames(void *context, const void *const *consumed, void *const *produced)
+{
+    (void)consumed;
+    long *nextIndex = context;
+    for (size_t tokenId = 0; tokenId < 2; tokenId++)
+    {
+        Frame *frame = produced[tokenId];
+        frame->index = (*nextIndex)++;
+    }
+}
+
+static void read_frame(void *context, const void *const *consumed, void *const *produced)
+{
+    (void)produced;
+    FrameSink *sink = context;
+    const Frame *frame = consumed[0];
+    sink->indexSum += frame->index;
+    sink->lastFrame = frame;
+}
+
+static bool is_pool_slot(const CsdfTokenPool *pool, const void *token)
+{
+    const uint8_t *slot = token;
+    return slot >= pool->slots && slot < pool->slots + (size_t)pool->numSlots * pool->tokenSize;
+}
+
+void test_frame_pooled_run(YacuTestRun *testRun)
+{
+    long nextIndex = 0;
+    FrameSink sinks[2] = {{.indexSum = 0}, {.indexSum = 0}};
+    CsdfOutput frameOutputs[] = {CSDF_OUTPUT(Frame, 2)};
+    CsdfInput frameInputs[] = {CSDF_INPUT(Frame, 1)};
+    CsdfActor actors[] = {
+        {.numOutputs = 1, .outputs = frameOutputs, .tokenExecution = write_frames, .context = &nextIndex},
+        {.numInputs = 1, .inputs = frameInputs, .tokenExecution = read_frame, .context = sinks},
+        {.numInputs = 1, .inputs = frameInputs, .tokenExecution = read_frame, .context = sinks + 1}};
+    CsdfConnection connections[] = {
+        {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 1, .inputId = 0}, .tokenSize = sizeof(Frame), .numTokens = 0, .initialTokens = NULL},
+        {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 2, .inputId = 0}, .tokenSize = sizeof(Frame), .numTokens = 0, .initialTokens = NULL}};
+    CsdfGraph graph = {.numActors = 3, .actors = actors, .numConnections = 2, .connections = connections};
+    CsdfGraphRunOptions options = {.numRecordSelections = 0, .largeTokenThreshold = sizeof(Frame), .bufferedIterations = 4};
+    CsdfGraphRun *runData = new_graph_run_with_options(&graph, 300, &options);
+    CsdfTokenPool *pool = runData->buffers[0]->pool;
+    YACU_ASSERT_TRUE(testRun, pool != NULL && runData->buffers[1]->pool == pool);
+
+    // Both sinks read the frames in the slots the source wrote them to.
+    YACU_ASSERT_TRUE(testRun, parallel_run(&CSDF_PTHREAD_THREADING, runData));
+    for (size_t sinkId = 0; sinkId < 2; sinkId++)
+    {
+        YACU_ASSERT_EQ_INT(testRun, sinks[sinkId].indexSum, 599L * 600 / 2);
+        YACU_ASSERT_TRUE(testRun, is_pool_slot(pool, sinks[sinkId].lastFrame));
+    }
+    YACU_ASSERT_EQ_UINT(testRun, token_pool_free(pool), pool->numSlots);
+
+    reset_graph_run(runData);
+    nextIndex = 0;
+    sinks[0].indexSum = sinks[1].indexSum = 0;
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    YACU_ASSERT_EQ_INT(testRun, sinks[1].indexSum, 599L * 600 / 2);
+    delete_graph_run(runData);
+}
+
+void test_ramp_placed_run(YacuTestRun *testRun)
+{
+    CsdfCpuSet cpus;
+    YACU_ASSERT_TRUE(testRun, parse_cpu_list("0-2,5\n", &cpus));
+    YACU_ASSERT_EQ_UINT(testRun, count_cpus(&cpus), 4);
+    YACU_ASSERT_TRUE(testRun, has_cpu(&cpus, 5) && !has_cpu(&cpus, 3));
+
+    CsdfCpuSet nodeCpus[2];
+    parse_cpu_list("0-1", nodeCpus);
+    parse_cpu_list("2", nodeCpus + 1);
+    CsdfNumaTopology twoNodes = {.numNodes = 2, .nodeCpus = nodeCpus};
+    CsdfGraphRun *runData = new_graph_run(&RAMP_CHAIN_GRAPH, 200);
+    CsdfPlacement *placement = new_topology_placement(&RAMP_CHAIN_GRAPH, runData->repetitionVector, &twoNodes);
+    YACU_ASSERT_EQ_UINT(testRun, placement->actorNodes[0], 1);
+    YACU_ASSERT_EQ_UINT(testRun, placement->actorNodes[1], 0);
+    YACU_ASSERT_EQ_UINT(testRun, placement->actorNodes[2], 0);
+    delete_placement(placement);
+
+    CsdfNumaTopology *topology = read_numa_topology();
+    YACU_ASSERT_TRUE(testRun, topology->numNodes > 0);
+    placement = new_topology_placement(&RAMP_CHAIN_GRAPH, runData->repetitionVector, topology);
+    CsdfParallelOptions options = {.placement = placement};
+    YACU_ASSERT_TRUE(testRun, parallel_run_with_options(&CSDF_PTHREAD_THREADING, runData, &options));
+    CsdfRecordData *squareSumRecord = runData->actorRuns[2]->recordData;
+    long *squareSumOutput = new_record_storage(squareSumRecord, 0);
+    copy_recorded_tokens(squareSumRecord, 0, squareSumOutput);
+    for (long tokenId = 0; tokenId < 600; tokenId++)
+    {
+        long first = (2 * tokenId) / 3;
+        long second = (2 * tokenId + 1) / 3;
+        YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], first * first + second * second);
+    }
+    delete_record_storage(squareSumOutput);
+    delete_placement(placement);
+    delete_numa_topology(topology);
+
+    CsdfCpuSet sparseCpus[3];
+    parse_cpu_list("0", sparseCpus);
+    clear_cpu_set(sparseCpus + 1);
+    parse_cpu_list("1", sparseCpus + 2);
+    CsdfNumaTopology sparseNodes = {.numNodes = 3, .nodeCpus = sparseCpus};
+    placement = new_topology_placement(&RAMP_CHAIN_GRAPH, runData->repetitionVector, &sparseNodes);
+    for (size_t actorId = 0; actorId < 3; actorId++)
+    {
+        YACU_ASSERT_TRUE(testRun, placement->actorNodes[actorId] != 1);
+    }
+    delete_placement(placement);
+    CsdfNumaTopology noCpus = {.numNodes = 2, .nodeCpus = sparseCpus + 1};
+    clear_cpu_set(sparseCpus + 2);
+    placement = new_topology_placement(&RAMP_CHAIN_GRAPH, runData->repetitionVector, &noCpus);
+    YACU_ASSERT_EQ_UINT(testRun, placement->actorNodes[0], CSDF_NO_NUMA_NODE);
+    delete_placement(placement);
+
+#if defined(__linux__)
+    placement = new_placement(RAMP_CHAIN_GRAPH.numActors);
+    add_cpu(placement->actorCpus + 1, CSDF_MAX_CPUS - 1);
+    reset_graph_run(runData);
+    options.placement = placement;
+    YACU_ASSERT_TRUE(testRun, !parallel_run_with_options(&CSDF_PTHREAD_THREADING, runData, &options));
+    delete_placement(placement);
+#endif
+    delete_graph_run(runData);
+}
+
+static CsdfBuffer *new_cross_part_buffer(void *context, size_t connectionId, unsigned maxTokens)
+{
+    const CsdfGraph *graph = context;
+    return new_plain_buffer(graph->connections + connectionId, maxTokens);
+}
+
+void test_self_timed_run(YacuTestRun *testRun)
+{
+    CsdfGraphRun *chainData = new_graph_run(&RAMP_CHAIN_GRAPH, 200);
+    CsdfSelfTimedOptions chainOptions = {.numThreads = 2};
+    YACU_ASSERT_TRUE(testRun, self_timed_run(&CSDF_PTHREAD_THREADING, chainData, &chainOptions));
+    CsdfRecordData *squareSumRecord = chainData->actorRuns[2]->recordData;
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(squareSumRecord, 0), 600);
+    long *squareSumOutput = new_record_storage(squareSumRecord, 0);
+    copy_recorded_tokens(squareSumRecord, 0, squareSumOutput);
+    for (long tokenId = 0; tokenId < 600; tokenId++)
+    {
+        long first = (2 * tokenId) / 3;
+        long second = (2 * tokenId + 1) / 3;
+        YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], first * first + second * second);
+    }
+    delete_record_storage(squareSumOutput);
+    delete_graph_run(chainData);
+
+    size_t actorThreads[] = {1, 0};
+    CsdfSelfTimedOptions largerOptions = {.numThreads = 2, .actorThreads = actorThreads};
+    CsdfGraphRun *largerData = new_graph_run(&LARGER_GRAPH, 10);
+    YACU_ASSERT_TRUE(testRun, self_timed_run(&CSDF_PTHREAD_THREADING, largerData, &largerOptions));
+    int *rightIntOutputProducedTokens = new_record_storage(largerData->actorRuns[1]->recordData, 1);
+    copy_recorded_tokens(largerData->actorRuns[1]->recordData, 1, rightIntOutputProducedTokens);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[36], 2);
+    YACU_ASSERT_EQ_INT(testRun, rightIntOutputProducedTokens[39], 7);
+    delete_record_storage(rightIntOutputProducedTokens);
+
+    size_t wrongThreads[] = {2, 0};
+    CsdfSelfTimedOptions wrongOptions = {.numThreads = 2, .actorThreads = wrongThreads};
+    reset_graph_run(largerData);
+    YACU_ASSERT_TRUE(testRun, !self_timed_run(&CSDF_PTHREAD_THREADING, largerData, &wrongOptions));
+    delete_graph_run(largerData);
+
+    size_t actorParts[] = {0, 0, 1};
+    CsdfGraphRunOptions partOptions = {.actorParts = actorParts, .localPart = 0, .crossPartBuffer = new_cross_part_buffer, .crossPartContext = (void *)&RAMP_CHAIN_GRAPH};
+    CsdfGraphRun *partData = new_graph_run_with_options(&RAMP_CHAIN_GRAPH, 10, &partOptions);
+    YACU_ASSERT_TRUE(testRun, partData != NULL && !graph_run_is_local(partData));
+    YACU_ASSERT_TRUE(testRun, !self_timed_run(&CSDF_PTHREAD_THREADING, partData, &chainOptions));
+    YACU_ASSERT_TRUE(testRun, !sequential_run(partData));
+    delete_graph_run(partData);
+}
+
+void test_self_timed_profiled_run(YacuTestRun *testRun)
+{
+    remove("ramp.csdfprof");
+    CsdfSelfTimedOptions options = {.numThreads = 2, .warmupIterations = 20, .profilePath = "ramp.csdfprof"};
+    for (int runId = 0; runId < 2; runId++)
+    {
+        CsdfGraphRun *runData = new_graph_run(&RAMP_CHAIN_GRAPH, 100);
+        YACU_ASSERT_TRUE(testRun, self_timed_run(&CSDF_PTHREAD_THREADING, runData, &options));
+        CsdfRecordData *squareSumRecord = runData->actorRuns[2]->recordData;
+        long *squareSumOutput = new_record_storage(squareSumRecord, 0);
+        copy_recorded_tokens(squareSumRecord, 0, squareSumOutput);
+        for (long tokenId = 0; tokenId < 300; tokenId++)
+        {
+            long first = (2 * tokenId) / 3;
+            long second = (2 * tokenId + 1) / 3;
+            YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], first * first + second * second);
+        }
+        delete_record_storage(squareSumOutput);
+
+        CsdfRunProfile *profile = load_run_profile(&RAMP_CHAIN_GRAPH, runData->repetitionVector, "ramp.csdfprof");
+        YACU_ASSERT_TRUE(testRun, profile != NULL);
+        YACU_ASSERT_EQ_UINT(testRun, profile->numThreads, 2);
+        YACU_ASSERT_EQ_UINT(testRun, profile->connectionBytes[2], 6 * sizeof(long));
+        delete_run_profile(profile);
+        YACU_ASSERT_TRUE(testRun, load_run_profile(&RAMP_GRAPH, runData->repetitionVector, "ramp.csdfprof") == NULL);
+        delete_graph_run(runData);
+    }
+    remove("ramp.csdfprof");
+}
+
+void test_ramp_waiting_run(YacuTestRun *testRun)
+{
+    CsdfWaitMode modes[] = {CSDF_WAIT_SPIN, CSDF_WAIT_YIELD, CSDF_WAIT_PARK, CSDF_WAIT_ADAPTIVE};
+    for (size_t modeId = 0; modeId < sizeof(modes) / sizeof(CsdfWaitMode); modeId++)
+    {
+        CsdfWaitStrategy wait = {.mode = modes[modeId], .spinLimit = 64, .parkMicroseconds = 200};
+        CsdfParallelOptions parallelOptions = {.statelessReplicas = 2, .wait = &wait};
+        CsdfGraphRun *rampData = new_graph_run(&RAMP_GRAPH, 300);
+        YACU_ASSERT_TRUE(testRun, parallel_run_with_options(&CSDF_PTHREAD_THREADING, rampData, &parallelOptions));
+        long *squareSumOutput = new_record_storage(rampData->actorRuns[1]->recordData, 0);
+        copy_recorded_tokens(rampData->actorRuns[1]->recordData, 0, squareSumOutput);
+        for (long tokenId = 0; tokenId < 300; tokenId++)
+        {
+            long expected = 4 * tokenId * tokenId + (2 * tokenId + 1) * (2 * tokenId + 1);
+            YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], expected);
+        }
+        delete_record_storage(squareSumOutput);
+        delete_graph_run(rampData);
+
+        CsdfSelfTimedOptions selfTimedOptions = {.numThreads = 3, .wait = &wait};
+        CsdfGraphRun *chainData = new_graph_run(&RAMP_CHAIN_GRAPH, 100);
+        YACU_ASSERT_TRUE(testRun, self_timed_run(&CSDF_PTHREAD_THREADING, chainData, &selfTimedOptions));
+        YACU_ASSERT_EQ_UINT(testRun, recorded_firings(chainData->actorRuns[2]->recordData, 0), 300);
+        delete_graph_run(chainData);
+    }
+}
+
+void test_bulk_buffer_wrap(YacuTestRun *testRun)
+{
+    const CsdfConnection connection = {.tokenSize = sizeof(int), .numTokens = 0, .initialTokens = NULL};
+    CsdfBuffer *buffers[] = {new_stdlockfree_buffer(&connection, 6), new_plain_buffer(&connection, 6)};
+    for (size_t bufferId = 0; bufferId < 2; bufferId++)
+    {
+        CsdfBuffer *buffer = buffers[bufferId];
+        int pushed[] = {1, 2, 3, 4, 5, 6, 7};
+        int popped[4];
+        buffer->pushTokens(buffer, (const uint8_t *)pushed, 4);
+        buffer->popTokens(buffer, (uint8_t *)popped, 3);
+        YACU_ASSERT_TRUE(testRun, buffer->hasSpace(buffer, 4) && !buffer->hasSpace(buffer, 5));
+        buffer->pushTokens(buffer, (const uint8_t *)(pushed + 4), 3);
+        YACU_ASSERT_TRUE(testRun, buffer->hasTokens(buffer, 4) && !buffer->hasTokens(buffer, 5));
+        YACU_ASSERT_EQ_UINT(testRun, buffer->freeSpace(buffer), 1);
+        buffer->popTokens(buffer, (uint8_t *)popped, 4);
+        for (int tokenId = 0; tokenId < 4; tokenId++)
+        {
+            YACU_ASSERT_EQ_INT(testRun, popped[tokenId], tokenId + 4);
+        }
+        YACU_ASSERT_EQ_UINT(testRun, buffer->numberOfTokens(buffer), 0);
+        buffer->destroy(buffer);
+    }
+}
+
+static void assert_ramp_square_sums(YacuTestRun *testRun, CsdfRecordData *squareSumRecord, long numTokens)
+{
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(squareSumRecord, 0), numTokens);
+    long *squareSumOutput = new_record_storage(squareSumRecord, 0);
+    copy_recorded_tokens(squareSumRecord, 0, squareSumOutput);
+    for (long tokenId = 0; tokenId < numTokens; tokenId++)
+    {
+        long expected = 4 * tokenId * tokenId + (2 * tokenId + 1) * (2 * tokenId + 1);
+        YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], expected);
+    }
+    delete_record_storage(squareSumOutput);
+}
+
+void test_ramp_blocked_run(YacuTestRun *testRun)
+{
+    CsdfRecordSelection recordSelection = {.output = {.actorId = 1, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}};
+    CsdfGraphRunOptions options = {
+        .numRecordSelections = 1,
+        .recordSelections = &recordSelection,
+        .blockingFactor = CSDF_AUTO_BLOCKING_FACTOR,
+        .cacheBytes = 5 * 4 * sizeof(long)};
+    CsdfGraphRun *runData = new_graph_run_with_options(&RAMP_GRAPH, 103, &options);
+    YACU_ASSERT_EQ_UINT(testRun, runData->blockingFactor, 5);
+    YACU_ASSERT_EQ_UINT(testRun, runData->blockSchedule->numEntries, 2);
+    YACU_ASSERT_EQ_UINT(testRun, runData->blockSchedule->entries[0].count, 10);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    assert_ramp_square_sums(testRun, runData->actorRuns[1]->recordData, 103);
+
+    // Blocks skip readiness checks, so a finished run must not fire again.
+    YACU_ASSERT_TRUE(testRun, !sequential_run(runData));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[0]->fireCount, 206);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[1]->fireCount, 103);
+
+    reset_graph_run(runData);
+    CsdfOutputId target = {.actorId = 1, .outputId = 0};
+    YACU_ASSERT_TRUE(testRun, sequential_demand_run(runData, target, 1));
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[0]->fireCount, 206);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[1]->fireCount, 103);
+    assert_ramp_square_sums(testRun, runData->actorRuns[1]->recordData, 103);
+
+    reset_graph_run(runData);
+    CsdfOutputId rampOutput = {.actorId = 0, .outputId = 1};
+    YACU_ASSERT_TRUE(testRun, sequential_demand_run(runData, rampOutput, 1));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[0]->fireCount, 1);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[0]->fireCount, 206);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[1]->fireCount, 103);
+    assert_ramp_square_sums(testRun, runData->actorRuns[1]->recordData, 103);
+    YACU_ASSERT_TRUE(testRun, !sequential_run(runData));
+    delete_graph_run(runData);
+}
+
+void test_shm_buffer_open(YacuTestRun *testRun)
+{
+#ifndef _WIN32
+    char name[64];
+    snprintf(name, sizeof(name), "/csdf_shm_test_%ld", (long)getpid());
+    CsdfConnection connection = {
+        .source = {.actorId = 0, .outputId = 0},
+        .destination = {.actorId = 1, .inputId = 0},
+        .tokenSize = sizeof(long),
+        .numTokens = 0,
+        .initialTokens = NULL};
+    CsdfConnection narrowConnection = {
+        .source = {.actorId = 0, .outputId = 0},
+        .destination = {.actorId = 1, .inputId = 0},
+        .tokenSize = sizeof(int),
+        .numTokens = 0,
+        .initialTokens = NULL};
+    CsdfBuffer *producer = new_shm_buffer(&connection, 8, name);
+    YACU_ASSERT_TRUE(testRun, producer != NULL);
+    YACU_ASSERT_TRUE(testRun, open_shm_buffer(&narrowConnection, name) == NULL);
+
+    CsdfBuffer *consumer = open_shm_buffer(&connection, name);
+    YACU_ASSERT_TRUE(testRun, consumer != NULL);
+    long token = 42;
+    producer->push(producer, (const uint8_t *)&token);
+    token = 0;
+    consumer->pop(consumer, (uint8_t *)&token);
+    YACU_ASSERT_EQ_INT(testRun, token, 42);
+    delete_shm_buffer(consumer);
+
+    // One token short of the ring the header announces.
+    int fd = shm_open(name, O_RDWR, 0);
+    struct stat status;
+    YACU_ASSERT_TRUE(testRun, fd >= 0 && fstat(fd, &status) == 0);
+    YACU_ASSERT_TRUE(testRun, ftruncate(fd, status.st_size - (off_t)sizeof(long)) == 0);
+    close(fd);
+    YACU_ASSERT_TRUE(testRun, open_shm_buffer(&connection, name) == NULL);
+    delete_shm_buffer(producer);
+#else
+    (void)testRun;
+#endif
+}
+
+void test_ramp_multiprocess_run(YacuTestRun *testRun)
+{
+#ifndef _WIN32
+    char directory[] = "/tmp/csdfrecXXXXXX";
+    YACU_ASSERT_TRUE(testRun, mkdtemp(directory) != NULL);
+    char path[64];
+    snprintf(path, sizeof(path), "%s/actor2.csdfrec", directory);
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 2, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 1, .recordSelections = recordSelections, .recordDirectory = directory};
+    size_t actorParts[] = {0, 1, 2};
+    YACU_ASSERT_TRUE(testRun, !multiprocess_run(&CSDF_PTHREAD_THREADING, &RAMP_CHAIN_GRAPH, 200, 2, actorParts, &options));
+    YACU_ASSERT_TRUE(testRun, multiprocess_run(&CSDF_PTHREAD_THREADING, &RAMP_CHAIN_GRAPH, 200, 3, actorParts, &options));
+
+    CsdfRecordFile *recordFile = open_record_file(path);
+    YACU_ASSERT_TRUE(testRun, recordFile != NULL);
+    CsdfRecordView view;
+    YACU_ASSERT_TRUE(testRun, record_file_view(recordFile, 0, &view));
+    YACU_ASSERT_EQ_UINT(testRun, view.numTokens, 600);
+    const long *squareSumOutput = (const long *)view.tokens;
+    for (long tokenId = 0; tokenId < 600; tokenId++)
+    {
+        long first = (2 * tokenId) / 3;
+        long second = (2 * tokenId + 1) / 3;
+        YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], first * first + second * second);
+    }
+    close_record_file(recordFile);
+    remove(path);
+    rmdir(directory);
+#else
+    (void)testRun;
+#endif
+}
+
+void test_ramp_cluster_run(YacuTestRun *testRun)
+{
+#ifndef _WIN32
+    unsigned short basePort = (unsigned short)(20000 + (getpid() % 10000) * 3);
+    CsdfNodeAddress nodes[] = {
+        {.host = "127.0.0.1", .port = basePort},
+        {.host = "127.0.0.1", .port = basePort + 1},
+        {.host = "127.0.0.1", .port = basePort + 2}};
+    size_t actorNodes[] = {0, 1, 2};
+    CsdfClusterPartition partition = {.numNodes = 3, .nodes = nodes, .actorNodes = actorNodes};
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 2, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 1, .recordSelections = recordSelections};
+
+    fflush(NULL);
+    pid_t pids[2];
+    for (size_t node = 0; node < 2; node++)
+    {
+        pids[node] = fork();
+        if (pids[node] == 0)
+        {
+            CsdfGraphRun *nodeData = new_cluster_graph_run(&CSDF_PTHREAD_THREADING, &RAMP_CHAIN_GRAPH, 200, &partition, node, &options, 5000);
+            bool completed = nodeData != NULL && parallel_run(&CSDF_PTHREAD_THREADING, nodeData);
+            if (nodeData != NULL)
+            {
+                delete_graph_run(nodeData);
+            }
+            _exit(completed ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    CsdfGraphRun *runData = new_cluster_graph_run(&CSDF_PTHREAD_THREADING, &RAMP_CHAIN_GRAPH, 200, &partition, 2, &options, 5000);
+    YACU_ASSERT_TRUE(testRun, runData != NULL);
+    YACU_ASSERT_TRUE(testRun, runData->actorRuns[0] == NULL && runData->actorRuns[1] == NULL);
+    YACU_ASSERT_TRUE(testRun, parallel_run(&CSDF_PTHREAD_THREADING, runData));
+
+    CsdfRecordData *squareSumRecord = runData->actorRuns[2]->recordData;
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(squareSumRecord, 0), 600);
+    long *squareSumOutput = new_record_storage(squareSumRecord, 0);
+    copy_recorded_tokens(squareSumRecord, 0, squareSumOutput);
+    for (long tokenId = 0; tokenId < 600; tokenId++)
+    {
+        long first = (2 * tokenId) / 3;
+        long second = (2 * tokenId + 1) / 3;
+        YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], first * first + second * second);
+    }
+    delete_record_storage(squareSumOutput);
+    // The producers of the other nodes wait for this consumer to close.
+    delete_graph_run(runData);
+    for (size_t node = 0; node < 2; node++)
+    {
+        int status;
+        YACU_ASSERT_EQ_INT(testRun, waitpid(pids[node], &status, 0), pids[node]);
+        YACU_ASSERT_TRUE(testRun, WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    }
+#else
+    YACU_ASSERT_TRUE(testRun, true);
+#endif
+}
+
+void test_ramp_cluster_peer_closed(YacuTestRun *testRun)
+{
+#ifndef _WIN32
+    unsigned short basePort = (unsigned short)(20000 + (getpid() % 10000) * 3);
+    CsdfNodeAddress nodes[] = {
+        {.host = "127.0.0.1", .port = basePort},
+        {.host = "127.0.0.1", .port = basePort + 1}};
+    size_t actorNodes[] = {0, 1, 1};
+    CsdfClusterPartition partition = {.numNodes = 2, .nodes = nodes, .actorNodes = actorNodes};
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // The producer node goes away before it sends a single token.
+        CsdfGraphRun *nodeData = new_cluster_graph_run(&CSDF_PTHREAD_THREADING, &RAMP_CHAIN_GRAPH, 200, &partition, 0, NULL, 5000);
+        _exit(nodeData != NULL ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    CsdfGraphRun *runData = new_cluster_graph_run(&CSDF_PTHREAD_THREADING, &RAMP_CHAIN_GRAPH, 200, &partition, 1, NULL, 5000);
+    YACU_ASSERT_TRUE(testRun, runData != NULL);
+    int status;
+    YACU_ASSERT_EQ_INT(testRun, waitpid(pid, &status, 0), pid);
+    YACU_ASSERT_TRUE(testRun, WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    YACU_ASSERT_TRUE(testRun, !parallel_run(&CSDF_PTHREAD_THREADING, runData));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[1]->fireCount, 0);
+    delete_graph_run(runData);
+#else
+    YACU_ASSERT_TRUE(testRun, true);
+#endif
+}
+
 void test_larger_parallel(YacuTestRun *testRun)
 {
     YACU_ASSERT_TRUE(testRun, true);
 }
 
+void test_ramp_footprint_plan(YacuTestRun *testRun)
+{
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 2, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 1, .recordSelections = recordSelections};
+    CsdfGraphRunFootprint *footprint = new_graph_run_footprint(&RAMP_CHAIN_GRAPH, 200, &options);
+    YACU_ASSERT_EQ_UINT(testRun, footprint->numOutputs, 4);
+    YACU_ASSERT_EQ_UINT(testRun, footprint->recordBytes[0], 0);
+    YACU_ASSERT_EQ_UINT(testRun, footprint->recordBytes[3], 600 * sizeof(long));
+    YACU_ASSERT_EQ_UINT(testRun, footprint->scratchBytes[1], 4 * sizeof(long));
+    YACU_ASSERT_EQ_UINT(testRun, footprint->bufferBytes[1], stdlockfree_buffer_bytes(301, sizeof(long)));
+    YACU_ASSERT_TRUE(testRun, footprint->totalBytes > footprint->bookkeepingBytes + 600 * sizeof(long));
+    delete_graph_run_footprint(footprint);
+
+    options.shareBufferMemory = true;
+    footprint = new_graph_run_footprint(&RAMP_CHAIN_GRAPH, 200, &options);
+    CsdfGraphRun *runData = new_graph_run_with_options(&RAMP_CHAIN_GRAPH, 200, &options);
+    YACU_ASSERT_EQ_UINT(testRun, footprint->sharedBufferBytes, runData->bufferPacking->packedBytes);
+    YACU_ASSERT_EQ_UINT(testRun, footprint->bufferBytes[1], stdlockfree_buffer_bytes(runData->bufferPacking->lifetimes[1].maxTokens, 0));
+    delete_graph_run(runData);
+    delete_graph_run_footprint(footprint);
+}
+
+void test_ramp_edf_run(YacuTestRun *testRun)
+{
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 2, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions runOptions = {.numRecordSelections = 1, .recordSelections = recordSelections};
+    CsdfGraphRun *runData = new_graph_run_with_options(&RAMP_CHAIN_GRAPH, 200, &runOptions);
+    uint64_t periods[] = {20000, 0, 0};
+    uint64_t deadlines[] = {0, 0, 1000000000};
+    uint64_t executions[] = {0, 1000, 2000};
+    CsdfEdfOptions options = {.numWorkers = 2, .periodNanoseconds = periods, .deadlineNanoseconds = deadlines, .executionNanoseconds = executions};
+    CsdfEdfReport *report = new_edf_report(3);
+    enable_graph_run_trace(runData, 2, 2000);
+    YACU_ASSERT_TRUE(testRun, edf_run(&CSDF_PTHREAD_THREADING, runData, &options, report));
+    YACU_ASSERT_EQ_UINT(testRun, trace_num_events(runData->trace, 0) + trace_num_events(runData->trace, 1), 200 + 600 + 600);
+    YACU_ASSERT_EQ_UINT(testRun, report->relativeDeadlines[2], 1000000000);
+    YACU_ASSERT_EQ_UINT(testRun, report->relativeDeadlines[1], 1000000000 - 2000);
+    YACU_ASSERT_EQ_UINT(testRun, report->relativeDeadlines[0], 1000000000 - 3000);
+    YACU_ASSERT_EQ_UINT(testRun, report->numMisses[2], 0);
+    YACU_ASSERT_TRUE(testRun, report->minSlackNanoseconds[2] > 0);
+
+    CsdfRecordData *squareSumRecord = runData->actorRuns[2]->recordData;
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(squareSumRecord, 0), 600);
+    long *squareSumOutput = new_record_storage(squareSumRecord, 0);
+    copy_recorded_tokens(squareSumRecord, 0, squareSumOutput);
+    for (long tokenId = 0; tokenId < 600; tokenId++)
+    {
+        long first = (2 * tokenId) / 3;
+        long second = (2 * tokenId + 1) / 3;
+        YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], first * first + second * second);
+    }
+    delete_record_storage(squareSumOutput);
+
+    reset_graph_run(runData);
+    deadlines[2] = 1;
+    YACU_ASSERT_TRUE(testRun, edf_run(&CSDF_PTHREAD_THREADING, runData, &options, report));
+    YACU_ASSERT_TRUE(testRun, report->numMisses[2] > 0);
+    YACU_ASSERT_TRUE(testRun, report->minSlackNanoseconds[2] < 0);
+    delete_edf_report(report);
+    delete_graph_run(runData);
+}
+
+void test_ramp_latency_tracking(YacuTestRun *testRun)
+{
+    CsdfGraphRun *runData = new_graph_run(&RAMP_CHAIN_GRAPH, 200);
+    CsdfParallelOptions options = {.statelessReplicas = 4};
+    CsdfLatencySummary summary;
+    enable_graph_run_latency(runData);
+    YACU_ASSERT_TRUE(testRun, parallel_run_with_options(&CSDF_PTHREAD_THREADING, runData, &options));
+    YACU_ASSERT_TRUE(testRun, !graph_run_latency(runData, 1, &summary));
+    YACU_ASSERT_TRUE(testRun, graph_run_latency(runData, 2, &summary));
+    YACU_ASSERT_EQ_UINT(testRun, summary.numSamples, 600);
+    YACU_ASSERT_TRUE(testRun, summary.p50Nanoseconds <= summary.p99Nanoseconds);
+    YACU_ASSERT_TRUE(testRun, summary.p99Nanoseconds <= summary.maxNanoseconds);
+    YACU_ASSERT_TRUE(testRun, summary.maxNanoseconds > 0);
+    YACU_ASSERT_TRUE(testRun, !graph_run_latency(runData, 3, &summary));
+
+    reset_graph_run(runData);
+    YACU_ASSERT_TRUE(testRun, graph_run_latency(runData, 2, &summary));
+    YACU_ASSERT_EQ_UINT(testRun, summary.numSamples, 0);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    YACU_ASSERT_TRUE(testRun, graph_run_latency(runData, 2, &summary));
+    YACU_ASSERT_EQ_UINT(testRun, summary.numSamples, 600);
+    delete_graph_run(runData);
+}
+
+void test_feedback_latency_tracking(YacuTestRun *testRun)
+{
+    // A gain loop with one initial token on its way back, followed by a sink.
+    double loopStart[] = {1};
+    CsdfActor actors[] = {SIMPLE_GRAPH.actors[1], SIMPLE_GRAPH.actors[1], SIMPLE_GRAPH.actors[2]};
+    CsdfConnection connections[] = {
+        {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 1, .inputId = 0}, .tokenSize = sizeof(double), .numTokens = 0, .initialTokens = NULL},
+        {.source = {.actorId = 1, .outputId = 0}, .destination = {.actorId = 0, .inputId = 0}, .tokenSize = sizeof(double), .numTokens = 1, .initialTokens = loopStart},
+        {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 2, .inputId = 0}, .tokenSize = sizeof(double), .numTokens = 0, .initialTokens = NULL}};
+    CsdfGraph loop = {.numActors = 3, .actors = actors, .numConnections = 3, .connections = connections};
+    CsdfGraphRun *runData = new_graph_run(&loop, 100);
+    enable_graph_run_latency(runData);
+    YACU_ASSERT_TRUE(testRun, runData->latency->rings[0].stamps != NULL);
+    YACU_ASSERT_TRUE(testRun, runData->latency->rings[1].stamps == NULL);
+    YACU_ASSERT_TRUE(testRun, runData->latency->rings[2].stamps != NULL);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+
+    // Each sample starts when the loop actor fires, not at the first sample.
+    CsdfLatencySummary summary;
+    YACU_ASSERT_TRUE(testRun, !graph_run_latency(runData, 0, &summary));
+    YACU_ASSERT_TRUE(testRun, graph_run_latency(runData, 2, &summary));
+    YACU_ASSERT_EQ_UINT(testRun, summary.numSamples, 100);
+    YACU_ASSERT_TRUE(testRun, summary.maxNanoseconds > 0);
+    delete_graph_run(runData);
+}
+
+void test_ramp_demand_run(YacuTestRun *testRun)
+{
+    CsdfGraphRun *runData = new_graph_run(&RAMP_FANOUT_GRAPH, 500);
+    CsdfOutputId target = {.actorId = 1, .outputId = 0};
+    YACU_ASSERT_TRUE(testRun, sequential_demand_run(runData, target, 1));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[0]->fireCount, 2);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[1]->fireCount, 1);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[2]->fireCount, 0);
+
+    YACU_ASSERT_TRUE(testRun, sequential_demand_run(runData, target, 99));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[0]->fireCount, 200);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[1]->fireCount, 100);
+    YACU_ASSERT_TRUE(testRun, runData->actorRuns[2]->fireCount < 100);
+    long *squareSumOutput = new_record_storage(runData->actorRuns[1]->recordData, 0);
+    copy_recorded_tokens(runData->actorRuns[1]->recordData, 0, squareSumOutput);
+    for (long tokenId = 0; tokenId < 100; tokenId++)
+    {
+        long expected = 4 * tokenId * tokenId + (2 * tokenId + 1) * (2 * tokenId + 1);
+        YACU_ASSERT_EQ_INT(testRun, squareSumOutput[tokenId], expected);
+    }
+    delete_record_storage(squareSumOutput);
+
+    YACU_ASSERT_TRUE(testRun, !sequential_demand_run(runData, target, 401));
+
+    // A full run finishes the iterations from where the demand runs stopped.
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[0]->fireCount, 1000);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[1]->fireCount, 500);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[2]->fireCount, 500);
+    assert_ramp_square_sums(testRun, runData->actorRuns[1]->recordData, 500);
+    assert_ramp_square_sums(testRun, runData->actorRuns[2]->recordData, 500);
+    delete_graph_run(runData);
+
+    // Demanding the last token exhausts actor 1 long before actor 2.
+    runData = new_graph_run(&RAMP_FANOUT_GRAPH, 5);
+    YACU_ASSERT_TRUE(testRun, sequential_demand_run(runData, target, 5));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[1]->fireCount, 5);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[2]->fireCount, 0);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[0]->fireCount, 10);
+    YACU_ASSERT_EQ_UINT(testRun, runData->actorRuns[2]->fireCount, 5);
+    assert_ramp_square_sums(testRun, runData->actorRuns[2]->recordData, 5);
+    YACU_ASSERT_TRUE(testRun, !sequential_run(runData));
+    delete_graph_run(runData);
+}
+
+void test_ramp_fused_batch(YacuTestRun *testRun)
+{
+    CsdfFusedGraph *fusedGraph = new_fused_graph(&RAMP_CHAIN_GRAPH);
+    long squareSumOutputs[8][60];
+    CsdfOutputId results[] = {{.actorId = fusedGraph->actorIds[2], .outputId = 0}};
+    void *resultTokens[] = {squareSumOutputs};
+    CsdfBatch batch = {
+        .graph = fusedGraph->graph,
+        .numIterations = 20,
+        .numInstances = 8,
+        .initialTokens = NULL,
+        .numResults = 1,
+        .results = results,
+        .resultTokens = resultTokens};
+    YACU_ASSERT_TRUE(testRun, batch_run(&CSDF_PTHREAD_THREADING, 4, &batch));
+
+    CsdfGraphRun *runData = new_graph_run(&RAMP_CHAIN_GRAPH, 20);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    long *squareSumOutput = new_record_storage(runData->actorRuns[2]->recordData, 0);
+    copy_recorded_tokens(runData->actorRuns[2]->recordData, 0, squareSumOutput);
+    for (int instanceId = 0; instanceId < 8; instanceId++)
+    {
+        for (int tokenId = 0; tokenId < 60; tokenId++)
+        {
+            YACU_ASSERT_EQ_INT(testRun, squareSumOutputs[instanceId][tokenId], squareSumOutput[tokenId]);
+        }
+    }
+    delete_record_storage(squareSumOutput);
+    delete_graph_run(runData);
+    delete_fused_graph(fusedGraph);
+}
+
+void test_open_composite_run(YacuTestRun *testRun)
+{
+    FILE *capture = fopen("composite.bin", "wb");
+    for (int tokenId = 1; tokenId <= 8; tokenId++)
+    {
+        double token = tokenId;
+        fwrite(&token, sizeof(double), 1, capture);
+    }
+    fclose(capture);
+
+    CsdfFileSource *source = new_file_source("composite.bin", sizeof(double), 2, false);
+    CsdfCompositeActor *composite = new_composite_actor(&OPEN_GRAPH, 1, &OPEN_GRAPH_INPUT, 1, &OPEN_GRAPH_OUTPUT);
+    YACU_ASSERT_TRUE(testRun, composite != NULL);
+    CsdfOutputId repeatedOutputs[] = {OPEN_GRAPH_OUTPUT, OPEN_GRAPH_OUTPUT};
+    YACU_ASSERT_TRUE(testRun, new_composite_actor(&OPEN_GRAPH, 0, NULL, 1, &OPEN_GRAPH_OUTPUT) == NULL);
+    YACU_ASSERT_TRUE(testRun, new_composite_actor(&OPEN_GRAPH, 1, &OPEN_GRAPH_INPUT, 2, repeatedOutputs) == NULL);
+    YACU_ASSERT_EQ_UINT(testRun, composite->actor.inputs[0].consumption, 2);
+    YACU_ASSERT_EQ_UINT(testRun, composite->actor.outputs[0].production, 1);
+
+    CsdfActor actors[] = {source->actor, composite->actor};
+    CsdfConnection connections[] = {
+        {.source = {.actorId = 0, .outputId = 0}, .destination = {.actorId = 1, .inputId = 0}, .tokenSize = sizeof(double), .numTokens = 0, .initialTokens = NULL}};
+    CsdfGraph outer = {.numActors = 2, .actors = actors, .numConnections = 1, .connections = connections};
+    CsdfGraphRun *runData = new_graph_run(&outer, 4);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+
+    double *sums = new_record_storage(runData->actorRuns[1]->recordData, 0);
+    copy_recorded_tokens(runData->actorRuns[1]->recordData, 0, sums);
+    for (size_t firing = 0; firing < 4; firing++)
+    {
+        YACU_ASSERT_APPROX_EQ_DBL(testRun, sums[firing], 2.0 * (4 * firing + 3), 1e-6);
+    }
+    delete_record_storage(sums);
+    delete_graph_run(runData);
+    delete_file_source(source);
+    remove("composite.bin");
+
+    // Each instance fires the composite in its own inner run.
+    CsdfActor constantActors[] = {SIMPLE_GRAPH.actors[0], composite->actor};
+    CsdfGraph constantOuter = {.numActors = 2, .actors = constantActors, .numConnections = 1, .connections = connections};
+    double constantSums[8][10];
+    CsdfOutputId results[] = {{.actorId = 1, .outputId = 0}};
+    void *resultTokens[] = {constantSums};
+    CsdfBatch batch = {
+        .graph = &constantOuter,
+        .numIterations = 10,
+        .numInstances = 8,
+        .initialTokens = NULL,
+        .numResults = 1,
+        .results = results,
+        .resultTokens = resultTokens};
+    YACU_ASSERT_TRUE(testRun, batch_run(&CSDF_PTHREAD_THREADING, 4, &batch));
+    for (int instanceId = 0; instanceId < 8; instanceId++)
+    {
+        for (int firing = 0; firing < 10; firing++)
+        {
+            YACU_ASSERT_APPROX_EQ_DBL(testRun, constantSums[instanceId][firing], 12., 1e-6);
+        }
+    }
+    delete_composite_actor(composite);
+}
+
+static unsigned threadsLeft;
+
+static bool create_limited_thread(void *threadData, CsdfThreadTask task, void *taskData)
+{
+    if (threadsLeft == 0)
+    {
+        return false;
+    }
+    threadsLeft--;
+    return CSDF_PTHREAD_THREADING.createThread(threadData, task, taskData);
+}
+
+void test_ramp_failed_start(YacuTestRun *testRun)
+{
+    CsdfThreading limitedThreading = CSDF_PTHREAD_THREADING;
+    limitedThreading.createThread = create_limited_thread;
+
+    CsdfGraphRun *chainData = new_graph_run(&RAMP_CHAIN_GRAPH, 1000);
+    threadsLeft = 2;
+    YACU_ASSERT_TRUE(testRun, !parallel_run(&limitedThreading, chainData));
+    delete_graph_run(chainData);
+
+    CsdfGraphRun *rampData = new_graph_run(&RAMP_GRAPH, 1000);
+    CsdfParallelOptions options = {.statelessReplicas = 4};
+    threadsLeft = 3;
+    YACU_ASSERT_TRUE(testRun, !parallel_run_with_options(&limitedThreading, rampData, &options));
+    delete_graph_run(rampData);
+}
+
 YacuTest executionTests[] = {
     {"SimpleSequentialIterationTest", &test_simple_sequential_iteration},
     {"SimpleSequentialRun", &test_simple_sequential_run},
     {"SimpleParallelRun", &test_simple_parallel_run},
     {"LargerSequentialIterationTest", &test_larger_sequential_iteration},
     {"LargerProducedRecordTest", &test_larger_produced_record},
+    {"SimpleSelectedRecord", &test_simple_selected_record},
+    {"LargerLastRecord", &test_larger_last_record},
+    {"LargerFileRecord", &test_larger_file_record},
+    {"LargerResetRun", &test_larger_reset_run},
+    {"LargerBatchRun", &test_larger_batch_run},
+    {"SimpleTrace", &test_simple_trace},
+    {"OpenStream", &test_open_stream},
+    {"RampReplicatedRun", &test_ramp_replicated_run},
+    {"RampPooledRun", &test_ramp_pooled_run},
+    {"FramePooledRun", &test_frame_pooled_run},
+    {"RampPlacedRun", &test_ramp_placed_run},
+    {"SelfTimedRun", &test_self_timed_run},
+    {"SelfTimedProfiledRun", &test_self_timed_profiled_run},
+    {"RampWaitingRun", &test_ramp_waiting_run},
+    {"BulkBufferWrap", &test_bulk_buffer_wrap},
+    {"RampBlockedRun", &test_ramp_blocked_run},
+    {"ShmBufferOpen", &test_shm_buffer_open},
+    {"RampMultiprocessRun", &test_ramp_multiprocess_run},
+    {"RampClusterRun", &test_ramp_cluster_run},
+    {"RampClusterPeerClosed", &test_ramp_cluster_peer_closed},
+    {"RampFootprintPlan", &test_ramp_footprint_plan},
+    {"RampEdfRun", &test_ramp_edf_run},
+    {"RampLatencyTracking", &test_ramp_latency_tracking},
+    {"FeedbackLatencyTracking", &test_feedback_latency_tracking},
+    {"RampDemandRun", &test_ramp_demand_run},
+    {"RampFusedBatch", &test_ramp_fused_batch},
+    {"RampFailedStart", &test_ramp_failed_start},
+    {"OpenCompositeRun", &test_open_composite_run},
     {"LargerParallel", &test_larger_parallel},
     END_OF_TESTS};
@@ -11,7 +11,15 @@ Copyright (c) 2023 Slaven Glumac
 #include <samples/simple.h>
 #include <samples/larger.h>
 
+#include <samples/ramp.h>
+
 #include <csdf/repetition.h>
+#include <csdf/schedule.h>
+#include <csdf/fusion.h>
+#include <csdf/lifetime.h>
+#include <csdf/partition.h>
+#include <csdf/demand.h>
+#include <csdf/execution/sequential.h>
 
 void test_simple_repetition_vector(YacuTestRun *testRun)
 {
@@ -34,7 +42,170 @@ void test_larger_repetition_vector(YacuTestRun *testRun)
     YACU_ASSERT_EQ_UINT(testRun, r[1], 1);
 }
 
+void test_larger_schedule(YacuTestRun *testRun)
+{
+    unsigned int r[2] = {0};
+    csdf_repetition_vector(&LARGER_GRAPH, r);
+    CsdfSchedule *schedule = new_sequential_schedule(&LARGER_GRAPH, r);
+    YACU_ASSERT_TRUE(testRun, schedule != NULL);
+    YACU_ASSERT_EQ_UINT(testRun, schedule->numEntries, 2);
+    YACU_ASSERT_EQ_UINT(testRun, schedule->entries[0].actorId, 0);
+    YACU_ASSERT_EQ_UINT(testRun, schedule->entries[0].count, 2);
+    YACU_ASSERT_EQ_UINT(testRun, schedule->entries[1].actorId, 1);
+    YACU_ASSERT_EQ_UINT(testRun, schedule_num_firings(schedule), 3);
+    delete_schedule(schedule);
+}
+
+void test_simple_fusion(YacuTestRun *testRun)
+{
+    CsdfFusedGraph *fusedGraph = new_fused_graph(&SIMPLE_GRAPH);
+    YACU_ASSERT_EQ_UINT(testRun, fusedGraph->graph->numActors, 1);
+    YACU_ASSERT_EQ_UINT(testRun, fusedGraph->graph->numConnections, 0);
+    YACU_ASSERT_EQ_UINT(testRun, fusedGraph->numEliminatedConnections, 2);
+    CsdfGraphRun *runData = new_graph_run(fusedGraph->graph, 10);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    delete_graph_run(runData);
+    delete_fused_graph(fusedGraph);
+
+    // Without the sink the fused actor keeps the gain output to compare.
+    CsdfGraph constantGain = {
+        .actors = SIMPLE_GRAPH.actors,
+        .numActors = 2,
+        .connections = SIMPLE_GRAPH.connections,
+        .numConnections = 1};
+    fusedGraph = new_fused_graph(&constantGain);
+    YACU_ASSERT_EQ_UINT(testRun, fusedGraph->graph->numActors, 1);
+    CsdfGraphRun *run1Data = new_graph_run(&constantGain, 10);
+    CsdfGraphRun *run2Data = new_graph_run(fusedGraph->graph, 10);
+    YACU_ASSERT_TRUE(testRun, sequential_run(run1Data));
+    YACU_ASSERT_TRUE(testRun, sequential_run(run2Data));
+    CsdfRecordData *gain1Record = run1Data->actorRuns[1]->recordData;
+    CsdfRecordData *gain2Record = run2Data->actorRuns[fusedGraph->actorIds[1]]->recordData;
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(gain2Record, 0), 10);
+    double *gain1Output = new_record_storage(gain1Record, 0);
+    double *gain2Output = new_record_storage(gain2Record, 0);
+    copy_recorded_tokens(gain1Record, 0, gain1Output);
+    copy_recorded_tokens(gain2Record, 0, gain2Output);
+    for (size_t tokenId = 0; tokenId < 10; tokenId++)
+    {
+        YACU_ASSERT_APPROX_EQ_DBL(testRun, gain2Output[tokenId], gain1Output[tokenId], 1e-3);
+        YACU_ASSERT_APPROX_EQ_DBL(testRun, gain2Output[tokenId], 6., 1e-3);
+    }
+    delete_record_storage(gain1Output);
+    delete_record_storage(gain2Output);
+    delete_graph_run(run1Data);
+    delete_graph_run(run2Data);
+    delete_fused_graph(fusedGraph);
+}
+
+void test_ramp_chain_fusion(YacuTestRun *testRun)
+{
+    CsdfFusedGraph *fusedGraph = new_fused_graph(&RAMP_CHAIN_GRAPH);
+    YACU_ASSERT_EQ_UINT(testRun, fusedGraph->graph->numActors, 2);
+    YACU_ASSERT_EQ_UINT(testRun, fusedGraph->numEliminatedConnections, 1);
+    YACU_ASSERT_EQ_UINT(testRun, fusedGraph->eliminatedConnections[0], 2);
+    YACU_ASSERT_EQ_UINT(testRun, fusedGraph->actorIds[2], 1);
+
+    CsdfGraphRun *run1Data = new_graph_run(&RAMP_CHAIN_GRAPH, 20);
+    CsdfGraphRun *run2Data = new_graph_run(fusedGraph->graph, 20);
+    YACU_ASSERT_TRUE(testRun, sequential_run(run1Data));
+    YACU_ASSERT_TRUE(testRun, sequential_run(run2Data));
+    CsdfRecordData *squareSum1Record = run1Data->actorRuns[2]->recordData;
+    CsdfRecordData *squareSum2Record = run2Data->actorRuns[fusedGraph->actorIds[2]]->recordData;
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(squareSum1Record, 0), 60);
+    YACU_ASSERT_EQ_UINT(testRun, recorded_firings(squareSum2Record, 0), 20);
+    long *squareSum1Output = new_record_storage(squareSum1Record, 0);
+    long *squareSum2Output = new_record_storage(squareSum2Record, 0);
+    copy_recorded_tokens(squareSum1Record, 0, squareSum1Output);
+    copy_recorded_tokens(squareSum2Record, 0, squareSum2Output);
+    for (size_t tokenId = 0; tokenId < 60; tokenId++)
+    {
+        YACU_ASSERT_EQ_INT(testRun, squareSum1Output[tokenId], squareSum2Output[tokenId]);
+    }
+    delete_record_storage(squareSum1Output);
+    delete_record_storage(squareSum2Output);
+    delete_graph_run(run1Data);
+    delete_graph_run(run2Data);
+    delete_fused_graph(fusedGraph);
+}
+
+void test_simple_buffer_packing(YacuTestRun *testRun)
+{
+    unsigned int r[3] = {0};
+    csdf_repetition_vector(&SIMPLE_GRAPH, r);
+    CsdfSchedule *schedule = new_sequential_schedule(&SIMPLE_GRAPH, r);
+    CsdfBufferPacking *packing = new_buffer_packing(&SIMPLE_GRAPH, schedule);
+    YACU_ASSERT_EQ_UINT(testRun, packing->lifetimes[0].maxTokens, 2);
+    YACU_ASSERT_EQ_UINT(testRun, packing->lifetimes[0].lastPhase, 2);
+    YACU_ASSERT_EQ_UINT(testRun, packing->lifetimes[1].firstPhase, 3);
+    YACU_ASSERT_EQ_UINT(testRun, packing->numRegions, 1);
+    YACU_ASSERT_EQ_UINT(testRun, packing->unpackedBytes, 4 * sizeof(double));
+    YACU_ASSERT_EQ_UINT(testRun, packing->packedBytes, 2 * sizeof(double));
+    delete_buffer_packing(packing);
+    delete_schedule(schedule);
+
+    CsdfRecordSelection recordSelections[] = {
+        {.output = {.actorId = 1, .outputId = 0}, .option = {.mode = CSDF_RECORD_FULL}}};
+    CsdfGraphRunOptions options = {.numRecordSelections = 1, .recordSelections = recordSelections, .shareBufferMemory = true};
+    CsdfGraphRun *runData = new_graph_run_with_options(&SIMPLE_GRAPH, 10, &options);
+    YACU_ASSERT_TRUE(testRun, runData->sharedBufferMemory != NULL);
+    YACU_ASSERT_TRUE(testRun, sequential_run(runData));
+    double *gainOutput = new_record_storage(runData->actorRuns[1]->recordData, 0);
+    copy_recorded_tokens(runData->actorRuns[1]->recordData, 0, gainOutput);
+    for (size_t tokenId = 0; tokenId < 10; tokenId++)
+    {
+        YACU_ASSERT_APPROX_EQ_DBL(testRun, gainOutput[tokenId], 6., 1e-3);
+    }
+    delete_record_storage(gainOutput);
+    delete_graph_run(runData);
+}
+
+void test_ramp_chain_partition(YacuTestRun *testRun)
+{
+    unsigned int r[3] = {0};
+    csdf_repetition_vector(&RAMP_CHAIN_GRAPH, r);
+    uint64_t traffic[3] = {0};
+    connection_traffic(&RAMP_CHAIN_GRAPH, r, traffic);
+    YACU_ASSERT_EQ_UINT(testRun, traffic[0], r[0] * sizeof(long));
+    YACU_ASSERT_EQ_UINT(testRun, traffic[1], 2 * sizeof(long));
+    YACU_ASSERT_EQ_UINT(testRun, traffic[2], 6 * sizeof(long));
+
+    uint64_t costs[3] = {1, 1, 1};
+    size_t parts[3] = {0};
+    balanced_partition(&RAMP_CHAIN_GRAPH, costs, traffic, 2, parts);
+    YACU_ASSERT_EQ_UINT(testRun, parts[1], parts[2]);
+    YACU_ASSERT_TRUE(testRun, parts[0] != parts[1]);
+    YACU_ASSERT_EQ_UINT(testRun, partition_cut(&RAMP_CHAIN_GRAPH, traffic, parts), traffic[1]);
+}
+
+void test_ramp_fanout_demand(YacuTestRun *testRun)
+{
+    unsigned numQueued[3] = {1, 0, 0};
+    unsigned capacities[3] = {1, 4, 4};
+    unsigned maxFirings[3] = {100, 100, 100};
+    unsigned firings[3] = {0};
+    CsdfOutputId target = {.actorId = 1, .outputId = 0};
+    YACU_ASSERT_TRUE(testRun, firing_demand(&RAMP_FANOUT_GRAPH, numQueued, NULL, maxFirings, target, 5, firings));
+    YACU_ASSERT_EQ_UINT(testRun, firings[0], 10);
+    YACU_ASSERT_EQ_UINT(testRun, firings[1], 5);
+    YACU_ASSERT_EQ_UINT(testRun, firings[2], 0);
+
+    YACU_ASSERT_TRUE(testRun, firing_demand(&RAMP_FANOUT_GRAPH, numQueued, capacities, maxFirings, target, 5, firings));
+    YACU_ASSERT_EQ_UINT(testRun, firings[0], 10);
+    YACU_ASSERT_EQ_UINT(testRun, firings[1], 5);
+    YACU_ASSERT_EQ_UINT(testRun, firings[2], 3);
+
+    maxFirings[0] = 9;
+    YACU_ASSERT_TRUE(testRun, !firing_demand(&RAMP_FANOUT_GRAPH, numQueued, NULL, maxFirings, target, 5, firings));
+}
+
 YacuTest graphTests[] = {
     {"SimpleRepetitionVectorTest", &test_simple_repetition_vector},
     {"LargerRepetitionVectorTest", &test_larger_repetition_vector},
+    {"LargerScheduleTest", &test_larger_schedule},
+    {"SimpleFusionTest", &test_simple_fusion},
+    {"RampChainFusionTest", &test_ramp_chain_fusion},
+    {"SimpleBufferPackingTest", &test_simple_buffer_packing},
+    {"RampChainPartitionTest", &test_ramp_chain_partition},
+    {"RampFanoutDemandTest", &test_ramp_fanout_demand},
     END_OF_TESTS};